@@ -0,0 +1,411 @@
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include "bakesimulator.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QtConcurrent/QtConcurrentMap>
+#include <math.h>
+
+// explicit diffusion is stable up to 1/6 in three dimensions, keep a margin
+const double DIFFUSION_STABILITY = 0.9 / 6.0;
+
+// never consume more than this fraction of the smaller reactant in one step
+const double REACTION_STABILITY = 0.5;
+
+
+BakeSimulator::BakeSimulator( const PeriodicBox& b, double spacing ) :
+    box( b ),
+    cell_volume( 1.0 ),
+    acid_diffusivity( 0.0 ),
+    quencher_diffusivity( 0.0 ),
+    deprotection_rate( 0.0 ),
+    quenching_rate( 0.0 ),
+    current_time( 0.0 ),
+    time_step( 0.0 ),
+    num_deprotected( 0 ),
+    rng(),
+    max_chain( 0 )
+{
+    for ( int a = 0; a < 3; a++ )
+    {
+        double length = box.length( a );
+        num_cells[a] = ( spacing > 0.0 && length > 0.0 ) ? qMax( 1, qRound( length / spacing ) ) : 1;
+        cell_width[a] = ( length > 0.0 ) ? length / num_cells[a] : 1.0;
+        cell_volume *= cell_width[a];
+    }
+
+    int total = num_cells[0] * num_cells[1] * num_cells[2];
+    acid.fill( 0.0, total );
+    quencher.fill( 0.0, total );
+    acid_dose.fill( 0.0, total );
+}
+
+
+
+int BakeSimulator::cellCoordinate( double v, int axis ) const
+{
+    int c = ( int ) floor( ( v - box.lower( axis ) ) / cell_width[axis] );
+
+    if ( box.isPeriodic( axis ) )
+    {
+        c %= num_cells[axis];
+        return ( c < 0 ) ? c + num_cells[axis] : c;
+    }
+
+    return qBound( 0, c, num_cells[axis] - 1 );
+}
+
+
+
+int BakeSimulator::voxel( const Qwt3D::Triple& pos ) const
+{
+    int cx = cellCoordinate( pos.x, 0 );
+    int cy = cellCoordinate( pos.y, 1 );
+    int cz = cellCoordinate( pos.z, 2 );
+
+    return ( cz * num_cells[1] + cy ) * num_cells[0] + cx;
+}
+
+
+
+void BakeSimulator::addAcid( const Qwt3D::Triple& pos )
+{
+    acid[voxel( pos )] += 1.0;
+}
+
+
+
+void BakeSimulator::addQuencher( int index, const Qwt3D::Triple& pos )
+{
+    int v = voxel( pos );
+
+    quencher[v] += 1.0;
+    quencher_index.append( index );
+    quencher_voxel.append( v );
+}
+
+
+
+void BakeSimulator::addProtectingGroup( int index, const Qwt3D::Triple& pos, int chain )
+{
+    // chains count from 1, anything else is kept in entry 0
+    chain = qMax( 0, chain );
+
+    protecting_index.append( index );
+    protecting_voxel.append( voxel( pos ) );
+    protecting_chain.append( chain );
+
+    if ( chain > max_chain )
+    {
+        max_chain = chain;
+    }
+}
+
+
+
+void BakeSimulator::start()
+{
+    current_time = 0.0;
+    num_deprotected = 0;
+    initial_quencher = quencher;
+    acid_dose.fill( 0.0, acid.count() );
+
+    // a group deprotects once k_dp * dose exceeds -ln( 1 - u )
+    protecting_threshold.resize( protecting_index.count() );
+    is_deprotected.fill( false, protecting_index.count() );
+
+    for ( int i = 0; i < protecting_index.count(); i++ )
+    {
+        protecting_threshold[i] = -log( 1.0 - rng.generateDouble() );
+    }
+
+    chain_size.fill( 0, max_chain + 1 );
+    for ( int i = 0; i < protecting_chain.count(); i++ )
+    {
+        chain_size[protecting_chain.at( i )]++;
+    }
+
+    record_times.clear();
+    record_counts.clear();
+
+    // the time step is limited by the faster diffusing species and by the
+    // largest quenching rate the initial amounts can give
+    double min_width = qMin( cell_width[0], qMin( cell_width[1], cell_width[2] ) );
+    double max_diffusivity = qMax( acid_diffusivity, quencher_diffusivity );
+
+    time_step = ( max_diffusivity > 0.0 ) ? DIFFUSION_STABILITY * min_width * min_width / max_diffusivity : 0.0;
+
+    float max_amount = 0.0;
+    for ( int v = 0; v < acid.count(); v++ )
+    {
+        max_amount = qMax( max_amount, qMax( acid.at( v ), quencher.at( v ) ) );
+    }
+
+    if ( quenching_rate > 0.0 && max_amount > 0.0 )
+    {
+        double reaction_step = REACTION_STABILITY * cell_volume / ( quenching_rate * max_amount );
+        time_step = ( time_step > 0.0 ) ? qMin( time_step, reaction_step ) : reaction_step;
+    }
+}
+
+
+
+void BakeSimulator::advance( double untilTime )
+{
+    while ( current_time < untilTime )
+    {
+        double dt = untilTime - current_time;
+        if ( time_step > 0.0 && dt > time_step )
+        {
+            dt = time_step;
+        }
+
+        step( dt );
+        current_time += dt;
+    }
+
+    updateDeprotection();
+}
+
+
+
+void BakeSimulator::step( double dt )
+{
+    // the dose is integrated with the acid at the start of the step
+    float* dose = acid_dose.data();
+    const float* a = acid.constData();
+    for ( int v = 0; v < acid.count(); v++ )
+    {
+        dose[v] += a[v] * dt;
+    }
+
+    if ( 0.0 < acid_diffusivity )
+    {
+        diffuse( acid, acid_diffusivity, dt );
+    }
+
+    if ( 0.0 < quencher_diffusivity )
+    {
+        diffuse( quencher, quencher_diffusivity, dt );
+    }
+
+    if ( 0.0 < quenching_rate )
+    {
+        float* acid_data = acid.data();
+        float* quencher_data = quencher.data();
+        float factor = quenching_rate * dt / cell_volume;
+
+        for ( int v = 0; v < acid.count(); v++ )
+        {
+            float consumed = qMin( factor * acid_data[v] * quencher_data[v], qMin( acid_data[v], quencher_data[v] ) );
+            acid_data[v] -= consumed;
+            quencher_data[v] -= consumed;
+        }
+    }
+}
+
+
+
+void BakeSimulator::diffuse( QVector<float>& field, double diffusivity, double dt )
+{
+    scratch.resize( field.count() );
+
+    const float* in = field.constData();
+    float* out = scratch.data();
+
+    const int nx = num_cells[0];
+    const int ny = num_cells[1];
+    const int nz = num_cells[2];
+    const float cx = diffusivity * dt / ( cell_width[0] * cell_width[0] );
+    const float cy = diffusivity * dt / ( cell_width[1] * cell_width[1] );
+    const float cz = diffusivity * dt / ( cell_width[2] * cell_width[2] );
+    const bool wrap[3] = { box.isPeriodic( 0 ), box.isPeriodic( 1 ), box.isPeriodic( 2 ) };
+
+    QVector<int> layers;
+    for ( int z = 0; z < nz; z++ )
+    {
+        layers.append( z );
+    }
+
+    // each layer only reads the old field, so layers are independent; rows
+    // run along x without branches in the interior so they vectorize
+    QtConcurrent::blockingMap( layers, [in, out, nx, ny, nz, cx, cy, cz, wrap]( int & z )
+    {
+        // a closed face has no flux, its missing neighbour is the cell itself
+        int z_lo = ( z > 0 ) ? z - 1 : ( wrap[2] ? nz - 1 : z );
+        int z_hi = ( z < nz - 1 ) ? z + 1 : ( wrap[2] ? 0 : z );
+
+        for ( int y = 0; y < ny; y++ )
+        {
+            int y_lo = ( y > 0 ) ? y - 1 : ( wrap[1] ? ny - 1 : y );
+            int y_hi = ( y < ny - 1 ) ? y + 1 : ( wrap[1] ? 0 : y );
+
+            const float* row = in + ( z * ny + y ) * nx;
+            const float* row_ym = in + ( z * ny + y_lo ) * nx;
+            const float* row_yp = in + ( z * ny + y_hi ) * nx;
+            const float* row_zm = in + ( z_lo * ny + y ) * nx;
+            const float* row_zp = in + ( z_hi * ny + y ) * nx;
+            float* dst = out + ( z * ny + y ) * nx;
+
+            for ( int x = 1; x < nx - 1; x++ )
+            {
+                float c = row[x];
+                dst[x] = c + cx * ( row[x - 1] + row[x + 1] - 2.0f * c )
+                         + cy * ( row_ym[x] + row_yp[x] - 2.0f * c )
+                         + cz * ( row_zm[x] + row_zp[x] - 2.0f * c );
+            }
+
+            // the two ends of the row
+            for ( int x = 0; x < nx; x += ( nx > 1 ? nx - 1 : 1 ) )
+            {
+                int x_lo = ( x > 0 ) ? x - 1 : ( wrap[0] ? nx - 1 : x );
+                int x_hi = ( x < nx - 1 ) ? x + 1 : ( wrap[0] ? 0 : x );
+                float c = row[x];
+                dst[x] = c + cx * ( row[x_lo] + row[x_hi] - 2.0f * c )
+                         + cy * ( row_ym[x] + row_yp[x] - 2.0f * c )
+                         + cz * ( row_zm[x] + row_zp[x] - 2.0f * c );
+            }
+        }
+    } );
+
+    field.swap( scratch );
+}
+
+
+
+void BakeSimulator::updateDeprotection()
+{
+    double factor = deprotection_rate / cell_volume;
+
+    for ( int i = 0; i < protecting_index.count(); i++ )
+    {
+        if ( false == is_deprotected.at( i ) && factor * acid_dose.at( protecting_voxel.at( i ) ) >= protecting_threshold.at( i ) )
+        {
+            is_deprotected[i] = true;
+            num_deprotected++;
+        }
+    }
+}
+
+
+
+void BakeSimulator::record()
+{
+    QVector<int> counts( max_chain + 1, 0 );
+
+    for ( int i = 0; i < protecting_index.count(); i++ )
+    {
+        if ( is_deprotected.at( i ) )
+        {
+            counts[protecting_chain.at( i )]++;
+        }
+    }
+
+    record_times.append( current_time );
+    record_counts.append( counts );
+}
+
+
+
+void BakeSimulator::finish( QList<int>& deprotected, QList<int>& neutralized )
+{
+    for ( int i = 0; i < protecting_index.count(); i++ )
+    {
+        if ( is_deprotected.at( i ) )
+        {
+            deprotected.append( protecting_index.at( i ) );
+        }
+    }
+
+    // a quencher is neutralized with the probability that its voxel lost quencher
+    for ( int i = 0; i < quencher_index.count(); i++ )
+    {
+        int v = quencher_voxel.at( i );
+        double left = ( initial_quencher.at( v ) > 0.0 ) ? quencher.at( v ) / initial_quencher.at( v ) : 1.0;
+
+        if ( rng.generateDouble() < 1.0 - left )
+        {
+            neutralized.append( quencher_index.at( i ) );
+        }
+    }
+}
+
+
+
+double BakeSimulator::acidAmount() const
+{
+    double sum = 0.0;
+    for ( int v = 0; v < acid.count(); v++ )
+    {
+        sum += acid.at( v );
+    }
+
+    return sum;
+}
+
+
+
+double BakeSimulator::quencherAmount() const
+{
+    double sum = 0.0;
+    for ( int v = 0; v < quencher.count(); v++ )
+    {
+        sum += quencher.at( v );
+    }
+
+    return sum;
+}
+
+
+
+bool BakeSimulator::writeCSV( const QString& fileName ) const
+{
+    QFile file( fileName );
+
+    if ( false == file.open( QFile::WriteOnly | QFile::Truncate ) )
+    {
+        return false;
+    }
+
+    QTextStream out( &file );
+
+    out << "time,chain_index,protecting_groups,deprotected\n";
+
+    for ( int r = 0; r < record_times.count(); r++ )
+    {
+        for ( int c = 0; c < record_counts.at( r ).count(); c++ )
+        {
+            if ( 0 < chain_size.at( c ) )
+            {
+                out << record_times.at( r ) << "," << c << "," << chain_size.at( c ) << "," << record_counts.at( r ).at( c ) << "\n";
+            }
+        }
+    }
+
+    out.flush();
+
+    return QFile::NoError == file.error();
+}
@@ -0,0 +1,114 @@
+#ifndef BAKESIMULATOR_H
+#define BAKESIMULATOR_H
+
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+#include <QVector>
+#include <QList>
+#include <QString>
+#include <QRandomGenerator>
+
+#include "spatialindex.h"
+
+// Post-exposure bake on the packed morphology. Photoacids and quenchers are
+// binned onto a lattice over the box and their amounts per voxel advanced
+// by explicit finite differences:
+//
+//   dA/dt = D_A lap(A) - k_q A Q / V
+//   dQ/dt = D_Q lap(Q) - k_q A Q / V
+//
+// with V the voxel volume. Periodic axes wrap, the others have no flux
+// across the box faces. A protecting group deprotects with probability
+// 1 - exp( -k_dp integral( A / V dt ) ) taken over its voxel, decided
+// against a threshold drawn once per group, so records taken at any time
+// are consistent with the final result. Quenchers are marked neutralized
+// at the end in proportion to the quencher consumed in their voxel.
+
+class BakeSimulator
+{
+public:
+    BakeSimulator( const PeriodicBox& box, double spacing );
+
+    void setDiffusivities( double acid, double quencher ) { acid_diffusivity = acid; quencher_diffusivity = quencher; }
+    void setRateConstants( double deprotection, double quenching ) { deprotection_rate = deprotection; quenching_rate = quenching; }
+    void setSeed( quint32 seed ) { rng.seed( seed ); }
+
+    void addAcid( const Qwt3D::Triple& pos );
+    void addQuencher( int index, const Qwt3D::Triple& pos );
+    void addProtectingGroup( int index, const Qwt3D::Triple& pos, int chain );
+
+    void start();
+    void advance( double untilTime );
+    void record();
+    void finish( QList<int>& deprotected, QList<int>& neutralized );
+
+    double time() const { return current_time; }
+    double timeStep() const { return time_step; }
+    int deprotectedCount() const { return num_deprotected; }
+    double acidAmount() const;
+    double quencherAmount() const;
+
+    bool writeCSV( const QString& fileName ) const;
+
+protected:
+    PeriodicBox box;
+    int num_cells[3];
+    double cell_width[3];
+    double cell_volume;
+    double acid_diffusivity;
+    double quencher_diffusivity;
+    double deprotection_rate;
+    double quenching_rate;
+    double current_time;
+    double time_step;
+    int num_deprotected;
+    QRandomGenerator rng;
+
+    QVector<float> acid;
+    QVector<float> quencher;
+    QVector<float> initial_quencher;
+    QVector<float> acid_dose;
+    QVector<float> scratch;
+
+    QVector<int> protecting_index;
+    QVector<int> protecting_voxel;
+    QVector<int> protecting_chain;
+    QVector<float> protecting_threshold;
+    QVector<char> is_deprotected;
+    QVector<int> quencher_index;
+    QVector<int> quencher_voxel;
+
+    int max_chain;
+    QVector<double> record_times;
+    QVector< QVector<int> > record_counts;
+    QVector<int> chain_size;
+
+    int voxel( const Qwt3D::Triple& pos ) const;
+    int cellCoordinate( double v, int axis ) const;
+    void step( double dt );
+    void diffuse( QVector<float>& field, double diffusivity, double dt );
+    void updateDeprotection();
+};
+
+#endif // BAKESIMULATOR_H
@@ -24,8 +24,10 @@
 
 #include "chaingraph.h"
 #include "colorring.h"
+#include "crosssectiondialog.h"
 #include "mainwindow.h"
 #include "random.h"
+#include "snapshotrenderer.h"
 #include <QFileDialog>
 
 const char* FONT_STYLE = "Helvetica";
@@ -40,6 +42,11 @@ const int FIRST_MONOMER_NODE = 2;
 ChainGraph::ChainGraph( QWidget* w ):
     Qwt3D::GraphPlot( w ),
     main_win( ( MainWindow* ) w ),
+    node_buffer( std::make_shared<RenderNodeVector>() ),
+    bond_buffer( std::make_shared<RenderBondVector>() ),
+    nodes( *node_buffer ),
+    bonds( *bond_buffer ),
+    node_hull( Triple( 0, 0, 0 ), Triple( 0, 0, 0 ) ),
     chain_count( 0 ),
     show_monomers( false ),
     space_filling( true ),
@@ -48,7 +55,11 @@ ChainGraph::ChainGraph( QWidget* w ):
     monomer_list( main_win->monomerList() ),
     monomer_count(),
     avg_radius_of_gyration( 0.0 ),
-    current_scanned_chain( 0 )
+    current_scanned_chain( 0 ),
+    rebuild_chains( true ),
+    isolated_chain( -1 ),
+    chain_radius( 0.0 ),
+    cell_width( 0, 0, 0 )
 {
     showDefaultView();
     setScale( 1, 1, 1 );
@@ -78,6 +89,17 @@ ChainGraph::ChainGraph( QWidget* w ):
     connect( action, SIGNAL( triggered( bool ) ), this, SLOT( saveSnapshot() ) );
     popup_menu->addAction( action );
 
+    popup_menu->addSeparator();
+
+    action  = new QAction( QString( "Cross Section..." ), this );
+    connect( action, SIGNAL( triggered( bool ) ), this, SLOT( showCrossSectionDialog() ) );
+    popup_menu->addAction( action );
+
+    action  = new QAction( QString( "Bonds as Lines" ), this );
+    action->setCheckable( true );
+    connect( action, SIGNAL( toggled( bool ) ), this, SLOT( setBondLines( bool ) ) );
+    popup_menu->addAction( action );
+
 }
 
 
@@ -117,41 +139,152 @@ void ChainGraph::scanChains( int chainIndex )
 {
     int length = 0;
 
-    for ( int j = FIRST_MONOMER_NODE; j < nodes.size(); j++ )
+    if ( paletteAvailable() && !rebuild_chains )
+    {
+        // the impostors hide the other chains through the palette, the geometry stays
+        std::vector<bool> visible( chain_ranges.count(), false );
+
+        if ( 0 <= chainIndex && chainIndex < chain_ranges.count() )
+        {
+            visible[chainIndex] = true;
+
+            if ( show_monomers )
+            {
+                length = chain_ranges[chainIndex].last - chain_ranges[chainIndex].first;
+            }
+        }
+
+        setChainVisibility( visible );
+    }
+    else if ( !chain_ranges.isEmpty() )
     {
-        if ( chainIndex == nodes[j].index )
+        // once the other chains are hidden, the next scan only swaps the slices
+        // of nodes and bonds of two chains
+        if ( isolated_chain < 0 )
         {
-            nodes[j].col.a = 1.0;
-            length++;
+            for ( int j = FIRST_MONOMER_NODE; j < nodes.size(); j++ )
+            {
+                nodes[j].setAlpha( 0.0 );
+            }
+
+            for ( int k = 0; k < bonds.size(); k++ )
+            {
+                bonds[k].setAlpha( 0.0 );
+            }
         }
         else
         {
-            nodes[j].col.a = 0.0;
+            setChainAlpha( isolated_chain, 0.0 );
         }
-    }
 
-    for ( int k = 0; k < bonds.size(); k++ )
+        length = setChainAlpha( chainIndex, 1.0 );
+        isolated_chain = qMax( chainIndex, 0 );
+
+        shareDataset();
+        rebuild_chains = true;
+    }
+    else
     {
-        if ( chainIndex == bonds[k].index )
+        // a point cloud has no chains, its indices are particles
+        for ( int j = FIRST_MONOMER_NODE; j < nodes.size(); j++ )
         {
-            bonds[k].col.a = 1.0;
+            if ( chainIndex == nodes[j].index )
+            {
+                nodes[j].setAlpha( 1.0 );
+                length++;
+            }
+            else
+            {
+                nodes[j].setAlpha( 0.0 );
+            }
         }
-        else
+
+        for ( int k = 0; k < bonds.size(); k++ )
         {
-            bonds[k].col.a = 0.0;
+            if ( chainIndex == bonds[k].index )
+            {
+                bonds[k].setAlpha( 1.0 );
+            }
+            else
+            {
+                bonds[k].setAlpha( 0.0 );
+            }
         }
+
+        shareDataset();
+        rebuild_chains = true;
     }
 
-    setTitle( QString( "Showing chain %1, length %2" ).arg( chainIndex + 1 ).arg( length ) );
-    createDataset( nodes, bonds );
+    if ( 0 <= chainIndex && chainIndex < chain_ranges.count() && 0.0 <= chain_ranges[chainIndex].rg )
+    {
+        setTitle( QString( "Showing chain %1, length %2, Rg %3" ).arg( chainIndex + 1 ).arg( length ).arg( chain_ranges[chainIndex].rg ) );
+    }
+    else
+    {
+        setTitle( QString( "Showing chain %1, length %2" ).arg( chainIndex + 1 ).arg( length ) );
+    }
 
     updateGL();
     current_scanned_chain = chainIndex + 1;
 }
 
+void ChainGraph::applySpecies( const SpeciesStore& species, const MonomerList* list )
+{
+    // the monomer nodes follow the store one to one unless monomers are hidden
+    if ( ( int ) nodes.size() - FIRST_MONOMER_NODE != species.count() )
+    {
+        return;
+    }
+
+    // the colours below make hidden nodes opaque again
+    isolated_chain = -1;
+
+    for ( int i = 0; i < species.count(); i++ )
+    {
+        RenderNode& node = nodes[FIRST_MONOMER_NODE + i];
+        int type = species.monomerType( i );
+
+        if ( node.monomer_type != type && 0 <= type && type < list->count() )
+        {
+            node.monomer_type = type;
+            node.setColor( list->monomer( type )->color() );
+        }
+    }
+
+    if ( !paletteAvailable() || rebuild_chains )
+    {
+        rebuild_chains = true;
+        refreshChains();
+        return;
+    }
+
+    // only the monomer types changed; they select the palette colours, or with
+    // another colouring the changed monomers stand out in their own colours
+    if ( MONOMER == coloration )
+    {
+        updateAttributes();
+    }
+    else
+    {
+        setColorSource( OWNCOLORS );
+        updateDataTail( FIRST_MONOMER_NODE, bonds.size() );
+    }
+
+    updateGL();
+}
+
+
+
+void ChainGraph::shareDataset()
+{
+    createDataset( node_buffer, bond_buffer, node_hull );
+}
+
+
+
 void ChainGraph::refreshChains()
 {
-    createDataset( nodes, bonds );
+    shareDataset();
     configure();
     updateGL();
 }
@@ -162,8 +295,13 @@ void ChainGraph::clear()
 {
     nodes.clear();
     bonds.clear();
+    bond_atoms.clear();
+    chain_ranges.clear();
+    node_hull = Qwt3D::hull( nodes );
+    rebuild_chains = true;
+    isolated_chain = -1;
 
-    createDataset( nodes, bonds );
+    shareDataset();
 
     chain_count = 0;
 
@@ -181,6 +319,17 @@ void ChainGraph::contextMenuEvent( QContextMenuEvent* event )
 
 
 void ChainGraph::recolorPointCloud( MonomerSequence* sequence, AdditiveList* additiveList )
+{
+    colorPointCloud( sequence, additiveList );
+
+    // the points keep their positions, only the sphere instances are rebuilt
+    updateDataTail( FIRST_MONOMER_NODE, bonds.size() );
+    updateGL();
+}
+
+
+
+void ChainGraph::colorPointCloud( MonomerSequence* sequence, AdditiveList* additiveList )
 {
     RGBA current_col = Monomer().color();
     int type_id = 0;
@@ -200,7 +349,7 @@ void ChainGraph::recolorPointCloud( MonomerSequence* sequence, AdditiveList* add
     {
         current_col.a = 0.4;
 
-        nodes.at( i ).col = current_col;
+        nodes.at( i ).setColor( current_col );
         nodes.at( i ).monomer_type = type_id;
 
         if ( MONOMER == coloration )
@@ -223,12 +372,10 @@ void ChainGraph::recolorPointCloud( MonomerSequence* sequence, AdditiveList* add
         {
             current_col.a = 0.4;
 
-            nodes.at( i ).col = current_col;
+            nodes.at( i ).setColor( current_col );
             nodes.at( i ).monomer_type = type_id;
         }
     }
-
-    updateGL();
 }
 
 
@@ -236,15 +383,23 @@ void ChainGraph::drawPointCloud( Parameters& gParams, int num_particles,  Monome
 {
     nodes.clear();
     bonds.clear();
+    bond_atoms.clear();
+    chain_ranges.clear();
+    isolated_chain = -1;
 
     // add points at extremes of box to set overall scale
     // the first two nodes are used for this...
 
-    nodes.push_back( Atom( -1,  Triple( 0, 0, 0 ), 0.05, RGBA( 0, 0, 0, 0 ) ) );
-    nodes.push_back( Atom( -1, Triple( gParams.box_size.x, gParams.box_size.y, gParams.box_size.z ), 0.05, RGBA( 0, 0, 0, 0 ) ) );
+    nodes.push_back( RenderNode( -1,  Triple( 0, 0, 0 ), 0.05, RGBA( 0, 0, 0, 0 ) ) );
+    nodes.push_back( RenderNode( -1, Triple( gParams.box_size.x, gParams.box_size.y, gParams.box_size.z ), 0.05, RGBA( 0, 0, 0, 0 ) ) );
 
     // a dummy bond - for the point cloud only
-    bonds.push_back( Bond( -1, Triple( 0, 0, 0 ), Triple( gParams.box_size.x, gParams.box_size.y, gParams.box_size.z ), RGBA( 0, 0, 0, 0 ) ) );
+    bonds.push_back( RenderBond( -1, Triple( 0, 0, 0 ), Triple( gParams.box_size.x, gParams.box_size.y, gParams.box_size.z ), RGBA( 0, 0, 0, 0 ) ) );
+
+    // all points lie in the box, the plot need not scan them for its hull
+    node_hull = ParallelEpiped( Triple( 0, 0, 0 ), Triple( gParams.box_size.x, gParams.box_size.y, gParams.box_size.z ) );
+    cell_width = Triple( 0, 0, 0 );
+    rebuild_chains = true;
 
     double radius =  gParams.atom_radius * 0.2;
 
@@ -255,13 +410,17 @@ void ChainGraph::drawPointCloud( Parameters& gParams, int num_particles,  Monome
         v.y = randomDouble() * gParams.box_size.y;
         v.z = randomDouble() * gParams.box_size.z;
 
-        nodes.push_back( Atom( i, Triple( v.x, v.y, v.z ), radius ) );
+        nodes.push_back( RenderNode( i, Triple( v.x, v.y, v.z ), radius ) );
     }
 
-    recolorPointCloud( sequence, additiveList );
+    colorPointCloud( sequence, additiveList );
     setTitle( QString( "Random Point Cloud: %1 points" ).arg( nodes.size() - 2 ) );
 
-    createDataset( nodes, bonds );
+    // particle indices are no chains, the points are drawn in their own colours
+    setColorSource( OWNCOLORS );
+    setChainVisibility( std::vector<bool>() );
+
+    shareDataset();
     configure();
     updateGL();
 }
@@ -272,104 +431,417 @@ void ChainGraph::drawChains( Grid* grid, MonomerList* monomer_list )
 {
     nodes.clear();
     bonds.clear();
-    ColorRing col_ring;
-    col_ring.setRandomColors( true );
-
-    double radius = space_filling ? grid->params.atom_radius : grid->params.atom_radius * 0.2;
+    bond_atoms.clear();
+    chain_ranges.clear();
+    isolated_chain = -1;
 
-    float gScale = grid->params.box_size.x;
-    if ( grid->params.box_size.y > gScale ) gScale = grid->params.box_size.y;
-    if ( grid->params.box_size.z > gScale ) gScale = grid->params.box_size.z;
-    if ( gScale <= 0.0 ) gScale = 1.0;
-    gScale = 2.0 / gScale;
-    int count = 0;
+    chain_radius = space_filling ? grid->params.atom_radius : grid->params.atom_radius * 0.2;
 
     // add points at extremes of box to set overall scale
     // this uses the first two nodes for this specfici purspose - they are not monomers
 
-    nodes.push_back( Atom( -1,  Triple( 0, 0, 0 ), 0.05, RGBA( 0, 0, 0, 0 ) ) );
-    nodes.push_back( Atom( -1, Triple( grid->params.box_size.x, grid->params.box_size.y, grid->params.box_size.z ), 0.05, RGBA( 0, 0, 0, 0 ) ) );
+    nodes.push_back( RenderNode( -1,  Triple( 0, 0, 0 ), 0.05, RGBA( 0, 0, 0, 0 ) ) );
+    nodes.push_back( RenderNode( -1, Triple( grid->params.box_size.x, grid->params.box_size.y, grid->params.box_size.z ), 0.05, RGBA( 0, 0, 0, 0 ) ) );
 
-    RGBA current_col;
+    // monomers are wrapped into the box, so the box is the hull
+    node_hull = ParallelEpiped( Triple( 0, 0, 0 ), Triple( grid->params.box_size.x, grid->params.box_size.y, grid->params.box_size.z ) );
+
+    // culling chunks are whole packing cells, about 16 per box edge
+    cell_width = Triple( grid->site_width.x, grid->site_width.y, grid->site_width.z );
+    setChunkSize( Triple( cell_width.x * qMax( 1, grid->Lx / 16 ),
+                          cell_width.y * qMax( 1, grid->Ly / 16 ),
+                          cell_width.z * qMax( 1, grid->Lz / 16 ) ) );
 
     for ( int i = 0; i < grid->max_chains; i++ )
     {
-        switch ( coloration )
+        chain_ranges.append( newChainRange( &grid->chains[i] ) );
+        appendChain( grid, monomer_list, i, grid->chains[i].first );
+    }
+
+    updateChainStatistics();
+    applyColoration();
+    setChainVisibility( std::vector<bool>() );
+    rebuild_chains = false;
+    refreshChains();
+}
+
+
+
+void ChainGraph::updateChains( Grid* grid, MonomerList* monomer_list )
+{
+    // a changed box or chain radius, or a recolouring, needs the full rebuild
+    double radius = space_filling ? grid->params.atom_radius : grid->params.atom_radius * 0.2;
+
+    if ( rebuild_chains || radius != chain_radius || chain_ranges.count() > grid->max_chains
+            || node_hull.maxVertex != Triple( grid->params.box_size.x, grid->params.box_size.y, grid->params.box_size.z ) )
+    {
+        drawChains( grid, monomer_list );
+        return;
+    }
+
+    // a scanned chain is shown alone until the next update
+    if ( !chainVisibility().empty() )
+    {
+        setChainVisibility( std::vector<bool>() );
+        updateGL();
+    }
+
+    int known_chains = chain_ranges.count();
+
+    // find the first chain that changed since the last frame; it is redrawn from its
+    // watermark on, all chains behind it are redrawn as they move in nodes and bonds
+    int dirty_chain = grid->max_chains;
+    int dirty_atom = 0;
+
+    for ( int i = 0; i < grid->max_chains && dirty_chain == grid->max_chains; i++ )
+    {
+        Chain* chain = &grid->chains[i];
+
+        if ( i >= chain_ranges.count() )
         {
-            case MONOCHROME:
-            case MONOMER:
-                current_col = Monomer().color();
-                break;
-
-            case CHAIN:
-                current_col = col_ring.nextColor();
-                break;
+            chain_ranges.append( newChainRange( chain ) );
         }
 
-        Chain* chain = &grid->chains[i];
+        ChainRange& range = chain_ranges[i];
+
+        if ( chain->first != range.first )
+        {
+            // grown or cut at its head, the whole chain is redrawn
+            dirty_chain = i;
+            dirty_atom = qMin( chain->first, range.first );
+        }
+        else if ( chain->last != range.last || chain->dirty < chain->last )
+        {
+            dirty_chain = i;
+            dirty_atom = qMin( chain->dirty, qMin( chain->last, range.last ) );
+        }
+    }
+
+    if ( dirty_chain == grid->max_chains )
+    {
+        return;
+    }
+
+    // cut nodes and bonds at the first changed atom
+    ChainRange& range = chain_ranges[dirty_chain];
+    int node_cut = range.node_start;
+    int bond_cut = range.bond_start;
+
+    if ( dirty_atom > range.first )
+    {
+        int bond_end = bondEnd( dirty_chain );
 
-        // add monomers
         if ( show_monomers )
         {
-            current_col.a = 0.4;
-            if ( chain->last - chain->first <= 0 ) continue;
-            count++;
-            for ( int j = chain->first; j < chain->last; j++ )
-            {
-                int k = j - chain->offset;
-                Vector v = Vector_periodic_box( chain->atoms[k], grid->params.box_size );
+            node_cut += dirty_atom - range.first;
+        }
+
+        bond_cut = bond_end;
+        while ( bond_cut > range.bond_start && bond_atoms[bond_cut - 1] >= dirty_atom )
+        {
+            bond_cut--;
+        }
+    }
+
+    nodes.erase( nodes.begin() + node_cut, nodes.end() );
+    bonds.erase( bonds.begin() + bond_cut, bonds.end() );
+    bond_atoms.resize( bond_cut );
+
+    appendChain( grid, monomer_list, dirty_chain, qMax( dirty_atom, grid->chains[dirty_chain].first ) );
+
+    for ( int i = dirty_chain + 1; i < grid->max_chains; i++ )
+    {
+        if ( i >= chain_ranges.count() )
+        {
+            chain_ranges.append( newChainRange( &grid->chains[i] ) );
+        }
+
+        chain_ranges[i].node_start = nodes.size();
+        chain_ranges[i].bond_start = bonds.size();
+        appendChain( grid, monomer_list, i, grid->chains[i].first );
+    }
 
-                // v = NormalizePoint( grid, v, gScale );
-                if ( MONOMER == coloration && monomer_list->count() > 0 && -1 != v.monomer_type && v.monomer_type < monomer_list->count() )
-                {
-                    current_col = monomer_list->monomer( v.monomer_type )->color();
-                    current_col.a = 0.4;
-                }
+    // new chains need their palette entries
+    if ( chain_ranges.count() != known_chains )
+    {
+        applyColoration();
+    }
+
+    updateChainStatistics();
+    updateDataTail( node_cut, bond_cut );
+    updateGL();
+}
 
-                nodes.push_back( Atom( i, Triple( v.x, v.y, v.z ), radius, current_col, v.monomer_type, i + 1 ) );
+
+
+void ChainGraph::retypeChains( Grid* grid, MonomerList* monomer_list )
+{
+    // the monomer types in the grid changed, the positions did not
+    bool unchanged = paletteAvailable() && !rebuild_chains && chain_ranges.count() == grid->max_chains;
+
+    for ( int i = 0; i < chain_ranges.count() && unchanged; i++ )
+    {
+        unchanged = ( chain_ranges[i].first == grid->chains[i].first && chain_ranges[i].last == grid->chains[i].last );
+    }
+
+    if ( !unchanged )
+    {
+        drawChains( grid, monomer_list );
+        return;
+    }
+
+    if ( show_monomers )
+    {
+        for ( int i = 0; i < chain_ranges.count(); i++ )
+        {
+            Chain* chain = &grid->chains[i];
+            const ChainRange& range = chain_ranges[i];
+
+            for ( int j = range.first; j < range.last; j++ )
+            {
+                nodes[range.node_start + j - range.first].monomer_type = chain->atoms[j - chain->offset].monomer_type;
             }
-            current_col.a = 1.0;
         }
+    }
 
-        // add bonds
+    recolorChains();
+    applyColoration();
+    updateAttributes();
+    updateGL();
+}
 
-        if ( chain->last - chain->first <= 1 ) continue;
 
-        if ( MONOMER == coloration )
+
+int ChainGraph::nodeEnd( int chainIndex ) const
+{
+    return ( chainIndex + 1 < chain_ranges.count() ) ? chain_ranges[chainIndex + 1].node_start : ( int ) nodes.size();
+}
+
+int ChainGraph::bondEnd( int chainIndex ) const
+{
+    return ( chainIndex + 1 < chain_ranges.count() ) ? chain_ranges[chainIndex + 1].bond_start : ( int ) bonds.size();
+}
+
+int ChainGraph::setChainAlpha( int chainIndex, double alpha )
+{
+    // sets the alpha of the nodes and bonds of one chain, returns its number of nodes
+    if ( chainIndex < 0 || chainIndex >= chain_ranges.count() )
+    {
+        return 0;
+    }
+
+    const ChainRange& range = chain_ranges[chainIndex];
+    int node_end = nodeEnd( chainIndex );
+    int bond_end = bondEnd( chainIndex );
+
+    for ( int j = range.node_start; j < node_end; j++ )
+    {
+        nodes[j].setAlpha( alpha );
+    }
+
+    for ( int k = range.bond_start; k < bond_end; k++ )
+    {
+        bonds[k].setAlpha( alpha );
+    }
+
+    return node_end - range.node_start;
+}
+
+
+
+ChainGraph::ChainRange ChainGraph::newChainRange( Chain* chain )
+{
+    ChainRange range;
+    ColorRing col_ring;
+    col_ring.setRandomColors( true );
+
+    range.first = chain->first;
+    range.last = chain->first;
+    range.node_start = nodes.size();
+    range.bond_start = bonds.size();
+    range.col = col_ring.nextColor();  // kept for switching to CHAIN colouring
+    range.rg = -1.0;
+
+    return range;
+}
+
+
+
+void ChainGraph::appendChain( Grid* grid, MonomerList* monomer_list, int chainIndex, int from )
+{
+    // appends the atoms from atom nr from on, and the bonds ending at them
+    Chain* chain = &grid->chains[chainIndex];
+    ChainRange& range = chain_ranges[chainIndex];
+    RGBA current_col = ( CHAIN == coloration ) ? range.col : Monomer().color();
+    int i = chainIndex;
+
+    range.first = chain->first;
+    range.last = chain->last;
+    range.rg = ( 0 != chain->atoms && chain->first != chain->last ) ? calculateRadiusOfGyration( chain ) : -1.0;
+    Grid_chain_clean( grid, chainIndex );
+
+    // add monomers
+    if ( show_monomers )
+    {
+        current_col.a = 0.4;
+        if ( chain->last - chain->first <= 0 ) return;
+
+        // an untyped monomer keeps the colour of the one before it
+        if ( from > chain->first )
         {
-            current_col = RGBA( 0.5, 0.5, 0.5 );
+            current_col = nodes.back().color();
         }
 
-        for ( int j = chain->first + 1; j < chain->last; j++ )
+        for ( int j = from; j < chain->last; j++ )
         {
             int k = j - chain->offset;
-            Vector v0 = Vector_periodic_box( chain->atoms[k - 1], grid->params.box_size );
-            Vector v1 = Vector_periodic_box( chain->atoms[k], grid->params.box_size );
+            Vector v = Vector_periodic_box( chain->atoms[k], grid->params.box_size );
 
-            if ( fabs( Vector_dist( v0, v1 ) - grid->params.bond_len ) < grid->params.bond_len )
+            if ( MONOMER == coloration && monomer_list->count() > 0 && -1 != v.monomer_type && v.monomer_type < monomer_list->count() )
             {
-                bonds.push_back( Bond( i, Triple( v0.x, v0.y, v0.z ), Triple( v1.x, v1.y, v1.z ), current_col ) );
+                current_col = monomer_list->monomer( v.monomer_type )->color();
+                current_col.a = 0.4;
             }
-            else
+
+            nodes.push_back( RenderNode( i, Triple( v.x, v.y, v.z ), chain_radius, current_col, v.monomer_type, i + 1 ) );
+        }
+        current_col.a = 1.0;
+    }
+
+    // add bonds
+
+    if ( chain->last - chain->first <= 1 ) return;
+
+    if ( MONOMER == coloration )
+    {
+        current_col = RGBA( 0.5, 0.5, 0.5 );
+    }
+
+    // consecutive bonds share their wrapped end points, so the plot joins them into one polyline
+    int start = qMax( from, chain->first + 1 );
+    Vector v0 = Vector_periodic_box( chain->atoms[start - 1 - chain->offset], grid->params.box_size );
+
+    for ( int j = start; j < chain->last; j++ )
+    {
+        int k = j - chain->offset;
+        Vector v1 = Vector_periodic_box( chain->atoms[k], grid->params.box_size );
+
+        if ( fabs( Vector_dist( v0, v1 ) - grid->params.bond_len ) < grid->params.bond_len )
+        {
+            bonds.push_back( RenderBond( i, Triple( v0.x, v0.y, v0.z ), Triple( v1.x, v1.y, v1.z ), current_col ) );
+            bond_atoms.append( j );
+        }
+        else
+        {
+            // split at the periodic boundary, each half sticks out of the box
+            Vector v = Vector_diff( chain->atoms[k], chain->atoms[k - 1] );
+            Vector v_out = Vector_sum( v0, v );
+            bonds.push_back( RenderBond( i, Triple( v0.x, v0.y, v0.z ), Triple( v_out.x, v_out.y, v_out.z ), current_col ) );
+
+            Vector v_in = Vector_diff( v1, v );
+            bonds.push_back( RenderBond( i, Triple( v_in.x, v_in.y, v_in.z ), Triple( v1.x, v1.y, v1.z ), current_col ) );
+            bond_atoms.append( j );
+            bond_atoms.append( j );
+        }
+
+        v0 = v1;
+    }
+}
+
+
+
+void ChainGraph::updateChainStatistics()
+{
+    // chain count and average radius of gyration from the per chain values
+    float sum = 0;
+    int num_chains = 0;
+
+    chain_count = 0;
+
+    for ( int i = 0; i < chain_ranges.count(); i++ )
+    {
+        if ( 0.0 <= chain_ranges[i].rg )
+        {
+            sum += chain_ranges[i].rg;
+            num_chains++;
+        }
+
+        if ( show_monomers && chain_ranges[i].last > chain_ranges[i].first )
+        {
+            chain_count++;
+        }
+    }
+
+    avg_radius_of_gyration = sum / ( float ) num_chains;
+}
+
+
+
+void ChainGraph::recolorChains()
+{
+    // sets the colours of nodes and bonds as appendChain() would for the current colouring,
+    // keeping their alpha; only the styles drawn without the palettes show them
+    for ( int i = 0; i < chain_ranges.count(); i++ )
+    {
+        const ChainRange& range = chain_ranges[i];
+        int node_end = nodeEnd( i );
+        int bond_end = bondEnd( i );
+        RGBA current_col = ( CHAIN == coloration ) ? range.col : Monomer().color();
+
+        for ( int j = range.node_start; j < node_end; j++ )
+        {
+            int type = nodes[j].monomer_type;
+
+            if ( MONOMER == coloration && -1 != type && type < monomer_list->count() )
             {
-                Vector v = Vector_diff( chain->atoms[k], chain->atoms[k - 1] );
-                Vector v0 = Vector_periodic_box( chain->atoms[k - 1], grid->params.box_size );
-                Vector v1 = Vector_sum( v0, v );
-                bonds.push_back( Bond( i, Triple( v0.x, v0.y, v0.z ), Triple( v1.x, v1.y, v1.z ), current_col ) );
-
-                v0 = Vector_periodic_box( chain->atoms[k], grid->params.box_size );
-                v1 = Vector_diff( v0, v );
-                bonds.push_back( Bond( i, Triple( v0.x, v0.y, v0.z ), Triple( v1.x, v1.y, v1.z ), current_col ) );
+                current_col = monomer_list->monomer( type )->color();
             }
+
+            current_col.a = nodes[j].color().a;
+            nodes[j].setColor( current_col );
+        }
+
+        if ( MONOMER == coloration )
+        {
+            current_col = RGBA( 0.5, 0.5, 0.5 );
         }
 
+        for ( int k = range.bond_start; k < bond_end; k++ )
+        {
+            current_col.a = bonds[k].color().a;
+            bonds[k].setColor( current_col );
+        }
     }
+}
 
-    chain_count = count;
-    avg_radius_of_gyration = avgRadiusOfGyration( grid );
-    refreshChains();
+
+
+void ChainGraph::applyColoration()
+{
+    // the impostors look the colouring up in palettes indexed by chain and monomer type
+    std::vector<RGBA> chain_colors( chain_ranges.count(), Monomer().color() );
+    std::vector<RGBA> type_colors;
+
+    if ( CHAIN == coloration )
+    {
+        for ( int i = 0; i < chain_ranges.count(); i++ )
+        {
+            chain_colors[i] = chain_ranges[i].col;
+        }
+    }
+
+    for ( int i = 0; i < monomer_list->count(); i++ )
+    {
+        type_colors.push_back( monomer_list->monomer( i )->color() );
+    }
+
+    setChainPalette( chain_colors );
+    setTypePalette( type_colors, RGBA( 0.5, 0.5, 0.5 ) );
+    setColorSource( ( MONOMER == coloration ) ? TYPECOLORS : CHAINCOLORS );
 }
 
+
+
 void ChainGraph::setSpaceFilling( bool b )
 {
     space_filling = b;
@@ -378,9 +850,29 @@ void ChainGraph::setSpaceFilling( bool b )
 
 void ChainGraph::setShowMonomer( bool b )
 {
+    if ( b != show_monomers ) rebuild_chains = true;
     show_monomers = b;
 }
 
+void ChainGraph::setColoration( enum COLORATION c )
+{
+    if ( c == coloration ) return;
+
+    coloration = c;
+
+    if ( paletteAvailable() && !rebuild_chains )
+    {
+        // the impostors switch palettes, nothing is redrawn
+        recolorChains();
+        applyColoration();
+        updateGL();
+    }
+    else
+    {
+        rebuild_chains = true;
+    }
+}
+
 void ChainGraph::updateTitle()
 {
     //   Triple dim = hull().maxVertex - hull().minVertex;
@@ -388,6 +880,12 @@ void ChainGraph::updateTitle()
     setTitle( QString( "Monomers: %1, Bonds: %2, Chains: %3" ).arg( nodes.size() ).arg( bonds.size() ).arg( chain_count ) );
 }
 
+void ChainGraph::setBondLines( bool b )
+{
+    setBondStyle( b ? LINES : CYLINDERS );
+    updateGL();
+}
+
 void ChainGraph::showDefaultView()
 {
     setRotation( 30, 0, 15 );
@@ -428,6 +926,56 @@ void ChainGraph::saveSnapshot()
 
 
 
+void ChainGraph::showCrossSectionDialog()
+{
+    CrossSectionDialog dlg( this, node_hull, this );
+
+    dlg.exec();
+}
+
+
+
+bool ChainGraph::renderSnapshot( const QString& fileName, int width, int height )
+{
+    // ray-cast without OpenGL, so that batch runs never need to show the widget
+    SnapshotRenderer renderer( width, height );
+
+    renderer.setCamera( *this );
+    renderer.setScene( nodes, bonds, bondRadius(), chainVisibility(), cell_width );
+
+    return renderer.render().save( fileName, "png" );
+}
+
+
+
+bool ChainGraph::showView( const QString& name )
+{
+    if ( "default" == name )
+    {
+        showDefaultView();
+    }
+    else if ( "top" == name )
+    {
+        showTopView();
+    }
+    else if ( "front" == name )
+    {
+        showFrontView();
+    }
+    else if ( "side" == name )
+    {
+        showSideView();
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+
 void ChainGraph::configure()
 {
     enableLighting();
@@ -555,6 +1103,21 @@ float ChainGraph::calculateEndToEndDistance( Chain* chain )
 }
 
 
+float ChainGraph::chainRadiusOfGyration( Grid* grid, int chainIndex )
+{
+    // a drawn chain that did not change since keeps the value appendChain() found
+    Chain* chain = &grid->chains[chainIndex];
+
+    if ( chainIndex < chain_ranges.count() && NO_ATOM == chain->dirty && 0.0 <= chain_ranges[chainIndex].rg
+            && chain_ranges[chainIndex].first == chain->first && chain_ranges[chainIndex].last == chain->last )
+    {
+        return chain_ranges[chainIndex].rg;
+    }
+
+    return calculateRadiusOfGyration( chain );
+}
+
+
 float ChainGraph::avgRadiusOfGyration( Grid* grid )
 {
     float sum = 0;
@@ -567,7 +1130,7 @@ float ChainGraph::avgRadiusOfGyration( Grid* grid )
 
         if ( 0 != chain && 0 != chain->atoms && chain->first != chain->last )
         {
-            double rg = calculateRadiusOfGyration( chain );
+            double rg = chainRadiusOfGyration( grid, i );
             sum += rg;
             qDebug() << QString( "%1,%2" ).arg( i ).arg( rg );
             num_chains++;
@@ -31,6 +31,7 @@
 #include "monomerlist.h"
 #include "monomersequence.h"
 #include "additivelist.h"
+#include "speciesstore.h"
 
 #include <QMenu>
 
@@ -49,25 +50,33 @@ public:
 
     void configure();
     void drawChains( Grid* grid, MonomerList* list );
+    void updateChains( Grid* grid, MonomerList* list );
+    void retypeChains( Grid* grid, MonomerList* list );
     void drawPointCloud( Parameters& gParams, int num_particles,  MonomerSequence* sequence, AdditiveList* additiveList );
     void recolorPointCloud( MonomerSequence* sequence, AdditiveList* additiveList );
     void setShowMonomer( bool b );
     void setSpaceFilling( bool b );
     void scanChains( int numChains );
     void refreshChains();
+    void applySpecies( const SpeciesStore& species, const MonomerList* list );
     void clear();
-    void setColoration( enum COLORATION c ) { coloration = c;}
-    AtomVector& monomerArray() { return nodes;}
+    void setColoration( enum COLORATION c );
+    RenderNodeVector& monomerArray() { return nodes;}
     const MonomerCount& monomerCount() { return monomer_count; }
     const MonomerCount& updateMonomerCount( int numMonomers );
     float avgRadiusOfGyration() const { return avg_radius_of_gyration; }
     float avgRadiusOfGyration( Grid* grid );
     float avgEndToEndDistance( Grid* grid );
+    bool showView( const QString& name );
+    bool renderSnapshot( const QString& fileName, int width, int height );
 
 protected:
     MainWindow* main_win;
-    AtomVector nodes;
-    BondVector bonds;
+    std::shared_ptr<RenderNodeVector> node_buffer;
+    std::shared_ptr<RenderBondVector> bond_buffer;
+    RenderNodeVector& nodes;  // the buffers are shared with the plot, not copied
+    RenderBondVector& bonds;
+    ParallelEpiped node_hull;
     int chain_count;
     bool show_monomers;
     bool space_filling;
@@ -78,9 +87,40 @@ protected:
     float avg_radius_of_gyration;
     int current_scanned_chain;
 
+    // what drawChains() put into nodes and bonds for each chain, so that
+    // updateChains() redraws only what changed since the last frame; the
+    // starts are an offset table, chain i owns the nodes from node_start to
+    // nodeEnd( i ) and the bonds from bond_start to bondEnd( i )
+    struct ChainRange
+    {
+        int first;       // atom nrs drawn
+        int last;
+        int node_start;  // index of the first node and bond of the chain
+        int bond_start;
+        RGBA col;
+        float rg;        // radius of gyration, negative for an empty chain
+    };
+    QVector<ChainRange> chain_ranges;
+    QVector<int> bond_atoms;  // atom nr each bond ends at
+    bool rebuild_chains;      // hidden or recoloured, the next update has to redraw everything
+    int isolated_chain;       // the only chain scanChains() left opaque in nodes and bonds, -1 if none
+    double chain_radius;
+    Triple cell_width;        // of the packing, zero for a point cloud
+
     virtual void contextMenuEvent( QContextMenuEvent* event );
     Vector NormalizePoint( Grid* grid, Vector v, float gScale );
     void updateTitle();
+    void shareDataset();
+    ChainRange newChainRange( Chain* chain );
+    int nodeEnd( int chainIndex ) const;
+    int bondEnd( int chainIndex ) const;
+    int setChainAlpha( int chainIndex, double alpha );
+    float chainRadiusOfGyration( Grid* grid, int chainIndex );
+    void appendChain( Grid* grid, MonomerList* list, int chainIndex, int from );
+    void updateChainStatistics();
+    void recolorChains();
+    void applyColoration();
+    void colorPointCloud( MonomerSequence* sequence, AdditiveList* additiveList );
     Vector calculateCenterOfMMass( Chain* chain );
     float calculateRadiusOfGyration( Chain* chain );
     float calculateEndToEndDistance( Chain* chain );
@@ -91,6 +131,8 @@ protected slots:
     void showFrontView();
     void showSideView();
     void saveSnapshot();
+    void showCrossSectionDialog();
+    void setBondLines( bool b );
 };
 
 #endif // CHAINGRAPH_H
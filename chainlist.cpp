@@ -203,6 +203,17 @@ int ChainList::totalAdditiveChainCount() const
 
 
 
+void ChainList::restore( const QVector<int>& lengths, const QVector<int>& additiveCounts, bool prepended )
+{
+    // reinstates a chain list saved with a packing checkpoint
+
+    chain_vec = lengths;
+    additive_chain_count = additiveCounts;
+    additives_prepended = prepended;
+}
+
+
+
 void ChainList::initialize()
 {
     const double PI = 3.14159265;
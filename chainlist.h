@@ -44,6 +44,9 @@ public:
     int numAdditives() const { return additive_chain_count.count();}
     void prependAdditives( bool b ) { additives_prepended = b;}
     bool additivesPrepended() const { return additives_prepended; }
+    const QVector<int>& chainLengths() const { return chain_vec; }
+    const QVector<int>& additiveChainCounts() const { return additive_chain_count; }
+    void restore( const QVector<int>& lengths, const QVector<int>& additiveCounts, bool prepended );
 
 protected:
     int num_monomers;
@@ -0,0 +1,121 @@
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include "crosssectiondialog.h"
+#include "ui_crosssectiondialog.h"
+
+#include <QPushButton>
+
+using namespace Qwt3D;
+
+CrossSectionDialog::CrossSectionDialog( GraphPlot* plot, const ParallelEpiped& box, QWidget* parent ) :
+    QDialog( parent ),
+    ui( new Ui::CrossSectionDialog ),
+    graph( plot )
+{
+    ui->setupUi( this );
+
+    QDoubleSpinBox* from[3] = { ui->xFromSpinBox, ui->yFromSpinBox, ui->zFromSpinBox };
+    QDoubleSpinBox* to[3] = { ui->xToSpinBox, ui->yToSpinBox, ui->zToSpinBox };
+    QCheckBox* slab[3] = { ui->xCheckBox, ui->yCheckBox, ui->zCheckBox };
+
+    const double min[3] = { box.minVertex.x, box.minVertex.y, box.minVertex.z };
+    const double max[3] = { box.maxVertex.x, box.maxVertex.y, box.maxVertex.z };
+
+    // an open clip box is clamped to the box, so its open axes start unchecked
+    const ParallelEpiped& clip = graph->clipBox();
+    const double clip_min[3] = { clip.minVertex.x, clip.minVertex.y, clip.minVertex.z };
+    const double clip_max[3] = { clip.maxVertex.x, clip.maxVertex.y, clip.maxVertex.z };
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        from[i]->setRange( min[i], max[i] );
+        to[i]->setRange( min[i], max[i] );
+        from[i]->setValue( min[i] );
+        to[i]->setValue( max[i] );
+
+        if ( graph->clipped() && ( min[i] < clip_min[i] || clip_max[i] < max[i] ) )
+        {
+            slab[i]->setChecked( true );
+            from[i]->setValue( qMax( min[i], clip_min[i] ) );
+            to[i]->setValue( qMin( max[i], clip_max[i] ) );
+        }
+    }
+
+    connect( ui->buttonBox->button( QDialogButtonBox::Apply ), SIGNAL( clicked( bool ) ), this, SLOT( applyButtonClicked() ) );
+    connect( ui->buttonBox->button( QDialogButtonBox::Reset ), SIGNAL( clicked( bool ) ), this, SLOT( resetButtonClicked() ) );
+}
+
+CrossSectionDialog::~CrossSectionDialog()
+{
+    delete ui;
+}
+
+
+
+void CrossSectionDialog::applyButtonClicked()
+{
+    if ( false == ui->xCheckBox->isChecked() && false == ui->yCheckBox->isChecked() && false == ui->zCheckBox->isChecked() )
+    {
+        resetButtonClicked();
+        return;
+    }
+
+    // unchecked axes are not cut at all
+    const double OPEN = 1e30;
+
+    Triple min( -OPEN, -OPEN, -OPEN );
+    Triple max( OPEN, OPEN, OPEN );
+
+    if ( ui->xCheckBox->isChecked() )
+    {
+        min.x = qMin( ui->xFromSpinBox->value(), ui->xToSpinBox->value() );
+        max.x = qMax( ui->xFromSpinBox->value(), ui->xToSpinBox->value() );
+    }
+    if ( ui->yCheckBox->isChecked() )
+    {
+        min.y = qMin( ui->yFromSpinBox->value(), ui->yToSpinBox->value() );
+        max.y = qMax( ui->yFromSpinBox->value(), ui->yToSpinBox->value() );
+    }
+    if ( ui->zCheckBox->isChecked() )
+    {
+        min.z = qMin( ui->zFromSpinBox->value(), ui->zToSpinBox->value() );
+        max.z = qMax( ui->zFromSpinBox->value(), ui->zToSpinBox->value() );
+    }
+
+    graph->setClipBox( ParallelEpiped( min, max ) );
+    graph->updateGL();
+}
+
+
+
+void CrossSectionDialog::resetButtonClicked()
+{
+    ui->xCheckBox->setChecked( false );
+    ui->yCheckBox->setChecked( false );
+    ui->zCheckBox->setChecked( false );
+
+    graph->clearClipBox();
+    graph->updateGL();
+}
@@ -0,0 +1,317 @@
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include "deprotectionprofile.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <math.h>
+
+
+DeprotectionProfile::DeprotectionProfile( double slabWidth, double rowWidth, double edgeThreshold ) :
+    slab_width( slabWidth ),
+    row_width( rowWidth ),
+    threshold( edgeThreshold ),
+    axis( 0 ),
+    origin( 0.0 ),
+    num_rows( 0 ),
+    rows_used( 0 ),
+    edges_per_row( 0 ),
+    mean_line_width( 0.0 ),
+    line_edge_roughness( 0.0 ),
+    line_width_roughness( 0.0 ),
+    slab_protected(),
+    slab_deprotected(),
+    slab_dose()
+{
+}
+
+
+
+double DeprotectionProfile::extent( int slab ) const
+{
+    int total = slab_protected.at( slab ) + slab_deprotected.at( slab );
+    return ( 0 < total ) ? ( double ) slab_deprotected.at( slab ) / total : 0.0;
+}
+
+
+
+void DeprotectionProfile::findEdges( const int* prot, const int* deprot, int first, bool periodic, QVector<double>& edges, QVector<char>& falling ) const
+{
+    int num_slabs = slab_protected.count();
+
+    edges.clear();
+    falling.clear();
+
+    bool has_previous = false;
+    double previous_extent = 0.0;
+    double previous_position = 0.0;
+
+    // a periodic row is scanned once around, back to the slab it started from
+    int last = periodic ? num_slabs : num_slabs - 1;
+
+    for ( int k = 0; k <= last; k++ )
+    {
+        int s = ( first + k ) % num_slabs;
+        int total = prot[s] + deprot[s];
+
+        if ( 0 == total )
+        {
+            continue;
+        }
+
+        double f = ( double ) deprot[s] / total;
+        double pos = origin + ( first + k + 0.5 ) * slab_width;
+
+        if ( has_previous && ( previous_extent >= threshold ) != ( f >= threshold ) )
+        {
+            edges.append( previous_position + ( threshold - previous_extent ) / ( f - previous_extent ) * ( pos - previous_position ) );
+            falling.append( f < threshold );
+        }
+
+        has_previous = true;
+        previous_extent = f;
+        previous_position = pos;
+    }
+}
+
+
+
+bool DeprotectionProfile::compute( const SpeciesStore& species, int protectedType, int deprotectedType, const PeriodicBox& box, const DoseMap& doseMap )
+{
+    if ( slab_width <= 0.0 || row_width <= 0.0 )
+    {
+        return false;
+    }
+
+    axis = doseMap.axis();
+
+    // rows run along the next in-plane axis
+    int row_axis = ( 0 == axis ) ? 1 : 0;
+
+    origin = box.lower( axis );
+
+    int num_slabs = qMax( 1, ( int ) ceil( box.length( axis ) / slab_width ) );
+    num_rows = qMax( 1, ( int ) ceil( box.length( row_axis ) / row_width ) );
+
+    slab_protected.fill( 0, num_slabs );
+    slab_deprotected.fill( 0, num_slabs );
+    slab_dose.fill( 0.0, num_slabs );
+
+    QVector<int> row_protected( num_rows * num_slabs, 0 );
+    QVector<int> row_deprotected( num_rows * num_slabs, 0 );
+
+    int num_groups = 0;
+
+    for ( int i = 0; i < species.count(); i++ )
+    {
+        int type = species.monomerType( i );
+
+        if ( protectedType != type && deprotectedType != type )
+        {
+            continue;
+        }
+
+        Qwt3D::Triple p = species.position( i );
+        double v[3] = { p.x, p.y, p.z };
+
+        int s = qBound( 0, ( int ) floor( ( v[axis] - origin ) / slab_width ), num_slabs - 1 );
+        int r = qBound( 0, ( int ) floor( ( v[row_axis] - box.lower( row_axis ) ) / row_width ), num_rows - 1 );
+
+        if ( deprotectedType == type )
+        {
+            slab_deprotected[s]++;
+            row_deprotected[r * num_slabs + s]++;
+        }
+        else
+        {
+            slab_protected[s]++;
+            row_protected[r * num_slabs + s]++;
+        }
+
+        num_groups++;
+    }
+
+    // the aerial image through the middle of the box
+    for ( int s = 0; s < num_slabs; s++ )
+    {
+        double c[3];
+        for ( int a = 0; a < 3; a++ )
+        {
+            c[a] = box.lower( a ) + 0.5 * box.length( a );
+        }
+
+        c[axis] = position( s );
+        slab_dose[s] = doseMap.dose( box, Qwt3D::Triple( c[0], c[1], c[2] ) );
+    }
+
+    rows_used = 0;
+    edges_per_row = 0;
+    mean_line_width = 0.0;
+    line_edge_roughness = 0.0;
+    line_width_roughness = 0.0;
+
+    if ( 0 == num_groups )
+    {
+        return false;
+    }
+
+    // start every row in the most deprotected slab, the middle of a space
+    int first = 0;
+    bool periodic = box.isPeriodic( axis );
+
+    if ( periodic )
+    {
+        for ( int s = 1; s < num_slabs; s++ )
+        {
+            if ( extent( s ) > extent( first ) ) first = s;
+        }
+    }
+
+    QVector< QVector<double> > row_edges( num_rows );
+    QVector< QVector<char> > row_falling( num_rows );
+    QVector<int> edge_count_rows( 2 * num_slabs + 2, 0 );
+
+    for ( int r = 0; r < num_rows; r++ )
+    {
+        findEdges( row_protected.constData() + r * num_slabs, row_deprotected.constData() + r * num_slabs, first, periodic, row_edges[r], row_falling[r] );
+        edge_count_rows[qMin( row_edges[r].count(), edge_count_rows.count() - 1 )]++;
+    }
+
+    // rows with a different number of edges have a bridge or a break, they do not enter the statistics
+    for ( int n = 1; n < edge_count_rows.count(); n++ )
+    {
+        if ( 0 < edge_count_rows[n] && ( 0 == edges_per_row || edge_count_rows[n] > edge_count_rows[edges_per_row] ) )
+        {
+            edges_per_row = n;
+        }
+    }
+
+    if ( 0 == edges_per_row )
+    {
+        return true;
+    }
+
+    QVector<int> used;
+    for ( int r = 0; r < num_rows; r++ )
+    {
+        if ( row_edges[r].count() == edges_per_row ) used.append( r );
+    }
+
+    rows_used = used.count();
+
+    if ( 2 > rows_used )
+    {
+        return true;
+    }
+
+    double edge_variance = 0.0;
+
+    for ( int k = 0; k < edges_per_row; k++ )
+    {
+        double sum = 0.0;
+        double sum_sq = 0.0;
+
+        for ( int u = 0; u < rows_used; u++ )
+        {
+            double e = row_edges[used[u]][k];
+            sum += e;
+            sum_sq += e * e;
+        }
+
+        double mean = sum / rows_used;
+        edge_variance += qMax( 0.0, ( sum_sq - rows_used * mean * mean ) / ( rows_used - 1 ) );
+    }
+
+    line_edge_roughness = 3.0 * sqrt( edge_variance / edges_per_row );
+
+    // a line runs from a falling edge to the next rising one
+    double width_variance = 0.0;
+    double width_sum = 0.0;
+    int num_lines = 0;
+    int num_widths = 0;
+
+    for ( int k = 0; k + 1 < edges_per_row; k++ )
+    {
+        double sum = 0.0;
+        double sum_sq = 0.0;
+        int n = 0;
+
+        for ( int u = 0; u < rows_used; u++ )
+        {
+            const QVector<char>& falling = row_falling[used[u]];
+
+            if ( falling[k] && false == falling[k + 1] )
+            {
+                double w = row_edges[used[u]][k + 1] - row_edges[used[u]][k];
+                sum += w;
+                sum_sq += w * w;
+                n++;
+            }
+        }
+
+        if ( 1 < n )
+        {
+            double mean = sum / n;
+            width_variance += qMax( 0.0, ( sum_sq - n * mean * mean ) / ( n - 1 ) );
+            width_sum += sum;
+            num_widths += n;
+            num_lines++;
+        }
+    }
+
+    if ( 0 < num_lines )
+    {
+        mean_line_width = width_sum / num_widths;
+        line_width_roughness = 3.0 * sqrt( width_variance / num_lines );
+    }
+
+    return true;
+}
+
+
+
+bool DeprotectionProfile::writeCSV( const QString& fileName ) const
+{
+    QFile file( fileName );
+
+    if ( false == file.open( QFile::WriteOnly | QFile::Truncate ) )
+    {
+        return false;
+    }
+
+    QTextStream out( &file );
+
+    out << "position,dose,protecting_groups,deprotected,extent\n";
+
+    for ( int s = 0; s < slab_protected.count(); s++ )
+    {
+        out << position( s ) << "," << slab_dose.at( s ) << "," << slab_protected.at( s ) + slab_deprotected.at( s ) << ","
+            << slab_deprotected.at( s ) << "," << extent( s ) << "\n";
+    }
+
+    out.flush();
+
+    return QFile::NoError == file.error();
+}
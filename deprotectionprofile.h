@@ -0,0 +1,84 @@
+#ifndef DEPROTECTIONPROFILE_H
+#define DEPROTECTIONPROFILE_H
+
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include <QVector>
+#include <QString>
+
+#include "spatialindex.h"
+#include "speciesstore.h"
+#include "dosemap.h"
+
+// Latent image of a patterned exposure. The extent of deprotection is
+// binned in slabs across the pattern axis, once for the whole box and once
+// per row along the next in-plane axis. In every row an edge sits where the
+// extent crosses the threshold (interpolated between slabs), and a line is
+// the protected stretch between a falling and the following rising edge.
+// Line edge and line width roughness are three sigma of the edge
+// positions and line widths over the rows that show the common number of
+// edges.
+
+class DeprotectionProfile
+{
+public:
+    DeprotectionProfile( double slabWidth, double rowWidth, double threshold );
+
+    bool compute( const SpeciesStore& species, int protectedType, int deprotectedType, const PeriodicBox& box, const DoseMap& doseMap );
+
+    int slabCount() const { return slab_protected.count(); }
+    double position( int slab ) const { return origin + ( slab + 0.5 ) * slab_width; }
+    double extent( int slab ) const;
+
+    int rowCount() const { return num_rows; }
+    int rowsUsed() const { return rows_used; }
+    int edgesPerRow() const { return edges_per_row; }
+    double meanLineWidth() const { return mean_line_width; }
+    double lineEdgeRoughness() const { return line_edge_roughness; }
+    double lineWidthRoughness() const { return line_width_roughness; }
+
+    bool writeCSV( const QString& fileName ) const;
+
+protected:
+    double slab_width;
+    double row_width;
+    double threshold;
+    int axis;
+    double origin;
+    int num_rows;
+    int rows_used;
+    int edges_per_row;
+    double mean_line_width;
+    double line_edge_roughness;
+    double line_width_roughness;
+
+    QVector<int> slab_protected;
+    QVector<int> slab_deprotected;
+    QVector<double> slab_dose;
+
+    void findEdges( const int* prot, const int* deprot, int first, bool periodic, QVector<double>& edges, QVector<char>& falling ) const;
+};
+
+#endif // DEPROTECTIONPROFILE_H
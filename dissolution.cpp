@@ -0,0 +1,489 @@
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include "dissolution.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+#include <math.h>
+
+const int MIN_MONOMERS_PER_TASK = 2000;
+
+
+DissolutionAnalysis::DissolutionAnalysis( double contactRadius, double binWidth ) :
+    contact_radius( contactRadius ),
+    bin_width( binWidth ),
+    num_monomers( 0 ),
+    num_dissolved_monomers( 0 ),
+    num_dissolved_chains( 0 ),
+    num_dissolved_clusters( 0 ),
+    mean_height( 0.0 ),
+    surface_roughness( 0.0 ),
+    line_rows( 0 ),
+    mean_line_width( 0.0 ),
+    line_edge_roughness( 0.0 ),
+    line_width_roughness( 0.0 ),
+    chain_cluster(),
+    cluster_chains(),
+    cluster_monomers(),
+    cluster_top()
+{
+}
+
+
+
+int DissolutionAnalysis::findRoot( QVector<int>& parent, int c )
+{
+    // path halving keeps the trees flat without a second pass
+    while ( parent[c] != c )
+    {
+        parent[c] = parent[parent[c]];
+        c = parent[c];
+    }
+
+    return c;
+}
+
+
+
+void DissolutionAnalysis::join( QVector<int>& parent, int a, int b )
+{
+    int root_a = findRoot( parent, a );
+    int root_b = findRoot( parent, b );
+
+    // the smaller chain index becomes the root, so the result does not depend on the order of the joins
+    if ( root_a < root_b )
+    {
+        parent[root_b] = root_a;
+    }
+    else if ( root_b < root_a )
+    {
+        parent[root_a] = root_b;
+    }
+}
+
+
+
+bool DissolutionAnalysis::compute( const SpeciesStore& species, const QVector<char>& solubleChains, const PeriodicBox& box )
+{
+    num_monomers = species.count();
+    num_dissolved_monomers = 0;
+    num_dissolved_chains = 0;
+    num_dissolved_clusters = 0;
+
+    int num_chains = species.maxChainIndex();
+
+    chain_cluster.fill( -1, num_chains + 1 );
+    cluster_chains.clear();
+    cluster_monomers.clear();
+    cluster_top.clear();
+
+    if ( 0 == num_monomers || contact_radius <= 0.0 || bin_width <= 0.0 )
+    {
+        return false;
+    }
+
+    // the developer comes in from the top, so z never wraps here
+    PeriodicBox open_box( Qwt3D::Triple( box.lower( 0 ), box.lower( 1 ), box.lower( 2 ) ),
+                          Qwt3D::Triple( box.lower( 0 ) + box.length( 0 ), box.lower( 1 ) + box.length( 1 ), box.lower( 2 ) + box.length( 2 ) ),
+                          box.isPeriodic( 0 ), box.isPeriodic( 1 ), false );
+
+    double bottom = species.position( 0 ).z;
+    double top = bottom;
+
+    int nx = qMax( 1, ( int ) ceil( open_box.length( 0 ) / bin_width ) );
+    int ny = qMax( 1, ( int ) ceil( open_box.length( 1 ) / bin_width ) );
+
+    // top of the insoluble material in each column, the developer reaches everything above it
+    QVector<double> insoluble_top( nx * ny, -HUGE_VAL );
+
+    QVector<int> soluble_indices;
+    QVector<Qwt3D::Triple> positions;
+
+    for ( int i = 0; i < num_monomers; i++ )
+    {
+        Qwt3D::Triple p = species.position( i );
+
+        bottom = qMin( bottom, p.z );
+        top = qMax( top, p.z );
+
+        int chain = species.chainIndex( i );
+
+        if ( 0 < chain && chain < solubleChains.count() && solubleChains.at( chain ) )
+        {
+            soluble_indices.append( i );
+            positions.append( p );
+        }
+        else
+        {
+            double& h = insoluble_top[columnOf( p, open_box, nx, ny )];
+            h = qMax( h, p.z );
+        }
+    }
+
+    int num_soluble = soluble_indices.count();
+
+    QVector<int> parent( num_chains + 1 );
+    for ( int c = 0; c <= num_chains; c++ )
+    {
+        parent[c] = c;
+    }
+
+    if ( 0 < num_soluble )
+    {
+        SpatialIndex index;
+        index.build( open_box, contact_radius, positions );
+
+        // each task joins the contacts of a contiguous range of soluble
+        // monomers in a forest of its own, the forests are merged afterwards
+
+        int num_tasks = QThread::idealThreadCount();
+
+        int max_tasks = ( num_soluble + MIN_MONOMERS_PER_TASK - 1 ) / MIN_MONOMERS_PER_TASK;
+        if ( num_tasks > max_tasks ) num_tasks = max_tasks;
+        if ( num_tasks < 1 ) num_tasks = 1;
+
+        QVector< QVector<int> > local( num_tasks );
+        QVector<int>* local_parent = local.data();
+
+        QVector<int> tasks;
+        for ( int i = 0; i < num_tasks; i++ )
+        {
+            tasks.append( i );
+        }
+
+        const double cutoff = contact_radius;
+
+        QtConcurrent::blockingMap( tasks, [&]( int & task )
+        {
+            QVector<int>& forest = local_parent[task];
+            forest = parent;
+
+            QVector<int> nearby;
+
+            int first = ( qint64 ) num_soluble * task / num_tasks;
+            int last = ( qint64 ) num_soluble * ( task + 1 ) / num_tasks;
+
+            for ( int n = first; n < last; n++ )
+            {
+                const Qwt3D::Triple& p = positions.at( n );
+                int chain = species.chainIndex( soluble_indices.at( n ) );
+
+                index.candidates( p, cutoff, nearby );
+
+                for ( int k = 0; k < nearby.count(); k++ )
+                {
+                    int m = nearby.at( k );
+
+                    // every pair is seen from both ends, the lower one handles it
+                    if ( m <= n )
+                    {
+                        continue;
+                    }
+
+                    int other_chain = species.chainIndex( soluble_indices.at( m ) );
+
+                    if ( findRoot( forest, chain ) == findRoot( forest, other_chain ) )
+                    {
+                        continue;
+                    }
+
+                    Qwt3D::Triple d = open_box.separation( p, positions.at( m ) );
+
+                    if ( sqrt( d.x * d.x + d.y * d.y + d.z * d.z ) <= cutoff )
+                    {
+                        join( forest, chain, other_chain );
+                    }
+                }
+            }
+        } );
+
+        for ( int t = 0; t < num_tasks; t++ )
+        {
+            for ( int c = 1; c <= num_chains; c++ )
+            {
+                int root = findRoot( local[t], c );
+
+                if ( root != c )
+                {
+                    join( parent, c, root );
+                }
+            }
+        }
+    }
+
+    // number the clusters in order of their lowest chain index
+    QVector<int> root_cluster( num_chains + 1, -1 );
+
+    for ( int c = 1; c <= num_chains; c++ )
+    {
+        if ( c < solubleChains.count() && solubleChains.at( c ) )
+        {
+            int root = findRoot( parent, c );
+
+            if ( 0 > root_cluster[root] )
+            {
+                root_cluster[root] = cluster_chains.count();
+                cluster_chains.append( 0 );
+                cluster_monomers.append( 0 );
+                cluster_top.append( false );
+            }
+
+            chain_cluster[c] = root_cluster[root];
+            cluster_chains[chain_cluster[c]]++;
+        }
+    }
+
+    // a cluster dissolves when any of its monomers is open to the top of its column, insoluble
+    // material less than the contact radius above it sits beside it rather than on it
+    for ( int n = 0; n < num_soluble; n++ )
+    {
+        const Qwt3D::Triple& p = positions.at( n );
+        int cluster = chain_cluster[species.chainIndex( soluble_indices.at( n ) )];
+
+        cluster_monomers[cluster]++;
+
+        if ( p.z + contact_radius >= insoluble_top.at( columnOf( p, open_box, nx, ny ) ) )
+        {
+            cluster_top[cluster] = true;
+        }
+    }
+
+    for ( int k = 0; k < cluster_chains.count(); k++ )
+    {
+        if ( cluster_top[k] )
+        {
+            num_dissolved_clusters++;
+            num_dissolved_chains += cluster_chains[k];
+            num_dissolved_monomers += cluster_monomers[k];
+        }
+    }
+
+    measureRemaining( species, open_box, bottom, top );
+
+    return true;
+}
+
+
+
+int DissolutionAnalysis::columnOf( const Qwt3D::Triple& p, const PeriodicBox& box, int nx, int ny ) const
+{
+    int bx = qBound( 0, ( int ) floor( ( p.x - box.lower( 0 ) ) / bin_width ), nx - 1 );
+    int by = qBound( 0, ( int ) floor( ( p.y - box.lower( 1 ) ) / bin_width ), ny - 1 );
+
+    return by * nx + bx;
+}
+
+
+
+void DissolutionAnalysis::measureRemaining( const SpeciesStore& species, const PeriodicBox& box, double bottom, double top )
+{
+    int nx = qMax( 1, ( int ) ceil( box.length( 0 ) / bin_width ) );
+    int ny = qMax( 1, ( int ) ceil( box.length( 1 ) / bin_width ) );
+
+    // height of the remaining material in each column, bare substrate where nothing is left
+    QVector<double> height( nx * ny, bottom );
+
+    for ( int i = 0; i < num_monomers; i++ )
+    {
+        int chain = species.chainIndex( i );
+
+        if ( 0 < chain && isDissolved( chain ) )
+        {
+            continue;
+        }
+
+        double& h = height[columnOf( species.position( i ), box, nx, ny )];
+        h = qMax( h, species.position( i ).z );
+    }
+
+    double sum = 0.0;
+    double sum_sq = 0.0;
+
+    for ( int k = 0; k < height.count(); k++ )
+    {
+        sum += height[k];
+        sum_sq += height[k] * height[k];
+    }
+
+    mean_height = sum / height.count();
+    surface_roughness = sqrt( qMax( 0.0, sum_sq / height.count() - mean_height * mean_height ) );
+
+    // a column belongs to the line when more than half of the film thickness is left,
+    // each row along y contributes the longest run of such columns along x
+    double threshold = bottom + 0.5 * ( top - bottom );
+    bool periodic = box.isPeriodic( 0 );
+    double period = box.length( 0 );
+
+    QVector<double> left_edges;
+    QVector<double> widths;
+    double reference = 0.0;
+
+    for ( int by = 0; by < ny; by++ )
+    {
+        const double* row = height.constData() + by * nx;
+
+        int empty = -1;
+        for ( int bx = 0; bx < nx && 0 > empty; bx++ )
+        {
+            if ( row[bx] <= threshold ) empty = bx;
+        }
+
+        // no edge in a row that is all line or all space
+        if ( 0 > empty || nx == 1 )
+        {
+            continue;
+        }
+
+        bool any = false;
+        for ( int bx = 0; bx < nx && false == any; bx++ )
+        {
+            any = ( row[bx] > threshold );
+        }
+
+        if ( false == any )
+        {
+            continue;
+        }
+
+        // on a periodic axis start after an empty column so a run may wrap
+        int offset = periodic ? empty + 1 : 0;
+        int best_start = 0;
+        int best_length = 0;
+        int run_start = 0;
+        int run_length = 0;
+
+        for ( int k = 0; k < nx; k++ )
+        {
+            int bx = ( offset + k ) % nx;
+
+            if ( row[bx] > threshold )
+            {
+                if ( 0 == run_length ) run_start = offset + k;
+                run_length++;
+
+                if ( run_length > best_length )
+                {
+                    best_start = run_start;
+                    best_length = run_length;
+                }
+            }
+            else
+            {
+                run_length = 0;
+            }
+        }
+
+        double left = box.lower( 0 ) + best_start * bin_width;
+        double width = best_length * bin_width;
+
+        // keep the edges of successive rows on the same image of the line
+        if ( periodic && false == left_edges.isEmpty() )
+        {
+            left -= period * floor( ( left + 0.5 * width - reference ) / period + 0.5 );
+        }
+        else
+        {
+            reference = left + 0.5 * width;
+        }
+
+        left_edges.append( left );
+        widths.append( width );
+    }
+
+    line_rows = left_edges.count();
+    mean_line_width = 0.0;
+    line_edge_roughness = 0.0;
+    line_width_roughness = 0.0;
+
+    if ( 0 == line_rows )
+    {
+        return;
+    }
+
+    double mean_left = 0.0;
+    double mean_right = 0.0;
+
+    for ( int r = 0; r < line_rows; r++ )
+    {
+        mean_left += left_edges[r];
+        mean_right += left_edges[r] + widths[r];
+        mean_line_width += widths[r];
+    }
+
+    mean_left /= line_rows;
+    mean_right /= line_rows;
+    mean_line_width /= line_rows;
+
+    if ( 2 > line_rows )
+    {
+        return;
+    }
+
+    double var_left = 0.0;
+    double var_right = 0.0;
+    double var_width = 0.0;
+
+    for ( int r = 0; r < line_rows; r++ )
+    {
+        var_left += pow( left_edges[r] - mean_left, 2.0 );
+        var_right += pow( left_edges[r] + widths[r] - mean_right, 2.0 );
+        var_width += pow( widths[r] - mean_line_width, 2.0 );
+    }
+
+    var_left /= ( line_rows - 1 );
+    var_right /= ( line_rows - 1 );
+    var_width /= ( line_rows - 1 );
+
+    // three sigma, the edge value averages the two sides of the line
+    line_edge_roughness = 3.0 * sqrt( 0.5 * ( var_left + var_right ) );
+    line_width_roughness = 3.0 * sqrt( var_width );
+}
+
+
+
+bool DissolutionAnalysis::writeCSV( const QString& fileName ) const
+{
+    QFile file( fileName );
+
+    if ( false == file.open( QFile::WriteOnly | QFile::Truncate ) )
+    {
+        return false;
+    }
+
+    QTextStream out( &file );
+
+    out << "cluster,chains,monomers,touches_top\n";
+
+    for ( int k = 0; k < cluster_chains.count(); k++ )
+    {
+        out << k << "," << cluster_chains.at( k ) << "," << cluster_monomers.at( k ) << "," << ( cluster_top.at( k ) ? 1 : 0 ) << "\n";
+    }
+
+    out.flush();
+
+    return QFile::NoError == file.error();
+}
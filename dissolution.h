@@ -0,0 +1,98 @@
+#ifndef DISSOLUTION_H
+#define DISSOLUTION_H
+
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include <QVector>
+#include <QString>
+
+#include "spatialindex.h"
+#include "speciesstore.h"
+
+// Development as a percolation process. Soluble chains that have monomers
+// within the contact radius of each other form clusters (connected
+// components found by union-find), and only the clusters that the developer
+// reaches from the top are dissolved: one of their monomers must have no
+// insoluble material above it in its column of bin width along x and y, so
+// soluble chains buried under insoluble material stay behind while those in
+// the valleys of a rough film dissolve. The height map of what remains gives the surface
+// roughness and, when the remaining material forms a line along y, the line
+// edge and line width roughness (three sigma over rows of bin width).
+// The top surface never wraps, z is treated as open even for bulk models.
+
+class DissolutionAnalysis
+{
+public:
+    DissolutionAnalysis( double contactRadius, double binWidth );
+
+    bool compute( const SpeciesStore& species, const QVector<char>& solubleChains, const PeriodicBox& box );
+
+    int clusterCount() const { return cluster_chains.count(); }
+    int clusterChains( int cluster ) const { return cluster_chains.at( cluster ); }
+    int clusterMonomers( int cluster ) const { return cluster_monomers.at( cluster ); }
+    bool touchesTop( int cluster ) const { return cluster_top.at( cluster ); }
+    int clusterOf( int chain ) const { return chain_cluster.at( chain ); }
+    bool isDissolved( int chain ) const { return 0 <= chain_cluster.at( chain ) && cluster_top.at( chain_cluster.at( chain ) ); }
+
+    int dissolvedClusterCount() const { return num_dissolved_clusters; }
+    int dissolvedChainCount() const { return num_dissolved_chains; }
+    double dissolvedFraction() const { return ( 0 < num_monomers ) ? ( double ) num_dissolved_monomers / num_monomers : 0.0; }
+
+    double meanHeight() const { return mean_height; }
+    double surfaceRoughness() const { return surface_roughness; }
+    int lineRows() const { return line_rows; }
+    double meanLineWidth() const { return mean_line_width; }
+    double lineEdgeRoughness() const { return line_edge_roughness; }
+    double lineWidthRoughness() const { return line_width_roughness; }
+
+    bool writeCSV( const QString& fileName ) const;
+
+protected:
+    double contact_radius;
+    double bin_width;
+    int num_monomers;
+    int num_dissolved_monomers;
+    int num_dissolved_chains;
+    int num_dissolved_clusters;
+    double mean_height;
+    double surface_roughness;
+    int line_rows;
+    double mean_line_width;
+    double line_edge_roughness;
+    double line_width_roughness;
+
+    QVector<int> chain_cluster;
+    QVector<int> cluster_chains;
+    QVector<int> cluster_monomers;
+    QVector<char> cluster_top;
+
+    void measureRemaining( const SpeciesStore& species, const PeriodicBox& box, double bottom, double top );
+    int columnOf( const Qwt3D::Triple& p, const PeriodicBox& box, int nx, int ny ) const;
+
+    static int findRoot( QVector<int>& parent, int c );
+    static void join( QVector<int>& parent, int a, int b );
+};
+
+#endif // DISSOLUTION_H
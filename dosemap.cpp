@@ -0,0 +1,282 @@
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include "dosemap.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QRegularExpression>
+#include <math.h>
+
+
+DoseMap::DoseMap() :
+    profile( Uniform ),
+    pattern_axis( 0 ),
+    period( 1.0 ),
+    contrast( 1.0 ),
+    space_width( 0.5 ),
+    blur( 0.0 ),
+    file_name(),
+    samples()
+{
+    num_samples[0] = num_samples[1] = num_samples[2] = 1;
+}
+
+
+
+void DoseMap::setSinusoid( double pitch, double imageContrast, int axis )
+{
+    profile = Sinusoid;
+    period = pitch;
+    contrast = qBound( 0.0, imageContrast, 1.0 );
+    pattern_axis = axis;
+}
+
+
+
+void DoseMap::setLineSpace( double pitch, double spaceWidth, double edgeBlur, int axis )
+{
+    profile = LineSpace;
+    period = pitch;
+    space_width = qBound( 0.0, spaceWidth, pitch );
+    blur = edgeBlur;
+    pattern_axis = axis;
+}
+
+
+
+bool DoseMap::readFile( const QString& fileName, QString& error )
+{
+    QFile file( fileName );
+
+    if ( false == file.open( QIODevice::ReadOnly | QIODevice::Text ) )
+    {
+        error = QString( "could not read %1" ).arg( fileName );
+        return false;
+    }
+
+    QTextStream in( &file );
+    QStringList tokens;
+
+    while ( false == in.atEnd() )
+    {
+        QString line = in.readLine().trimmed();
+
+        if ( line.isEmpty() || line.startsWith( '#' ) )
+        {
+            continue;
+        }
+
+        tokens.append( line.split( QRegularExpression( "[\\s,;]+" ), Qt::SkipEmptyParts ) );
+    }
+
+    if ( tokens.count() < 3 )
+    {
+        error = QString( "%1 has no sample counts" ).arg( fileName );
+        return false;
+    }
+
+    // parsed into locals so that a file that fails leaves the map as it was
+    int counts[3];
+    bool ok;
+
+    for ( int a = 0; a < 3; a++ )
+    {
+        counts[a] = tokens.at( a ).toInt( &ok );
+
+        if ( false == ok || counts[a] < 1 )
+        {
+            error = QString( "%1 has an invalid sample count" ).arg( fileName );
+            return false;
+        }
+    }
+
+    qint64 count = ( qint64 ) counts[0] * counts[1] * counts[2];
+
+    if ( tokens.count() - 3 != count )
+    {
+        error = QString( "%1 holds %2 doses, %3 expected" ).arg( fileName ).arg( tokens.count() - 3 ).arg( count );
+        return false;
+    }
+
+    QVector<float> doses( count );
+
+    for ( int i = 0; i < count; i++ )
+    {
+        doses[i] = tokens.at( i + 3 ).toDouble( &ok );
+
+        if ( false == ok )
+        {
+            error = QString( "%1: dose %2 '%3' is not a number" ).arg( fileName ).arg( i + 1 ).arg( tokens.at( i + 3 ) );
+            return false;
+        }
+    }
+
+    samples = doses;
+
+    // the pattern axis is the longest axis of the map
+    pattern_axis = 0;
+    for ( int a = 0; a < 3; a++ )
+    {
+        num_samples[a] = counts[a];
+        if ( num_samples[a] > num_samples[pattern_axis] ) pattern_axis = a;
+    }
+
+    profile = Sampled;
+    file_name = fileName;
+
+    return true;
+}
+
+
+
+QString DoseMap::description() const
+{
+    const char* axis_name[] = { "x", "y", "z" };
+
+    switch ( profile )
+    {
+        case Sinusoid:
+            return QString( "sinusoid along %1, pitch %2, contrast %3" ).arg( axis_name[pattern_axis] ).arg( period ).arg( contrast );
+
+        case LineSpace:
+            return QString( "line/space along %1, pitch %2, space %3, blur %4" ).arg( axis_name[pattern_axis] ).arg( period ).arg( space_width ).arg( blur );
+
+        case Sampled:
+            return QString( "%1 x %2 x %3 map from %4" ).arg( num_samples[0] ).arg( num_samples[1] ).arg( num_samples[2] ).arg( file_name );
+
+        default:
+            return QString( "uniform" );
+    }
+}
+
+
+
+double DoseMap::analyticDose( double u ) const
+{
+    if ( Sinusoid == profile )
+    {
+        return ( 1.0 - contrast ) + contrast * 0.5 * ( 1.0 + cos( 2.0 * M_PI * ( u - 0.5 * period ) / period ) );
+    }
+
+    // the space of every period is centred at half a pitch
+    double s = u - period * floor( u / period );
+    double a = 0.5 * ( period - space_width );
+    double b = a + space_width;
+
+    if ( blur <= 0.0 )
+    {
+        return ( s >= a && s < b ) ? 1.0 : 0.0;
+    }
+
+    // top hat convolved with a Gaussian, the neighbouring spaces add their tails
+    double scale = 1.0 / ( sqrt( 2.0 ) * blur );
+    double d = 0.0;
+
+    for ( int k = -2; k <= 2; k++ )
+    {
+        d += 0.5 * ( erf( ( s - a - k * period ) * scale ) - erf( ( s - b - k * period ) * scale ) );
+    }
+
+    return qBound( 0.0, d, 1.0 );
+}
+
+
+
+double DoseMap::sampledDose( const PeriodicBox& box, const Qwt3D::Triple& p ) const
+{
+    double v[3] = { p.x, p.y, p.z };
+    int i0[3];
+    int i1[3];
+    double f[3];
+
+    for ( int a = 0; a < 3; a++ )
+    {
+        int n = num_samples[a];
+        double c = ( v[a] - box.lower( a ) ) / box.length( a ) * n - 0.5;
+        int lo = ( int ) floor( c );
+
+        f[a] = c - lo;
+
+        if ( box.isPeriodic( a ) )
+        {
+            i0[a] = ( ( lo % n ) + n ) % n;
+            i1[a] = ( i0[a] + 1 ) % n;
+        }
+        else
+        {
+            i0[a] = qBound( 0, lo, n - 1 );
+            i1[a] = qBound( 0, lo + 1, n - 1 );
+        }
+    }
+
+    double d = 0.0;
+
+    for ( int corner = 0; corner < 8; corner++ )
+    {
+        int ix = ( corner & 1 ) ? i1[0] : i0[0];
+        int iy = ( corner & 2 ) ? i1[1] : i0[1];
+        int iz = ( corner & 4 ) ? i1[2] : i0[2];
+
+        double w = ( ( corner & 1 ) ? f[0] : 1.0 - f[0] ) * ( ( corner & 2 ) ? f[1] : 1.0 - f[1] ) * ( ( corner & 4 ) ? f[2] : 1.0 - f[2] );
+
+        d += w * samples.at( ( iz * num_samples[1] + iy ) * num_samples[0] + ix );
+    }
+
+    return d;
+}
+
+
+
+double DoseMap::dose( const PeriodicBox& box, const Qwt3D::Triple& p ) const
+{
+    switch ( profile )
+    {
+        case Sinusoid:
+        case LineSpace:
+        {
+            double v[3] = { p.x, p.y, p.z };
+            return analyticDose( v[pattern_axis] - box.lower( pattern_axis ) );
+        }
+
+        case Sampled:
+            return sampledDose( box, p );
+
+        default:
+            return 1.0;
+    }
+}
+
+
+
+void DoseMap::evaluate( const PeriodicBox& box, const QVector<Qwt3D::Triple>& positions, QVector<float>& doses ) const
+{
+    doses.resize( positions.count() );
+
+    for ( int i = 0; i < positions.count(); i++ )
+    {
+        doses[i] = ( float ) qBound( 0.0, dose( box, positions.at( i ) ), 1.0 );
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef DOSEMAP_H
+#define DOSEMAP_H
+
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include <QVector>
+#include <QString>
+
+#include "spatialindex.h"
+
+// Relative exposure dose over the box, 1 where the exposure is full. The
+// map is either analytic along one axis - a sinusoidal aerial image or
+// spaces of a line/space pattern with a Gaussian edge blur, both with the
+// first space centred at half a pitch from the box origin - or sampled on
+// a regular grid read from a text file. The file starts with the sample
+// counts "nx ny nz" followed by nx * ny * nz doses with x running fastest;
+// a 1D or 2D map simply has the remaining counts set to 1. Samples sit at
+// the cell centres of the box and are interpolated trilinearly, wrapping
+// on the periodic axes.
+
+class DoseMap
+{
+public:
+    enum PROFILE { Uniform, Sinusoid, LineSpace, Sampled };
+
+    DoseMap();
+
+    void setUniform() { profile = Uniform; }
+    void setSinusoid( double pitch, double contrast, int axis );
+    void setLineSpace( double pitch, double spaceWidth, double blur, int axis );
+    bool readFile( const QString& fileName, QString& error );
+
+    enum PROFILE type() const { return profile; }
+    bool isUniform() const { return Uniform == profile; }
+    int axis() const { return pattern_axis; }
+    double pitch() const { return period; }
+    double imageContrast() const { return contrast; }
+    double spaceWidth() const { return space_width; }
+    double edgeBlur() const { return blur; }
+    const QString& fileName() const { return file_name; }
+    QString description() const;
+
+    void evaluate( const PeriodicBox& box, const QVector<Qwt3D::Triple>& positions, QVector<float>& doses ) const;
+    double dose( const PeriodicBox& box, const Qwt3D::Triple& p ) const;
+
+protected:
+    enum PROFILE profile;
+    int pattern_axis;
+    double period;
+    double contrast;
+    double space_width;
+    double blur;
+    QString file_name;
+    int num_samples[3];
+    QVector<float> samples;
+
+    double analyticDose( double u ) const;
+    double sampledDose( const PeriodicBox& box, const Qwt3D::Triple& p ) const;
+};
+
+#endif // DOSEMAP_H
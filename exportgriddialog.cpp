@@ -23,21 +23,23 @@
 
 #include "exportgriddialog.h"
 #include "ui_exportgriddialog.h"
+#include "voxelizer.h"
 
 #include <QFileDialog>
-#include <QFile>
-#include <QTextStream>
+#include <QMessageBox>
 #include <QDebug>
 
-ExportGridDialog::ExportGridDialog( Grid* g,  QWidget* parent ) :
+ExportGridDialog::ExportGridDialog( Grid* g, MonomerList* list, QWidget* parent ) :
     QDialog( parent ),
     ui( new Ui::ExportDialog ),
-    grid( g )
+    grid( g ),
+    monomer_list( list )
 {
     ui->setupUi( this );
 
     connect( ui->fileSelectButton, SIGNAL( clicked( bool ) ), this, SLOT( fileSelectionButtonClicked() ) );
     connect( ui->buttonBox->button( QDialogButtonBox::Apply ), SIGNAL( clicked( bool ) ), this, SLOT( applyButtonClicked() ) );
+    connect( ui->splattingComboBox, SIGNAL( currentIndexChanged( int ) ), this, SLOT( splattingChanged( int ) ) );
 }
 
 ExportGridDialog::~ExportGridDialog()
@@ -48,15 +50,18 @@ ExportGridDialog::~ExportGridDialog()
 
 void ExportGridDialog::fileSelectionButtonClicked()
 {
-    const QString EXTENSION( ".csv" );
+    const QString CSV_EXTENSION( ".csv" );
+    const QString NPY_EXTENSION( ".npy" );
+    const QString NPY_FILTER( tr( "NumPy arrays (*.npy)" ) );
 
-    QString fileName = QFileDialog::getSaveFileName( this, tr( "Save File" ), QString(), tr( "CSV files (*.csv)" ) );
+    QString selected_filter;
+    QString fileName = QFileDialog::getSaveFileName( this, tr( "Save File" ), QString(), tr( "CSV files (*.csv)" ) + ";;" + NPY_FILTER, &selected_filter );
 
     if ( false == fileName.isEmpty() )
     {
-        if ( false == fileName.endsWith( EXTENSION, Qt::CaseInsensitive ) )
+        if ( false == fileName.endsWith( CSV_EXTENSION, Qt::CaseInsensitive ) && false == fileName.endsWith( NPY_EXTENSION, Qt::CaseInsensitive ) )
         {
-            fileName += EXTENSION;
+            fileName += ( NPY_FILTER == selected_filter ) ? NPY_EXTENSION : CSV_EXTENSION;
         }
         ui->fileNameLabel->setText( fileName );
         ui->fileNameLabel->setToolTip( fileName );
@@ -65,93 +70,50 @@ void ExportGridDialog::fileSelectionButtonClicked()
 
 
 
-void ExportGridDialog::applyButtonClicked()
+void ExportGridDialog::splattingChanged( int index )
 {
-    int num_cols = ui->numColsSpinBox->value();
-    int num_rows = ui->numRowsSpinBox->value();
-    int num_layers = ui->numLayersSpinBox->value();
+    ui->gaussianWidthSpinBox->setEnabled( Voxelizer::GAUSSIAN == index );
+}
 
-    int initial_val = 0;
 
-    QVector < QVector < QVector< int > > > vec( num_cols,
-            QVector < QVector <int > > ( num_rows,
-                                         QVector < int > ( num_layers, initial_val ) ) );
 
-    float grid_step_x = grid->params.box_size.x / ( num_cols );
-    float grid_step_y = grid->params.box_size.y / ( num_rows );
-    float grid_step_z = grid->params.box_size.z / ( num_layers );
+void ExportGridDialog::applyButtonClicked()
+{
+    Voxelizer voxelizer( ui->numColsSpinBox->value(), ui->numRowsSpinBox->value(), ui->numLayersSpinBox->value() );
 
-    // scan through chains and count how may monomers are in each box
+    voxelizer.setSplatting( ( enum Voxelizer::SPLATTING ) ui->splattingComboBox->currentIndex() );
+    voxelizer.setGaussianWidth( ui->gaussianWidthSpinBox->value() );
 
-    int counter = 0 ;
-    for ( int chain_nr = 0; chain_nr < grid->max_chains; chain_nr++ )
+    QStringList channel_names;
+    if ( 1 == ui->channelComboBox->currentIndex() && 0 < monomer_list->count() )
     {
-        Chain* chain = &grid->chains[chain_nr];
-
-        if ( chain->last - chain->first <= 0 ) continue;
-
-        for ( int j = chain->first; j < chain->last; j++ )
-        {
-            int k = j - chain->offset;
-
-            Vector v = Vector_periodic_box( chain->atoms[k], grid->params.box_size );
-
-            int col_loc = 0;
-            int row_loc = 0;
-            int layer_loc = 0;
-
-            float distance = grid_step_x;
-
-            while ( distance < v.x )
-            {
-                col_loc++;
-                distance += grid_step_x;
-            }
-
-            distance = grid_step_y;
-
-            while ( distance < v.y )
-            {
-                row_loc++;
-                distance += grid_step_y;
-            }
-
-            distance = grid_step_z;
-
-            while ( distance < v.z )
-            {
-                layer_loc++;
-                distance += grid_step_z;
-            }
+        channel_names = monomer_list->monomerNameList();
+        voxelizer.setChannelCount( channel_names.count() );
+    }
 
-            vec[col_loc][row_loc][layer_loc] = vec[col_loc][row_loc][layer_loc] + 1;
-            counter++;
-        }
+    if ( false == voxelizer.voxelize( grid ) )
+    {
+        return;
     }
 
     // write out to file...
 
-    int total = 0;
-    QFile data( ui->fileNameLabel->text() );
+    QString file_name = ui->fileNameLabel->text();
+    bool ok;
 
-    if ( data.open( QFile::WriteOnly | QFile::Truncate ) )
+    if ( file_name.endsWith( ".npy", Qt::CaseInsensitive ) )
     {
-        QTextStream out( &data );
-
-        out << QString( "column,row,layer,value" ) << Qt::endl;
+        ok = voxelizer.writeNpy( file_name );
+    }
+    else
+    {
+        ok = voxelizer.writeCSV( file_name, channel_names );
+    }
 
-        for ( int col = 0; col < num_cols; col++ )
-        {
-            for ( int row = 0; row < num_rows; row++ )
-            {
-                for ( int layer = 0; layer < num_layers; layer++ )
-                {
-                    total += vec[col][row][layer];
-                    out << ( col + 1 ) << "," << ( row + 1 ) << "," << ( layer + 1 ) << "," << vec[col][row][layer] << Qt::endl;
-                }
-            }
-        }
+    if ( false == ok )
+    {
+        QMessageBox::warning( this, tr( "Export as grid" ), QString( "Could not write to %1" ).arg( file_name ) );
     }
 
-    qDebug() << " total monomers: " << total << counter;
+    qDebug() << " total monomers: " << voxelizer.total();
 }
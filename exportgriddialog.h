@@ -29,6 +29,7 @@
 
 #include "grid.h"
 #include "grow.h"
+#include "monomerlist.h"
 
 namespace Ui
 {
@@ -40,16 +41,18 @@ class ExportGridDialog : public QDialog
     Q_OBJECT
 
 public:
-    explicit ExportGridDialog( Grid* g,  QWidget* parent = nullptr );
+    explicit ExportGridDialog( Grid* g, MonomerList* list, QWidget* parent = nullptr );
     ~ExportGridDialog();
 
 private:
     Ui::ExportDialog* ui;
     Grid* grid;
+    MonomerList* monomer_list;
 
 protected slots:
     void fileSelectionButtonClicked();
     void applyButtonClicked();
+    void splattingChanged( int index );
 };
 
 #endif // EXPORTGRIDDIALOG_H
@@ -23,7 +23,11 @@
 
 #include "exposuredialog.h"
 #include "ui_exposuredialog.h"
+#include "radialdistribution.h"
+#include "dissolution.h"
+#include "deprotectionprofile.h"
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QPushButton>
 #include <QSettings>
 
@@ -43,25 +47,41 @@ const QString EXPOSURE_TYPE_NAME( "ExopsureType" );
 const QString ACIDS_PER_PHOTON_NAME( "AcidsPerPhoton" );
 const QString INTERACTION_RADIUS_NAME( "InteractionRadius" );
 const QString SOLBILITY_THRESHOLD_NAME( "SolubilityThreshols" );
-
-ExposureDialog::ExposureDialog( MonomerList* monomerList, Qwt3D::AtomVector& monomers, MainWindow* parent ) :
+const QString PERIODIC_NAME( "PeriodicBoundaries" );
+const QString BAKE_NAME( "Bake" );
+const QString BAKE_TIME_NAME( "BakeTime" );
+const QString LATTICE_SPACING_NAME( "LatticeSpacing" );
+const QString ACID_DIFFUSIVITY_NAME( "AcidDiffusivity" );
+const QString QUENCHER_DIFFUSIVITY_NAME( "QuencherDiffusivity" );
+const QString DEPROTECTION_RATE_NAME( "DeprotectionRate" );
+const QString QUENCHING_RATE_NAME( "QuenchingRate" );
+const QString RECORD_COUNT_NAME( "BakeRecords" );
+const QString DOSE_MAP_NAME( "PatternedExposure" );
+const QString DOSE_PROFILE_NAME( "AerialImage" );
+const QString DOSE_AXIS_NAME( "PatternAxis" );
+const QString PITCH_NAME( "Pitch" );
+const QString CONTRAST_NAME( "ImageContrast" );
+const QString SPACE_WIDTH_NAME( "SpaceWidth" );
+const QString EDGE_BLUR_NAME( "EdgeBlur" );
+const QString SLAB_WIDTH_NAME( "ProfileSlabWidth" );
+const QString EDGE_THRESHOLD_NAME( "EdgeThreshold" );
+const QString DOSE_FILE_NAME( "DoseMapFile" );
+const QString DEVELOP_NAME( "Development" );
+const QString CONTACT_RADIUS_NAME( "ContactRadius" );
+const QString ROUGHNESS_BIN_NAME( "RoughnessBinWidth" );
+const QString SWEEP_NAME( "DoseSweep" );
+const QString SWEEP_FROM_NAME( "DoseSweepFrom" );
+const QString SWEEP_TO_NAME( "DoseSweepTo" );
+const QString SWEEP_STEPS_NAME( "DoseSweepSteps" );
+const QString SWEEP_SEEDS_NAME( "DoseSweepSeeds" );
+const QString SWEEP_FILE_NAME( "DoseSweepFile" );
+
+ExposureDialog::ExposureDialog( MonomerList* monomerList, SpeciesStore& speciesStore, MainWindow* parent ) :
     QDialog( parent ),
     ui( new Ui::ExposureDialog ),
-    seed( 0 ),
-    exposed_fraction( 0.0 ),
-    deprotection_radius( 0.0 ),
-    monomer_vector( monomers ),
+    species( speciesStore ),
     monomer_list( monomerList ),
-    pag_indices(),
-    protected_and_quencher_indices(),
-    deprotected_indices(),
-    neutralized_quencher_indices(),
-    photolyzed_pag_indices(),
-    clustered_photolyzed_pag_indices(),
-    exposure_type( Random ),
-    acid_cluster_radius( 1.0 ),
-    acids_per_photon( 3.0 ),
-    rng(),
+    model( speciesStore ),
     apply_button( 0 ),
     reset_button( 0 ),
     main_window( ( MainWindow* ) parent )
@@ -180,10 +200,44 @@ void ExposureDialog::initialize()
     }
 
     ui->exposureTypeComboBox->setCurrentIndex( settings.value( EXPOSURE_TYPE_NAME, 0 ).toInt() );
+    ui->periodicCheckBox->setChecked( settings.value( PERIODIC_NAME, true ).toBool() );
+
+    ui->bakeGroupBox->setChecked( settings.value( BAKE_NAME, false ).toBool() );
+    ui->bakeTimeSpinBox->setValue( settings.value( BAKE_TIME_NAME, ui->bakeTimeSpinBox->value() ).toDouble() );
+    ui->latticeSpacingSpinBox->setValue( settings.value( LATTICE_SPACING_NAME, ui->latticeSpacingSpinBox->value() ).toDouble() );
+    ui->acidDiffusivitySpinBox->setValue( settings.value( ACID_DIFFUSIVITY_NAME, ui->acidDiffusivitySpinBox->value() ).toDouble() );
+    ui->quencherDiffusivitySpinBox->setValue( settings.value( QUENCHER_DIFFUSIVITY_NAME, ui->quencherDiffusivitySpinBox->value() ).toDouble() );
+    ui->deprotectionRateSpinBox->setValue( settings.value( DEPROTECTION_RATE_NAME, ui->deprotectionRateSpinBox->value() ).toDouble() );
+    ui->quenchingRateSpinBox->setValue( settings.value( QUENCHING_RATE_NAME, ui->quenchingRateSpinBox->value() ).toDouble() );
+    ui->recordCountSpinBox->setValue( settings.value( RECORD_COUNT_NAME, ui->recordCountSpinBox->value() ).toInt() );
+
+    ui->doseMapGroupBox->setChecked( settings.value( DOSE_MAP_NAME, false ).toBool() );
+    ui->doseProfileComboBox->setCurrentIndex( settings.value( DOSE_PROFILE_NAME, 0 ).toInt() );
+    ui->doseAxisComboBox->setCurrentIndex( settings.value( DOSE_AXIS_NAME, 0 ).toInt() );
+    ui->pitchSpinBox->setValue( settings.value( PITCH_NAME, ui->pitchSpinBox->value() ).toDouble() );
+    ui->contrastSpinBox->setValue( settings.value( CONTRAST_NAME, ui->contrastSpinBox->value() ).toDouble() );
+    ui->spaceWidthSpinBox->setValue( settings.value( SPACE_WIDTH_NAME, ui->spaceWidthSpinBox->value() ).toDouble() );
+    ui->edgeBlurSpinBox->setValue( settings.value( EDGE_BLUR_NAME, ui->edgeBlurSpinBox->value() ).toDouble() );
+    ui->slabWidthSpinBox->setValue( settings.value( SLAB_WIDTH_NAME, ui->slabWidthSpinBox->value() ).toDouble() );
+    ui->edgeThresholdSpinBox->setValue( settings.value( EDGE_THRESHOLD_NAME, ui->edgeThresholdSpinBox->value() ).toDouble() );
+    ui->doseFileNameEdit->setText( settings.value( DOSE_FILE_NAME ).toString() );
+
+    ui->developGroupBox->setChecked( settings.value( DEVELOP_NAME, false ).toBool() );
+    ui->contactRadiusSpinBox->setValue( settings.value( CONTACT_RADIUS_NAME, ui->contactRadiusSpinBox->value() ).toDouble() );
+    ui->roughnessBinSpinBox->setValue( settings.value( ROUGHNESS_BIN_NAME, ui->roughnessBinSpinBox->value() ).toDouble() );
+
+    ui->sweepGroupBox->setChecked( settings.value( SWEEP_NAME, false ).toBool() );
+    ui->sweepFromSpinBox->setValue( settings.value( SWEEP_FROM_NAME, ui->sweepFromSpinBox->value() ).toDouble() );
+    ui->sweepToSpinBox->setValue( settings.value( SWEEP_TO_NAME, ui->sweepToSpinBox->value() ).toDouble() );
+    ui->sweepStepsSpinBox->setValue( settings.value( SWEEP_STEPS_NAME, ui->sweepStepsSpinBox->value() ).toInt() );
+    ui->sweepSeedsSpinBox->setValue( settings.value( SWEEP_SEEDS_NAME, ui->sweepSeedsSpinBox->value() ).toInt() );
+    ui->sweepFileNameEdit->setText( settings.value( SWEEP_FILE_NAME ).toString() );
 
     settings.endGroup();
 
     connect( ui->selectFileButton, SIGNAL( clicked( bool ) ), this, SLOT( selectFileButtonClicked() ) );
+    connect( ui->sweepSelectFileButton, SIGNAL( clicked( bool ) ), this, SLOT( sweepSelectFileButtonClicked() ) );
+    connect( ui->doseFileButton, SIGNAL( clicked( bool ) ), this, SLOT( doseFileButtonClicked() ) );
     connect( apply_button, SIGNAL( clicked( bool ) ), this, SLOT( apply() ) );
     connect( reset_button, SIGNAL( clicked( bool ) ), this, SLOT( reset() ) );
     connect( ui->exposureTypeComboBox, SIGNAL( currentIndexChanged( int ) ), this, SLOT( exposureTypeChanged( int ) ) );
@@ -198,466 +252,378 @@ void ExposureDialog::readInputs()
 {
     ui->textEdit->append( QString( "reading inputs..." ) );
 
-    int protected_type = ui->protectedComboBox->currentIndex();
-    int pag_type = ui->pagComboBox->currentIndex();
-    int quencher_type = ui->quencherComboBox->currentIndex();
-
-    rng.seed( ui->randomNumberSeedEdit->text().toInt() );
-    deprotection_radius = ui->reactionRadiusSpinBox->value();
-    exposed_fraction = ui->fractionExposedSpinBox->value();
-
-    pag_indices.clear();
-    protected_and_quencher_indices.clear();
-
-    int num_monomers = monomer_vector.size();
-
-    int monomer_count = 0;
-    for ( int i = 2; i < num_monomers; i++ )
+    ExposureModel::Species species_types;
+    species_types.protected_type = ui->protectedComboBox->currentIndex();
+    species_types.deprotected_type = ui->deprotectedComboBox->currentIndex();
+    species_types.pag_type = ui->pagComboBox->currentIndex();
+    species_types.exposed_type = ui->exposedPAGComboBox->currentIndex();
+    species_types.quencher_type = ui->quencherComboBox->currentIndex();
+    species_types.neutralized_type = ui->neutralizedQuencherComboBox->currentIndex();
+    species_types.ionizable_type = ui->ionizableComboBox->currentIndex();
+
+    model.setSpecies( species_types );
+    model.setReactionRadius( ui->reactionRadiusSpinBox->value() );
+    model.setExposure( ui->fractionExposedSpinBox->value(), ui->randomNumberSeedEdit->text().toInt() );
+    model.setClustering( 0 == ui->exposureTypeComboBox->currentIndex() ? ExposureModel::Random : ExposureModel::Clustered,
+                         ui->acidsPerPhotonSpinBox->value(), ui->electronInteractionDistanceSpinBox->value() );
+    model.setSolubilityThreshold( ui->solubilityThresholdSpinBox->value() );
+    model.setPeriodic( ui->periodicCheckBox->isChecked() );
+
+    // the dose sweep only uses the reaction volume
+    ExposureModel::Bake bake;
+    bake.enabled = ui->bakeGroupBox->isChecked() && false == ui->sweepGroupBox->isChecked();
+    bake.time = ui->bakeTimeSpinBox->value();
+    bake.lattice_spacing = ui->latticeSpacingSpinBox->value();
+    bake.acid_diffusivity = ui->acidDiffusivitySpinBox->value();
+    bake.quencher_diffusivity = ui->quencherDiffusivitySpinBox->value();
+    bake.deprotection_rate = ui->deprotectionRateSpinBox->value();
+    bake.quenching_rate = ui->quenchingRateSpinBox->value();
+    bake.records = ui->recordCountSpinBox->value();
+
+    model.setBake( bake );
+
+    DoseMap dose_map;
+
+    if ( ui->doseMapGroupBox->isChecked() )
     {
-        Qwt3D::Atom m = monomer_vector[i];
-        monomer_count++;
+        int axis = ui->doseAxisComboBox->currentIndex();
+        QString error;
 
-        if ( protected_type == m.monomer_type  || quencher_type == m.monomer_type )
+        switch ( ui->doseProfileComboBox->currentIndex() )
         {
-            protected_and_quencher_indices.append( i );
-        }
+            case 0:
+                dose_map.setSinusoid( ui->pitchSpinBox->value(), ui->contrastSpinBox->value(), axis );
+                break;
 
-        if ( pag_type == m.monomer_type )
-        {
-            pag_indices.append( i );
+            case 1:
+                dose_map.setLineSpace( ui->pitchSpinBox->value(), ui->spaceWidthSpinBox->value(), ui->edgeBlurSpinBox->value(), axis );
+                break;
+
+            default:
+                if ( false == dose_map.readFile( ui->doseFileNameEdit->text(), error ) )
+                {
+                    ui->textEdit->append( QString( "%1, the exposure is uniform" ).arg( error ) );
+                }
+                break;
         }
     }
 
-    exposure_type = ( enum EXPOSURE_TYPE ) ui->exposureTypeComboBox->currentIndex();
-    acids_per_photon = ui->acidsPerPhotonSpinBox->value();
-    acid_cluster_radius = ui->electronInteractionDistanceSpinBox->value();
+    model.setDoseMap( dose_map );
+    model.prepare();
 
-    preparePhotolyzedPAGList();
+    const PeriodicBox& box = model.periodicBox();
 
     ui->textEdit->append( QString( "Model File name : %1" ).arg( ( main_window->fileName() ) ) );
-    ui->textEdit->append( QString( "Total of %1 monomers found" ).arg( monomer_count ) );
-    ui->textEdit->append( QString( "%1 radiation-sensitive groups('%2') found" ).arg( pag_indices.count() ).arg( ui->pagComboBox->currentText() ) );
+    ui->textEdit->append( QString( "Total of %1 monomers found" ).arg( model.monomerCount() ) );
+    ui->textEdit->append( QString( "%1 radiation-sensitive groups('%2') found" ).arg( model.pagCount() ).arg( ui->pagComboBox->currentText() ) );
     ui->textEdit->append( QString( " Random number seed = %1" ).arg( ui->randomNumberSeedEdit->text() ) );
-    ui->textEdit->append( QString( " Reaction volume radius = %1" ).arg( deprotection_radius ) );
-    ui->textEdit->append( QString( " Fraction %1 exposed = %2" ).arg( ui->pagComboBox->currentText() ).arg( exposed_fraction ) );
-
-    //    qDebug() << "avg num neighbors: r=2.1 " <<  numberOfNeighbors( 2.1 );
-    //    qDebug() << "avg num neighbors: r=1.9 " <<  numberOfNeighbors( 1.9 );
-    //    qDebug() << "avg num neighbors: r=1.7 " <<  numberOfNeighbors( 1.7 );
-    //    qDebug() << "avg num neighbors: r=1.5 " <<  numberOfNeighbors( 1.5 );
-    //    qDebug() << "avg num neighbors: r=1.3 " <<  numberOfNeighbors( 1.3 );
-    //    qDebug() << "avg num neighbors: r=1.1 " <<  numberOfNeighbors( 1.1 );
-    //    qDebug() << "avg num neighbors: r=0.9 " <<  numberOfNeighbors( 0.9 );
+    ui->textEdit->append( QString( " Reaction volume radius = %1" ).arg( ui->reactionRadiusSpinBox->value() ) );
+    ui->textEdit->append( QString( " Fraction %1 exposed = %2" ).arg( ui->pagComboBox->currentText() ).arg( model.exposedFraction() ) );
+    ui->textEdit->append( QString( " Periodic boundaries: x = %1, y = %2, z = %3" )
+                          .arg( box.isPeriodic( 0 ) ? "yes" : "no" ).arg( box.isPeriodic( 1 ) ? "yes" : "no" ).arg( box.isPeriodic( 2 ) ? "yes" : "no" ) );
 
     ui->textEdit->append( QString( " Exposure type = %1, avg acids/photon = %2, interaction radius = %3" ).arg( ui->exposureTypeComboBox->currentText() )
-                          .arg( Clustered == exposure_type ? QString::number( ui->acidsPerPhotonSpinBox->value() ) : "n/a" )
-                          .arg( Clustered == exposure_type ? QString::number( ui->electronInteractionDistanceSpinBox->value() ) :  "n/a" ) );
+                          .arg( 0 != ui->exposureTypeComboBox->currentIndex() ? QString::number( ui->acidsPerPhotonSpinBox->value() ) : "n/a" )
+                          .arg( 0 != ui->exposureTypeComboBox->currentIndex() ? QString::number( ui->electronInteractionDistanceSpinBox->value() ) :  "n/a" ) );
+
+    if ( false == dose_map.isUniform() )
+    {
+        ui->textEdit->append( QString( " Aerial image: %1" ).arg( dose_map.description() ) );
+    }
+
+    if ( bake.enabled )
+    {
+        ui->textEdit->append( QString( " Post-exposure bake: time = %1 s, lattice spacing = %2 nm" ).arg( bake.time ).arg( bake.lattice_spacing ) );
+        ui->textEdit->append( QString( " Diffusivity acid = %1, quencher = %2 nm²/s, rate constants deprotection = %3, quenching = %4 nm³/s" )
+                              .arg( bake.acid_diffusivity ).arg( bake.quencher_diffusivity )
+                              .arg( bake.deprotection_rate ).arg( bake.quenching_rate ) );
+    }
 }
 
 
 
 void ExposureDialog::runCalculation()
 {
-    int quencher_type = ui->quencherComboBox->currentIndex();
-    int nonreactive_ionizable_type = ui->ionizableComboBox->currentIndex();
-
-    const int IS_NEUTRALIZED = -1;
-
     ui->textEdit->append( QString( "starting conversions..." ) );
 
-    deprotected_indices.clear();
-
-    ui->progressBar->setMaximum( pag_indices.count() );
-
-    int num_exposed_pags = 0;
-    int num_neutralizations = 0;
+    ui->progressBar->setMaximum( 1 );
+    ui->progressBar->setValue( 0 );
 
-    // dumpAcidAndQuencherLocations();
+    // deprotection per chain over time goes next to the chain length file
+    QString bake_file;
 
-    // fro each pag in the film
-    for ( int i = 0; i < pag_indices.count(); i++ )
+    if ( ui->saveGroupBox->isChecked() && !ui->fileNameEdit->text().isEmpty() )
     {
-        // decide by probability if it is an exposed one
-        if ( isExposed( pag_indices[i] ) )
-        {
-            photolyzed_pag_indices.append( pag_indices[i] );
-            num_exposed_pags++;
-
-            bool neutralized = false;
-
-            int num_deprotected_by_this_pag  = 0;
-
-            // do through the list of sites containing a protecting group or quencher
-            for ( int j = 0; ( false == neutralized ) && ( j < protected_and_quencher_indices.count() ); j++ )
-            {
-                int current_monomer_index = protected_and_quencher_indices[j];
-
-                // if this monomer is a quencher that has been neutralized then do nothing
-                if ( IS_NEUTRALIZED != current_monomer_index )
-                {
-                    // otherwise see if it is in the reaction volume
-                    if ( isInVolume( pag_indices[i], current_monomer_index, deprotection_radius ) )
-                    {
-                        // if so and if it is a quencher then set the flag that ends the catalytic chain in this particular voluem
-                        if ( quencher_type == monomer_vector[current_monomer_index].monomer_type )
-                        {
-                            neutralized = true;
-                            num_neutralizations++;
-                            // and set the monomer as neutralized so it does not appear again
-                            neutralized_quencher_indices.append( protected_and_quencher_indices[j] );
-                            protected_and_quencher_indices[j] = IS_NEUTRALIZED;
-                            //   ui->textEdit->append( QString( "PAG %2 neutralized after %1 deprotections" ).arg( num_deprotected_by_this_pag ).arg( i ) );
-
-                        }
-                        else
-                        {
-                            // if it is not a quencher then it is a protecting group - add to the list of deprotected indeces
-                            deprotected_indices.append( protected_and_quencher_indices[j] );
-                            num_deprotected_by_this_pag++;
-                        }
-                    }
-                }
-            }
-
-            //    ui->textEdit->append( QString( "Total %1 deprotections by PAG %2" ).arg( num_deprotected_by_this_pag ).arg( i ) );
-        }
-
-        ui->progressBar->setValue( i );
+        QFileInfo info( ui->fileNameEdit->text() );
+        bake_file = info.absolutePath() + "/" + info.completeBaseName() + "_bake.csv";
     }
 
-    ui->progressBar->setValue( pag_indices.count() );
+    QVector<qint16> types = species.monomerTypes();
+    QVector<ExposureModel::ChainCounts> chains;
 
-    ui->textEdit->append( QString( "number of PAGs exposed = %1" ).arg( num_exposed_pags ) );
-    ui->textEdit->append( QString( "fraction of PAGs exposed = %1" ).arg( ( ( double )num_exposed_pags ) / ( ( double )pag_indices.count() ) ) );
-    ui->textEdit->append( QString( "%1 deprotection operations applied" ).arg( deprotected_indices.count() ) );
-    ui->textEdit->append( QString( "number of neutralizations = %1" ).arg( num_neutralizations ) );
+    ExposureModel::Result result = model.expose( types, chains, bake_file );
 
-    // go through the monomer vector and tag every monomer that has been deprotected
-    int deprotected_type = ui->deprotectedComboBox->currentIndex();
-    Qwt3D::RGBA deprotected_color = monomer_list->monomer( deprotected_type )->color();
-
-    for ( int k = 0; k < deprotected_indices.count(); k++ )
+    for ( int m = 0; m < model.messages().count(); m++ )
     {
-        monomer_vector[deprotected_indices[k]].monomer_type = deprotected_type;
-        monomer_vector[deprotected_indices[k]].col = deprotected_color;
+        ui->textEdit->append( model.messages().at( m ) );
     }
 
-    // do the same with the neutralized quenchers
-    int neutralized_type = ui->neutralizedQuencherComboBox->currentIndex();
-    Qwt3D::RGBA neutralized_color = monomer_list->monomer( neutralized_type )->color();
-
-    for ( int n = 0; n < neutralized_quencher_indices.count(); n++ )
-    {
-        monomer_vector[neutralized_quencher_indices[n]].monomer_type = neutralized_type;
-        monomer_vector[neutralized_quencher_indices[n]].col = neutralized_color;
-    }
+    species.setMonomerTypes( types );
 
-    // and with the exposed quenchers
-    int exposed_type = ui->exposedPAGComboBox->currentIndex();
-    Qwt3D::RGBA exposed_color = monomer_list->monomer( exposed_type )->color();
+    ui->progressBar->setValue( 1 );
 
-    for ( int x = 0; x < photolyzed_pag_indices.count(); x++ )
-    {
-        monomer_vector[photolyzed_pag_indices[x]].monomer_type = exposed_type;
-        monomer_vector[photolyzed_pag_indices[x]].col = exposed_color;
-    }
+    ui->textEdit->append( QString( "number of PAGs exposed = %1" ).arg( result.num_exposed ) );
+    ui->textEdit->append( QString( "fraction of PAGs exposed = %1" ).arg( ( ( double )result.num_exposed ) / ( ( double )model.pagCount() ) ) );
+    ui->textEdit->append( QString( "%1 deprotection operations applied" ).arg( result.num_deprotections ) );
+    ui->textEdit->append( QString( "number of neutralizations = %1" ).arg( result.num_neutralizations ) );
 
-    // now scan through the mononomer_vector to do some statistics
-    int num_monomers = monomer_vector.size();
     int final_count_deprotected = 0;
     int final_count_protected = 0;
-    int final_count_neutralized = 0;
-    int final_count_quencher = 0;
-    int final_count_exposed = 0;
-    int final_count_pag = 0;
-    int final_count_nonreactive_ionizable = 0;
 
-    int num_chains = monomer_vector[num_monomers - 1].chain_index;
-    QList<int> chain_length( num_chains + 1, 0 );
-    QList<int> protected_count( num_chains + 1, 0 );
-    QList<int> deprotected_count( num_chains + 1, 0 );
-    QList<int> neutralized_count( num_chains + 1, 0 );
-    QList<int> quencher_count( num_chains + 1, 0 );
-    QList<int> exposed_count( num_chains + 1, 0 );
-    QList<int> pag_count( num_chains + 1, 0 );
-    QList<int> nonreactive_ionizable_count( num_chains + 1, 0 );
-    QList<int> is_soluble( num_chains + 1, 0 );
-
-    int protected_type = ui->protectedComboBox->currentIndex();
-    int pag_type = ui->pagComboBox->currentIndex();
-
-    // always skip the first two members, they are used in qt opengl3d to set the volume extents on screen
-
-    for ( int i = 2; i < num_monomers; i++ )
+    for ( int c = 0; c < chains.count(); c++ )
     {
-        Qwt3D::Atom m = monomer_vector[i];
-
-        chain_length[m.chain_index]++;
-
-        if ( protected_type == m.monomer_type )
-        {
-            protected_count[m.chain_index]++;
-            final_count_protected++;
-        }
-
-        if ( deprotected_type == m.monomer_type )
-        {
-            final_count_deprotected++;
-            deprotected_count[m.chain_index]++;
-        }
-
-        if ( neutralized_type == m.monomer_type )
-        {
-            final_count_neutralized++;
-            neutralized_count[m.chain_index]++;
-        }
-
-        if ( quencher_type == m.monomer_type )
-        {
-            final_count_quencher++;
-            quencher_count[m.chain_index]++;
-        }
-
-        if ( exposed_type == m.monomer_type )
-        {
-            final_count_exposed++;
-            exposed_count[m.chain_index]++;
-        }
-
-        if ( pag_type == m.monomer_type )
-        {
-            final_count_pag++;
-            pag_count[m.chain_index]++;
-        }
-
-        if ( nonreactive_ionizable_type == m.monomer_type )
-        {
-            final_count_nonreactive_ionizable++;
-            nonreactive_ionizable_count[m.chain_index]++;
-        }
+        final_count_deprotected += chains[c].deprotected;
+        final_count_protected += chains[c].protected_groups;
     }
 
     ui->textEdit->append( QString( "final count of deprotected groups ('%3') = %1 out of %2" ).arg( final_count_deprotected ).arg( final_count_deprotected + final_count_protected ).arg( ui->deprotectedComboBox->currentText() ) );
-    ui->textEdit->append( QString( "Extent of deprotection = %1" ).arg( ( ( double )final_count_deprotected ) / ( ( double )( final_count_deprotected + final_count_protected ) ) ) );
-    ui->textEdit->append( QString( "Total fraction ionizable = %1" ).arg( ( ( double )final_count_deprotected + ( double ) final_count_nonreactive_ionizable ) / ( ( double )( num_monomers ) ) ) );
-
-    double sol_threshold = ui->solubilityThresholdSpinBox->value();
+    ui->textEdit->append( QString( "Extent of deprotection = %1" ).arg( result.deprotection_extent ) );
+    ui->textEdit->append( QString( "Total fraction ionizable = %1" ).arg( result.ionizable_fraction ) );
 
-    int final_count_soluble = 0;
-    int num_polymer_chains = 0;
+    ui->textEdit->append( QString( "Number of polymer chains = %1 " ).arg( result.num_polymer_chains ) );
+    ui->textEdit->append( QString( "Number of soluble chains = %1 (%2%)" ).arg( result.num_soluble_chains ).arg( ( 100.0 * result.num_soluble_chains  / ( ( double )( result.num_polymer_chains ) ) ) ) );
 
-    for ( int c = 1; c < chain_length.count(); c++ )
+    if ( false == model.doseMap().isUniform() )
     {
-        if ( 0 == deprotected_count[c] && 0 == nonreactive_ionizable_count[c] && 0 == protected_count[c] )
-        {
-            // not a polymer - do nothing
-        }
-        else
-        {
-            num_polymer_chains++;
-
-            if ( ( ( double )( deprotected_count[c] + nonreactive_ionizable_count[c] ) / ( ( double )chain_length[c] ) ) > sol_threshold )
-            {
-                is_soluble[c] = 1;
-                final_count_soluble++;
-            }
-        }
+        profileDeprotection();
     }
 
-    ui->textEdit->append( QString( "Number of polymer chains = %1 " ).arg( num_polymer_chains ) );
-    ui->textEdit->append( QString( "Number of soluble chains = %1 (%2%)" ).arg( final_count_soluble ).arg( ( 100.0 * final_count_soluble  / ( ( double )( num_polymer_chains ) ) ) ) );
+    if ( ui->developGroupBox->isChecked() )
+    {
+        developSolubleChains( chains );
+    }
 
     if ( ui->saveGroupBox->isChecked() )
     {
         ui->textEdit->append( "" );
         ui->textEdit->append( QString( "ChainIndex,ChainLength,NumProtected,NumDeprotected,NumRemainingQuencher,NumNeutralizedQuencher,NumRemainingPAG,NumExposedPAG,NumNonReactiveIonizable,IsSoluble" ) );
 
-        for ( int c = 1; c < chain_length.count(); c++ )
+        for ( int c = 1; c < chains.count(); c++ )
         {
-            ui->textEdit->append( QString( "%1,%2,%3,%4,%5,%6,%7,%8,%9,%10" ).arg( c ).arg( chain_length[c] ).arg( protected_count[c] ).arg( deprotected_count[c] ).arg( quencher_count[c] ).
-                                  arg( neutralized_count[c] ).arg( pag_count[c] ).arg( exposed_count[c] ).
-                                  arg( nonreactive_ionizable_count[c] ).arg( is_soluble[c] ) );
+            const ExposureModel::ChainCounts& counts = chains.at( c );
+
+            ui->textEdit->append( QString( "%1,%2,%3,%4,%5,%6,%7,%8,%9,%10" ).arg( c ).arg( counts.length ).arg( counts.protected_groups ).arg( counts.deprotected ).arg( counts.quenchers ).
+                                  arg( counts.neutralized ).arg( counts.pags ).arg( counts.exposed_pags ).
+                                  arg( counts.ionizable ).arg( counts.soluble ? 1 : 0 ) );
         }
     }
 }
 
 
 
-
-bool ExposureDialog::isInVolume( int centerIndex, int queriedIndex, double radius )
+double ExposureDialog::numberOfNeighbors( double radius )
 {
-    Qwt3D::Triple p1 = monomer_vector[centerIndex].pos;
-    Qwt3D::Triple p2 = monomer_vector[queriedIndex].pos;
-
-    double distance = sqrt( pow( p1.x - p2.x, 2.0 ) + pow( p1.y - p2.y, 2.0 ) + pow( p1.z - p2.z, 2.0 ) );
-    return ( distance <= radius );
-}
+    int num_monomers = species.count();
 
+    QVector<Qwt3D::Triple> positions;
+    QVector<int> types;
+    QVector<int> chains;
 
-
-bool ExposureDialog::isExposed( int pagIndex )
-{
-    if ( Random == exposure_type )
-    {
-        return ( rng.generateDouble() < exposed_fraction );
-    }
-    else
+    for ( int i = 0; i < num_monomers; i++ )
     {
-        return clustered_photolyzed_pag_indices.contains( pagIndex );
+        positions.append( species.position( i ) );
+        types.append( species.monomerType( i ) );
+        chains.append( species.chainIndex( i ) );
     }
-}
-
-
 
-void ExposureDialog::preparePhotolyzedPAGList()
-{
-    clustered_photolyzed_pag_indices.clear();
+    // a single bin up to the radius gives the average coordination number
+    RadialDistribution rdf( radius, radius );
 
-    if ( Random == exposure_type )
+    if ( false == rdf.compute( positions, types, chains, model.periodicBox() ) )
     {
-        return;
+        return 0.0;
     }
 
-    std::default_random_engine generator;
-    QRandomGenerator rng( seed );
+    return rdf.coordination( 0 );
+}
+
 
-    generator.seed( seed );
 
-    std::poisson_distribution<int> distribution( acids_per_photon );
+void ExposureDialog::dumpAcidAndQuencherLocations()
+{
+    const QString EXTENSION( ".csv" );
 
-    int target_num_acids = qRound( exposed_fraction * pag_indices.count() );
+    QString fileName = QFileDialog::getSaveFileName( this, tr( "Save Acid/Quencher Lcoations File" ), main_window->outputFolder(), tr( "CSV files (*.csv)" ) );
 
-    while ( clustered_photolyzed_pag_indices.count() < target_num_acids )
+    if ( false == fileName.isEmpty() )
     {
-        int current_cluster_size =  0;
-
-        while ( 0 == current_cluster_size )
+        if ( false == fileName.endsWith( EXTENSION, Qt::CaseInsensitive ) )
         {
-            current_cluster_size = distribution( generator );
+            fileName += EXTENSION;
         }
 
-        // randomly select a pag from the entire population of pags
-        int random_pag_selection = rng.bounded( pag_indices.count() - 1 );
-
-        int current_pag = pag_indices[random_pag_selection];
+        QFile outfile( fileName );
 
-        // add it to the exposed list if it is not already there
-        if ( false == clustered_photolyzed_pag_indices.contains( current_pag ) )
+        if ( outfile.open( QIODevice::WriteOnly | QIODevice::Text ) )
         {
-            clustered_photolyzed_pag_indices.append( current_pag );
-            current_cluster_size--;
+            QTextStream str( &outfile );
 
-            // now find all the nearby pags within acid_cluster_radius
-            QList<int>  nearby_pag_indices;
+            str << "x,y,z,monomer_name,monomer_id,chain_index\n";
+
+            // after an exposure the acids are the exposed PAGs, the quenchers left are the ones not neutralized
+            int exposed_type = model.species().exposed_type;
+            int quencher_type = model.species().quencher_type;
 
-            for ( int  i = 0; i < pag_indices.count(); i++ )
+            for ( int i = 0; i < species.count(); i++ )
             {
-                int queried_pag = pag_indices[i];
-                if ( ( current_pag != queried_pag ) &&
-                     isInVolume( current_pag, queried_pag, acid_cluster_radius ) &&
-                     false == nearby_pag_indices.contains( queried_pag ) )
+                Qwt3D::Triple pos = species.position( i );
+
+                if ( exposed_type == species.monomerType( i ) )
                 {
-                    nearby_pag_indices.append( queried_pag );
+                    str << QString( "%1,%2,%3,H+,%4,%5\n" ).arg( pos.x ).arg( pos.y ).arg( pos.z ).arg( exposed_type ).arg( species.chainIndex( i ) );
                 }
             }
 
-            // now randomly select nearby pags and add to the exposed list until the cluster size is reached
-            // stop if we exhaust the nearby pags before we get to the specifed cluster size,
-            // stop if we get to the specified cluster size
-            // and stop if we have reached the target number of acids
-            for ( int k = 0; ( k < nearby_pag_indices.count() ) &&
-                  ( 0 < current_cluster_size ) &&
-                  ( clustered_photolyzed_pag_indices.count() < target_num_acids ); k++ )
+            for ( int i = 0; i < species.count(); i++ )
             {
-                int nearby_pag = nearby_pag_indices.at( 1 == nearby_pag_indices.count() ? 0 : rng.bounded( nearby_pag_indices.count() - 1 ) );
+                Qwt3D::Triple pos = species.position( i );
 
-                if ( false == clustered_photolyzed_pag_indices.contains( nearby_pag ) )
+                if ( quencher_type == species.monomerType( i ) )
                 {
-                    clustered_photolyzed_pag_indices.append( nearby_pag );
-                    current_cluster_size--;
+                    str << QString( "%1,%2,%3,NR3,%4,%5\n" ).arg( pos.x ).arg( pos.y ).arg( pos.z ).arg( quencher_type ).arg( species.chainIndex( i ) );
                 }
             }
+            outfile.close();
         }
     }
-
-    qDebug() << "acid count:" << clustered_photolyzed_pag_indices.count() << ( double )( 100 * clustered_photolyzed_pag_indices.count() / ( double ) pag_indices.count() ) << "%";
 }
 
 
 
-double ExposureDialog::numberOfNeighbors( double radius )
+void ExposureDialog::profileDeprotection()
 {
-    int num_monomers = monomer_vector.size();
+    DeprotectionProfile profile( ui->slabWidthSpinBox->value(), ui->slabWidthSpinBox->value(), ui->edgeThresholdSpinBox->value() );
+
+    if ( false == profile.compute( species, model.species().protected_type, model.species().deprotected_type, model.periodicBox(), model.doseMap() ) )
+    {
+        ui->textEdit->append( QString( "no protecting groups to profile" ) );
+        return;
+    }
 
-    // always skip the first two members, they are used in qt opengl3d to set the volume extents on screen
+    ui->textEdit->append( QString( "Deprotection profile: %1 slabs, %2 edges in %3 of %4 rows" ).arg( profile.slabCount() )
+                          .arg( profile.edgesPerRow() ).arg( profile.rowsUsed() ).arg( profile.rowCount() ) );
 
-    qDebug() << QString( "monomer,neighbors" );
+    if ( 1 < profile.rowsUsed() )
+    {
+        ui->textEdit->append( QString( "Line width = %1 nm, LER (3 sigma) = %2 nm, LWR (3 sigma) = %3 nm" )
+                              .arg( profile.meanLineWidth() ).arg( profile.lineEdgeRoughness() ).arg( profile.lineWidthRoughness() ) );
+    }
 
-    int sum = 0;
-    for ( int i = 2; i < num_monomers; i++ )
+    // the profile goes next to the chain length file
+    if ( ui->saveGroupBox->isChecked() && !ui->fileNameEdit->text().isEmpty() )
     {
-        int num_neighbors = 0;
-        for ( int j = 2; j < num_monomers; j++ )
+        QFileInfo info( ui->fileNameEdit->text() );
+        QString profile_file = info.absolutePath() + "/" + info.completeBaseName() + "_profile.csv";
+
+        if ( profile.writeCSV( profile_file ) )
         {
-            if ( j != i )
-            {
-                if ( isInVolume( i, j, radius ) )
-                {
-                    num_neighbors++;
-                }
-            }
+            ui->textEdit->append( QString( "deprotection profile written to %1" ).arg( profile_file ) );
         }
-
-        sum += num_neighbors;
-        //      qDebug() << i << "," << num_neighbors;
     }
-
-    return ( double )sum / double( num_monomers );
 }
 
 
 
-void ExposureDialog::dumpAcidAndQuencherLocations()
+void ExposureDialog::developSolubleChains( const QVector<ExposureModel::ChainCounts>& chains )
 {
-    const QString EXTENSION( ".csv" );
+    QVector<char> soluble_chains( chains.count() );
 
-    QString fileName = QFileDialog::getSaveFileName( this, tr( "Save Acid/Quencher Lcoations File" ), main_window->outputFolder(), tr( "CSV files (*.csv)" ) );
+    for ( int c = 0; c < chains.count(); c++ )
+    {
+        soluble_chains[c] = chains[c].soluble;
+    }
 
-    if ( false == fileName.isEmpty() )
+    DissolutionAnalysis development( ui->contactRadiusSpinBox->value(), ui->roughnessBinSpinBox->value() );
+
+    if ( false == development.compute( species, soluble_chains, model.periodicBox() ) )
     {
-        if ( false == fileName.endsWith( EXTENSION, Qt::CaseInsensitive ) )
+        ui->textEdit->append( QString( "no model to develop" ) );
+        return;
+    }
+
+    ui->textEdit->append( QString( "Development: %1 clusters of soluble chains, %2 reach the top surface" ).arg( development.clusterCount() ).arg( development.dissolvedClusterCount() ) );
+    ui->textEdit->append( QString( "Number of dissolved chains = %1, dissolved volume fraction = %2" ).arg( development.dissolvedChainCount() ).arg( development.dissolvedFraction() ) );
+    ui->textEdit->append( QString( "Remaining film height = %1 nm, surface roughness (rms) = %2 nm" ).arg( development.meanHeight() ).arg( development.surfaceRoughness() ) );
+
+    if ( 1 < development.lineRows() )
+    {
+        ui->textEdit->append( QString( "Remaining line width = %1 nm, LER (3 sigma) = %2 nm, LWR (3 sigma) = %3 nm over %4 rows" ).arg( development.meanLineWidth() )
+                              .arg( development.lineEdgeRoughness() ).arg( development.lineWidthRoughness() ).arg( development.lineRows() ) );
+    }
+
+    // the clusters go next to the chain length file
+    if ( ui->saveGroupBox->isChecked() && !ui->fileNameEdit->text().isEmpty() )
+    {
+        QFileInfo info( ui->fileNameEdit->text() );
+        QString cluster_file = info.absolutePath() + "/" + info.completeBaseName() + "_dissolution.csv";
+
+        if ( development.writeCSV( cluster_file ) )
         {
-            fileName += EXTENSION;
+            ui->textEdit->append( QString( "soluble clusters written to %1" ).arg( cluster_file ) );
         }
+    }
+}
 
-        QFile outfile( fileName );
 
-        if ( outfile.open( QIODevice::WriteOnly | QIODevice::Text ) )
-        {
-            QTextStream str( &outfile );
 
-            str << "x,y,z,monomer_name,monomer_id,chain_index\n";
+void ExposureDialog::runSweep()
+{
+    QList<double> fractions;
+    int num_steps = ui->sweepStepsSpinBox->value();
+    double from = ui->sweepFromSpinBox->value();
+    double to = ui->sweepToSpinBox->value();
 
-            for ( int i = 0; i < clustered_photolyzed_pag_indices.count(); i++ )
-            {
-                int acid_index = clustered_photolyzed_pag_indices.at( i );
-                Qwt3D::Atom m = monomer_vector[acid_index];
-                str << QString( "%1,%2,%3,H+,%4,%5\n" ).arg( m.pos.x ).arg( m.pos.y ).arg( m.pos.z ).arg( m.monomer_type ).arg( m.chain_index );
-            }
+    for ( int i = 0; i < num_steps; i++ )
+    {
+        fractions.append( 1 == num_steps ? from : from + i * ( to - from ) / ( num_steps - 1 ) );
+    }
 
-            int quencher_type = ui->quencherComboBox->currentIndex();
+    QList<int> seeds;
+    for ( int k = 0; k < ui->sweepSeedsSpinBox->value(); k++ )
+    {
+        seeds.append( model.seed() + k );
+    }
 
-            for ( int j = 0; j < protected_and_quencher_indices.count(); j++ )
-            {
-                int species_index = protected_and_quencher_indices.at( j );
-                Qwt3D::Atom m = monomer_vector[species_index];
+    if ( ui->bakeGroupBox->isChecked() )
+    {
+        ui->textEdit->append( QString( "the dose sweep uses the reaction volume, the post-exposure bake is ignored" ) );
+    }
 
-                if ( quencher_type == m.monomer_type )
-                {
-                    str << QString( "%1,%2,%3,NR3,%4,%5\n" ).arg( m.pos.x ).arg( m.pos.y ).arg( m.pos.z ).arg( m.monomer_type ).arg( m.chain_index );
-                }
-            }
-            outfile.close();
+    ui->textEdit->append( QString( "dose sweep: %1 doses from %2 to %3, seeds %4 to %5..." ).arg( num_steps ).arg( from ).arg( to ).arg( seeds.first() ).arg( seeds.last() ) );
+
+    // the neighbour lists found in readInputs() are shared by every dose and seed
+    QList<ExposureModel::Result> results = model.sweep( fractions, seeds );
+
+    ui->textEdit->append( QString( "FractionExposed,Seed,NumExposedPAG,NumDeprotections,NumNeutralizations,DeprotectionExtent,NumSolubleChains,NumPolymerChains" ) );
+
+    for ( int i = 0; i < results.count(); i++ )
+    {
+        const ExposureModel::Result& r = results.at( i );
+        ui->textEdit->append( QString( "%1,%2,%3,%4,%5,%6,%7,%8" ).arg( r.exposed_fraction ).arg( r.seed ).arg( r.num_exposed ).arg( r.num_deprotections )
+                              .arg( r.num_neutralizations ).arg( r.deprotection_extent ).arg( r.num_soluble_chains ).arg( r.num_polymer_chains ) );
+    }
+
+    QString file_name = ui->sweepFileNameEdit->text();
+
+    if ( false == file_name.isEmpty() )
+    {
+        if ( ExposureModel::writeSweepCSV( file_name, results ) )
+        {
+            ui->textEdit->append( QString( "dose sweep saved to %1" ).arg( file_name ) );
+        }
+        else
+        {
+            ui->textEdit->append( QString( "could not write %1" ).arg( file_name ) );
         }
     }
 }
@@ -668,7 +634,16 @@ void ExposureDialog::apply()
 {
     apply_button->setEnabled( false );
     readInputs();
-    runCalculation();
+
+    if ( ui->sweepGroupBox->isChecked() )
+    {
+        runSweep();
+    }
+    else
+    {
+        runCalculation();
+    }
+
     if ( ui->saveGroupBox->isChecked() && !ui->fileNameEdit->text().isEmpty() )
     {
         QFile f( ui->fileNameEdit->text() );
@@ -701,6 +676,38 @@ void ExposureDialog::apply()
     settings.setValue( SOLBILITY_THRESHOLD_NAME, ui->solubilityThresholdSpinBox->value() );
 
     settings.setValue( EXPOSURE_TYPE_NAME, ui->exposureTypeComboBox->currentIndex() );
+    settings.setValue( PERIODIC_NAME, ui->periodicCheckBox->isChecked() );
+
+    settings.setValue( BAKE_NAME, ui->bakeGroupBox->isChecked() );
+    settings.setValue( BAKE_TIME_NAME, ui->bakeTimeSpinBox->value() );
+    settings.setValue( LATTICE_SPACING_NAME, ui->latticeSpacingSpinBox->value() );
+    settings.setValue( ACID_DIFFUSIVITY_NAME, ui->acidDiffusivitySpinBox->value() );
+    settings.setValue( QUENCHER_DIFFUSIVITY_NAME, ui->quencherDiffusivitySpinBox->value() );
+    settings.setValue( DEPROTECTION_RATE_NAME, ui->deprotectionRateSpinBox->value() );
+    settings.setValue( QUENCHING_RATE_NAME, ui->quenchingRateSpinBox->value() );
+    settings.setValue( RECORD_COUNT_NAME, ui->recordCountSpinBox->value() );
+
+    settings.setValue( DOSE_MAP_NAME, ui->doseMapGroupBox->isChecked() );
+    settings.setValue( DOSE_PROFILE_NAME, ui->doseProfileComboBox->currentIndex() );
+    settings.setValue( DOSE_AXIS_NAME, ui->doseAxisComboBox->currentIndex() );
+    settings.setValue( PITCH_NAME, ui->pitchSpinBox->value() );
+    settings.setValue( CONTRAST_NAME, ui->contrastSpinBox->value() );
+    settings.setValue( SPACE_WIDTH_NAME, ui->spaceWidthSpinBox->value() );
+    settings.setValue( EDGE_BLUR_NAME, ui->edgeBlurSpinBox->value() );
+    settings.setValue( SLAB_WIDTH_NAME, ui->slabWidthSpinBox->value() );
+    settings.setValue( EDGE_THRESHOLD_NAME, ui->edgeThresholdSpinBox->value() );
+    settings.setValue( DOSE_FILE_NAME, ui->doseFileNameEdit->text() );
+
+    settings.setValue( DEVELOP_NAME, ui->developGroupBox->isChecked() );
+    settings.setValue( CONTACT_RADIUS_NAME, ui->contactRadiusSpinBox->value() );
+    settings.setValue( ROUGHNESS_BIN_NAME, ui->roughnessBinSpinBox->value() );
+
+    settings.setValue( SWEEP_NAME, ui->sweepGroupBox->isChecked() );
+    settings.setValue( SWEEP_FROM_NAME, ui->sweepFromSpinBox->value() );
+    settings.setValue( SWEEP_TO_NAME, ui->sweepToSpinBox->value() );
+    settings.setValue( SWEEP_STEPS_NAME, ui->sweepStepsSpinBox->value() );
+    settings.setValue( SWEEP_SEEDS_NAME, ui->sweepSeedsSpinBox->value() );
+    settings.setValue( SWEEP_FILE_NAME, ui->sweepFileNameEdit->text() );
 
     settings.endGroup();
 
@@ -729,6 +736,38 @@ void ExposureDialog::selectFileButtonClicked()
 
 
 
+void ExposureDialog::sweepSelectFileButtonClicked()
+{
+    const QString EXTENSION( ".csv" );
+
+    QString fileName = QFileDialog::getSaveFileName( this, tr( "Save Dose Sweep" ), main_window->outputFolder(), tr( "CSV files (*.csv)" ) );
+
+    if ( false == fileName.isEmpty() )
+    {
+        if ( false == fileName.endsWith( EXTENSION, Qt::CaseInsensitive ) )
+        {
+            fileName += EXTENSION;
+        }
+
+        ui->sweepFileNameEdit->setText( fileName );
+        main_window->setOutputFolder( QFileInfo( fileName ).absolutePath() );
+    }
+}
+
+
+
+void ExposureDialog::doseFileButtonClicked()
+{
+    QString fileName = QFileDialog::getOpenFileName( this, tr( "Open Dose Map" ), main_window->outputFolder(), tr( "Dose maps (*.txt *.csv *.dat);;All files (*)" ) );
+
+    if ( false == fileName.isEmpty() )
+    {
+        ui->doseFileNameEdit->setText( fileName );
+    }
+}
+
+
+
 void ExposureDialog::reset()
 {
     main_window->reload();
@@ -28,7 +28,8 @@
 #include <QDialog>
 #include <QStringList>
 #include"qwt3d_types.h"
-#include <QRandomGenerator>
+#include "speciesstore.h"
+#include "exposuremodel.h"
 #include "monomerlist.h"
 #include "mainwindow.h"
 #include <QPushButton>
@@ -43,31 +44,17 @@ class ExposureDialog : public QDialog
 {
     Q_OBJECT
 
-    enum EXPOSURE_TYPE { Random, Clustered };
-
 public:
-    explicit ExposureDialog( MonomerList* monomerList, Qwt3D::AtomVector& monomers, MainWindow* parent );
+    explicit ExposureDialog( MonomerList* monomerList, SpeciesStore& speciesStore, MainWindow* parent );
     ~ExposureDialog();
 
 private:
     Ui::ExposureDialog* ui;
 
 protected:
-    int seed;
-    double exposed_fraction;
-    double deprotection_radius;
-    Qwt3D::AtomVector& monomer_vector;
+    SpeciesStore& species;
     MonomerList* monomer_list;
-    QList<int>  pag_indices;
-    QList<int>  protected_and_quencher_indices;
-    QList<int>  deprotected_indices;
-    QList<int>  neutralized_quencher_indices;
-    QList<int>  photolyzed_pag_indices;
-    QList<int>  clustered_photolyzed_pag_indices;
-    enum EXPOSURE_TYPE exposure_type;
-    double acid_cluster_radius;
-    double acids_per_photon;
-    QRandomGenerator rng;
+    ExposureModel model;
     QPushButton* apply_button;
     QPushButton* reset_button;
     MainWindow* main_window;
@@ -75,15 +62,17 @@ protected:
     void initialize();
     void readInputs();
     void runCalculation();
-    bool isInVolume( int pagIndex, int protectedIndex, double radius );
-    bool isExposed( int pagIndex );
-    void preparePhotolyzedPAGList();
     double numberOfNeighbors( double radius );
     void dumpAcidAndQuencherLocations();
+    void profileDeprotection();
+    void developSolubleChains( const QVector<ExposureModel::ChainCounts>& chains );
+    void runSweep();
 
 protected slots:
     virtual void apply();
     virtual void selectFileButtonClicked();
+    virtual void sweepSelectFileButtonClicked();
+    virtual void doseFileButtonClicked();
     virtual void reset();
     virtual void exposureTypeChanged( int newType );
 };
@@ -0,0 +1,1007 @@
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include "exposuremodel.h"
+#include "bakesimulator.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <QtConcurrent/QtConcurrentMap>
+#include <random>
+#include <math.h>
+
+// keys of the json configuration
+const QString PROTECTED_KEY( "protected" );
+const QString DEPROTECTED_KEY( "deprotected" );
+const QString PAG_KEY( "pag" );
+const QString EXPOSED_PAG_KEY( "exposed_pag" );
+const QString QUENCHER_KEY( "quencher" );
+const QString NEUTRALIZED_QUENCHER_KEY( "neutralized_quencher" );
+const QString IONIZABLE_KEY( "nonreactive_ionizable" );
+const QString FRACTION_EXPOSED_KEY( "fraction_exposed" );
+const QString SEED_KEY( "seed" );
+const QString REACTION_RADIUS_KEY( "reaction_radius" );
+const QString EXPOSURE_TYPE_KEY( "exposure_type" );
+const QString ACIDS_PER_PHOTON_KEY( "acids_per_photon" );
+const QString INTERACTION_RADIUS_KEY( "interaction_radius" );
+const QString SOLUBILITY_THRESHOLD_KEY( "solubility_threshold" );
+const QString PERIODIC_KEY( "periodic" );
+const QString BAKE_KEY( "bake" );
+const QString BAKE_TIME_KEY( "time" );
+const QString LATTICE_SPACING_KEY( "lattice_spacing" );
+const QString ACID_DIFFUSIVITY_KEY( "acid_diffusivity" );
+const QString QUENCHER_DIFFUSIVITY_KEY( "quencher_diffusivity" );
+const QString DEPROTECTION_RATE_KEY( "deprotection_rate" );
+const QString QUENCHING_RATE_KEY( "quenching_rate" );
+const QString RECORDS_KEY( "records" );
+const QString DOSE_MAP_KEY( "dose_map" );
+const QString DOSE_TYPE_KEY( "type" );
+const QString PITCH_KEY( "pitch" );
+const QString CONTRAST_KEY( "contrast" );
+const QString SPACE_WIDTH_KEY( "space_width" );
+const QString BLUR_KEY( "blur" );
+const QString AXIS_KEY( "axis" );
+const QString FILE_KEY( "file" );
+
+
+ExposureModel::ExposureModel( const SpeciesStore& speciesStore ) :
+    store( speciesStore ),
+    box(),
+    reaction_radius( 2.0 ),
+    exposure_type( Random ),
+    acids_per_photon( 3.0 ),
+    cluster_radius( 1.0 ),
+    solubility_threshold( 0.0 ),
+    exposed_fraction( 0.2 ),
+    random_seed( 1 ),
+    log_messages()
+{
+    species_types.protected_type = -1;
+    species_types.deprotected_type = -1;
+    species_types.pag_type = -1;
+    species_types.exposed_type = -1;
+    species_types.quencher_type = -1;
+    species_types.neutralized_type = -1;
+    species_types.ionizable_type = -1;
+
+    bake.enabled = false;
+    bake.time = 60.0;
+    bake.lattice_spacing = 1.0;
+    bake.acid_diffusivity = 1.0;
+    bake.quencher_diffusivity = 0.0;
+    bake.deprotection_rate = 1.0;
+    bake.quenching_rate = 10.0;
+    bake.records = 10;
+
+    setPeriodic( true );
+}
+
+
+
+void ExposureModel::setClustering( enum EXPOSURE_TYPE type, double acidsPerPhoton, double clusterRadius )
+{
+    exposure_type = type;
+    acids_per_photon = acidsPerPhoton;
+    cluster_radius = clusterRadius;
+}
+
+
+
+void ExposureModel::setPeriodic( bool periodic )
+{
+    // the packing wraps in x and y, and in z unless the model is a film or a brush
+    const Vector& box_size = store.boxSize();
+    box = PeriodicBox( Qwt3D::Triple( 0.0, 0.0, 0.0 ), Qwt3D::Triple( box_size.x, box_size.y, box_size.z ), periodic, periodic, periodic && store.isPeriodicInZ() );
+}
+
+
+
+static int monomerTypeFromJson( const QJsonValue& val, const QStringList& monomerNames )
+{
+    // a monomer is given by its name or by its index in the monomer list
+    if ( val.isString() )
+    {
+        return monomerNames.indexOf( val.toString() );
+    }
+
+    return val.isDouble() ? val.toInt() : -1;
+}
+
+
+
+static QJsonValue monomerTypeToJson( int type, const QStringList& monomerNames )
+{
+    if ( 0 <= type && type < monomerNames.count() )
+    {
+        return QJsonValue( monomerNames.at( type ) );
+    }
+
+    return QJsonValue( type );
+}
+
+
+
+bool ExposureModel::fromJson( const QJsonObject& config, const QStringList& monomerNames, const QString& configDir, QString& error )
+{
+    const QString required[] = { PROTECTED_KEY, DEPROTECTED_KEY, PAG_KEY, EXPOSED_PAG_KEY, FRACTION_EXPOSED_KEY, REACTION_RADIUS_KEY };
+
+    for ( const QString& key : required )
+    {
+        if ( false == config.contains( key ) )
+        {
+            error = QString( "'%1' is missing" ).arg( key );
+            return false;
+        }
+    }
+
+    int* types[] = { &species_types.protected_type, &species_types.deprotected_type, &species_types.pag_type, &species_types.exposed_type,
+                     &species_types.quencher_type, &species_types.neutralized_type, &species_types.ionizable_type
+                   };
+    const QString type_keys[] = { PROTECTED_KEY, DEPROTECTED_KEY, PAG_KEY, EXPOSED_PAG_KEY, QUENCHER_KEY, NEUTRALIZED_QUENCHER_KEY, IONIZABLE_KEY };
+
+    for ( int k = 0; k < 7; k++ )
+    {
+        *types[k] = -1;
+
+        if ( config.contains( type_keys[k] ) )
+        {
+            *types[k] = monomerTypeFromJson( config.value( type_keys[k] ), monomerNames );
+
+            if ( 0 > *types[k] || *types[k] >= monomerNames.count() )
+            {
+                error = QString( "unknown monomer for '%1'" ).arg( type_keys[k] );
+                return false;
+            }
+        }
+    }
+
+    exposed_fraction = config.value( FRACTION_EXPOSED_KEY ).toDouble();
+    random_seed = config.value( SEED_KEY ).toInt( 1 );
+    reaction_radius = config.value( REACTION_RADIUS_KEY ).toDouble();
+    solubility_threshold = config.value( SOLUBILITY_THRESHOLD_KEY ).toDouble( 0.0 );
+
+    QString type = config.value( EXPOSURE_TYPE_KEY ).toString( "random" );
+
+    if ( 0 != type.compare( "random", Qt::CaseInsensitive ) && 0 != type.compare( "clustered", Qt::CaseInsensitive ) )
+    {
+        error = QString( "exposure type '%1' is neither 'random' nor 'clustered'" ).arg( type );
+        return false;
+    }
+
+    setClustering( 0 == type.compare( "clustered", Qt::CaseInsensitive ) ? Clustered : Random,
+                   config.value( ACIDS_PER_PHOTON_KEY ).toDouble( 3.0 ), config.value( INTERACTION_RADIUS_KEY ).toDouble( 1.0 ) );
+
+    setPeriodic( config.value( PERIODIC_KEY ).toBool( true ) );
+
+    // a bake object replaces the reaction volume by the reaction-diffusion simulation
+    bake.enabled = config.contains( BAKE_KEY );
+
+    if ( bake.enabled )
+    {
+        QJsonObject bake_obj = config.value( BAKE_KEY ).toObject();
+
+        bake.time = bake_obj.value( BAKE_TIME_KEY ).toDouble( bake.time );
+        bake.lattice_spacing = bake_obj.value( LATTICE_SPACING_KEY ).toDouble( bake.lattice_spacing );
+        bake.acid_diffusivity = bake_obj.value( ACID_DIFFUSIVITY_KEY ).toDouble( bake.acid_diffusivity );
+        bake.quencher_diffusivity = bake_obj.value( QUENCHER_DIFFUSIVITY_KEY ).toDouble( bake.quencher_diffusivity );
+        bake.deprotection_rate = bake_obj.value( DEPROTECTION_RATE_KEY ).toDouble( bake.deprotection_rate );
+        bake.quenching_rate = bake_obj.value( QUENCHING_RATE_KEY ).toDouble( bake.quenching_rate );
+        bake.records = bake_obj.value( RECORDS_KEY ).toInt( bake.records );
+    }
+
+    // without a dose map the exposure is uniform
+    dose_map.setUniform();
+
+    if ( config.contains( DOSE_MAP_KEY ) )
+    {
+        QJsonObject map_obj = config.value( DOSE_MAP_KEY ).toObject();
+        QString map_type = map_obj.value( DOSE_TYPE_KEY ).toString();
+        QJsonValue axis_val = map_obj.value( AXIS_KEY );
+        int axis = axis_val.isString() ? QString( "xyz" ).indexOf( axis_val.toString().toLower() ) : axis_val.toInt( 0 );
+        double pitch = map_obj.value( PITCH_KEY ).toDouble( 0.0 );
+
+        if ( 0 > axis || 2 < axis )
+        {
+            error = QString( "dose map axis must be x, y or z" );
+            return false;
+        }
+
+        if ( "file" == map_type )
+        {
+            if ( false == dose_map.readFile( QDir( configDir ).filePath( map_obj.value( FILE_KEY ).toString() ), error ) )
+            {
+                return false;
+            }
+        }
+        else if ( ( "sinusoid" == map_type || "line_space" == map_type ) && pitch > 0.0 )
+        {
+            if ( "sinusoid" == map_type )
+            {
+                dose_map.setSinusoid( pitch, map_obj.value( CONTRAST_KEY ).toDouble( 1.0 ), axis );
+            }
+            else
+            {
+                dose_map.setLineSpace( pitch, map_obj.value( SPACE_WIDTH_KEY ).toDouble( 0.5 * pitch ), map_obj.value( BLUR_KEY ).toDouble( 0.0 ), axis );
+            }
+        }
+        else
+        {
+            error = QString( "dose map needs a type of 'sinusoid', 'line_space' or 'file' and a pitch" );
+            return false;
+        }
+    }
+
+    // a clustered exposure draws cluster sizes from a Poisson distribution of this mean until one is nonzero
+    if ( exposed_fraction < 0.0 || exposed_fraction > 1.0 || reaction_radius < 0.0 || acids_per_photon <= 0.0 || cluster_radius <= 0.0 ||
+         ( bake.enabled && ( bake.lattice_spacing <= 0.0 || bake.records < 1 || bake.time < 0.0 || bake.acid_diffusivity < 0.0 ||
+                             bake.quencher_diffusivity < 0.0 || bake.deprotection_rate < 0.0 || bake.quenching_rate < 0.0 ) ) )
+    {
+        error = QString( "parameter out of range" );
+        return false;
+    }
+
+    return true;
+}
+
+
+
+QJsonObject ExposureModel::toJson( const QStringList& monomerNames ) const
+{
+    QJsonObject obj;
+
+    obj.insert( PROTECTED_KEY, monomerTypeToJson( species_types.protected_type, monomerNames ) );
+    obj.insert( DEPROTECTED_KEY, monomerTypeToJson( species_types.deprotected_type, monomerNames ) );
+    obj.insert( PAG_KEY, monomerTypeToJson( species_types.pag_type, monomerNames ) );
+    obj.insert( EXPOSED_PAG_KEY, monomerTypeToJson( species_types.exposed_type, monomerNames ) );
+    obj.insert( QUENCHER_KEY, monomerTypeToJson( species_types.quencher_type, monomerNames ) );
+    obj.insert( NEUTRALIZED_QUENCHER_KEY, monomerTypeToJson( species_types.neutralized_type, monomerNames ) );
+    obj.insert( IONIZABLE_KEY, monomerTypeToJson( species_types.ionizable_type, monomerNames ) );
+    obj.insert( FRACTION_EXPOSED_KEY, exposed_fraction );
+    obj.insert( SEED_KEY, random_seed );
+    obj.insert( REACTION_RADIUS_KEY, reaction_radius );
+    obj.insert( EXPOSURE_TYPE_KEY, Clustered == exposure_type ? "clustered" : "random" );
+    obj.insert( ACIDS_PER_PHOTON_KEY, acids_per_photon );
+    obj.insert( INTERACTION_RADIUS_KEY, cluster_radius );
+    obj.insert( SOLUBILITY_THRESHOLD_KEY, solubility_threshold );
+    obj.insert( PERIODIC_KEY, box.isPeriodic( 0 ) );
+
+    if ( bake.enabled )
+    {
+        QJsonObject bake_obj;
+
+        bake_obj.insert( BAKE_TIME_KEY, bake.time );
+        bake_obj.insert( LATTICE_SPACING_KEY, bake.lattice_spacing );
+        bake_obj.insert( ACID_DIFFUSIVITY_KEY, bake.acid_diffusivity );
+        bake_obj.insert( QUENCHER_DIFFUSIVITY_KEY, bake.quencher_diffusivity );
+        bake_obj.insert( DEPROTECTION_RATE_KEY, bake.deprotection_rate );
+        bake_obj.insert( QUENCHING_RATE_KEY, bake.quenching_rate );
+        bake_obj.insert( RECORDS_KEY, bake.records );
+
+        obj.insert( BAKE_KEY, bake_obj );
+    }
+
+    if ( false == dose_map.isUniform() )
+    {
+        QJsonObject map_obj;
+
+        if ( DoseMap::Sampled == dose_map.type() )
+        {
+            map_obj.insert( DOSE_TYPE_KEY, "file" );
+            map_obj.insert( FILE_KEY, dose_map.fileName() );
+        }
+        else
+        {
+            map_obj.insert( DOSE_TYPE_KEY, DoseMap::Sinusoid == dose_map.type() ? "sinusoid" : "line_space" );
+            map_obj.insert( PITCH_KEY, dose_map.pitch() );
+            map_obj.insert( AXIS_KEY, QString( "xyz" ).mid( dose_map.axis(), 1 ) );
+
+            if ( DoseMap::Sinusoid == dose_map.type() )
+            {
+                map_obj.insert( CONTRAST_KEY, dose_map.imageContrast() );
+            }
+            else
+            {
+                map_obj.insert( SPACE_WIDTH_KEY, dose_map.spaceWidth() );
+                map_obj.insert( BLUR_KEY, dose_map.edgeBlur() );
+            }
+        }
+
+        obj.insert( DOSE_MAP_KEY, map_obj );
+    }
+
+    return obj;
+}
+
+
+
+bool ExposureModel::isInVolume( int centerIndex, int queriedIndex, double radius ) const
+{
+    Qwt3D::Triple d = box.separation( store.position( centerIndex ), store.position( queriedIndex ) );
+
+    double distance = sqrt( pow( d.x, 2.0 ) + pow( d.y, 2.0 ) + pow( d.z, 2.0 ) );
+    return ( distance <= radius );
+}
+
+
+
+void ExposureModel::findNeighbors( const QVector<int>& targets, double radius, QVector<int>& start, QVector<int>& neighbors ) const
+{
+    QVector<Qwt3D::Triple> positions;
+    positions.reserve( targets.count() );
+
+    for ( int i = 0; i < targets.count(); i++ )
+    {
+        positions.append( store.position( targets[i] ) );
+    }
+
+    SpatialIndex index;
+    index.build( box, radius, positions );
+
+    start.fill( 0, pag_indices.count() + 1 );
+    neighbors.clear();
+
+    QVector<int> nearby;
+
+    for ( int i = 0; i < pag_indices.count(); i++ )
+    {
+        int pag = pag_indices[i];
+
+        index.candidates( store.position( pag ), radius, nearby );
+
+        for ( int n = 0; n < nearby.count(); n++ )
+        {
+            int target = targets[nearby[n]];
+
+            if ( target != pag && isInVolume( pag, target, radius ) )
+            {
+                neighbors.append( nearby[n] );
+            }
+        }
+
+        start[i + 1] = neighbors.count();
+    }
+}
+
+
+
+void ExposureModel::prepare()
+{
+    pag_indices.clear();
+    reactive_indices.clear();
+
+    for ( int i = 0; i < store.count(); i++ )
+    {
+        int monomer_type = store.monomerType( i );
+
+        if ( species_types.protected_type == monomer_type  || species_types.quencher_type == monomer_type )
+        {
+            reactive_indices.append( i );
+        }
+
+        if ( species_types.pag_type == monomer_type )
+        {
+            pag_indices.append( i );
+        }
+    }
+
+    // with a bake the reactions are left to the reaction-diffusion simulation
+    if ( bake.enabled )
+    {
+        reactive_start.fill( 0, pag_indices.count() + 1 );
+        reactive_neighbors.clear();
+    }
+    else
+    {
+        findNeighbors( reactive_indices, reaction_radius, reactive_start, reactive_neighbors );
+    }
+
+    if ( Clustered == exposure_type )
+    {
+        findNeighbors( pag_indices, cluster_radius, pag_start, pag_neighbors );
+    }
+    else
+    {
+        pag_start.clear();
+        pag_neighbors.clear();
+    }
+
+    // the relative dose of every PAG is looked up once, the runs only scale it
+    pag_dose.clear();
+
+    if ( false == dose_map.isUniform() )
+    {
+        QVector<Qwt3D::Triple> positions;
+        positions.reserve( pag_indices.count() );
+
+        for ( int i = 0; i < pag_indices.count(); i++ )
+        {
+            positions.append( store.position( pag_indices[i] ) );
+        }
+
+        dose_map.evaluate( box, positions, pag_dose );
+    }
+}
+
+
+
+void ExposureModel::selectRandom( double exposedFraction, int seed, QVector<char>& exposed ) const
+{
+    QRandomGenerator rng( seed );
+
+    if ( pag_dose.isEmpty() )
+    {
+        for ( int i = 0; i < pag_indices.count(); i++ )
+        {
+            exposed[i] = ( rng.generateDouble() < exposedFraction );
+        }
+    }
+    else
+    {
+        const float* dose = pag_dose.constData();
+
+        for ( int i = 0; i < pag_indices.count(); i++ )
+        {
+            exposed[i] = ( rng.generateDouble() < exposedFraction * dose[i] );
+        }
+    }
+}
+
+
+
+void ExposureModel::selectClustered( double exposedFraction, int seed, QVector<char>& exposed ) const
+{
+    std::default_random_engine generator;
+    QRandomGenerator rng( seed );
+
+    generator.seed( seed );
+
+    std::poisson_distribution<int> distribution( acids_per_photon );
+
+    int num_pags = pag_indices.count();
+    int target_num_acids = qRound( exposedFraction * num_pags );
+
+    // the photon never lands on the last PAG directly, so a target above that could not be reached
+    int num_reachable = num_pags - 1;
+
+    // with a dose map the photons arrive in proportion to the dose, none where it is zero
+    if ( false == pag_dose.isEmpty() )
+    {
+        double total_dose = 0.0;
+        num_reachable = 0;
+
+        for ( int i = 0; i < num_pags; i++ )
+        {
+            total_dose += pag_dose[i];
+            if ( i < num_pags - 1 && 0.0f < pag_dose[i] ) num_reachable++;
+        }
+
+        target_num_acids = qRound( exposedFraction * total_dose );
+    }
+
+    if ( target_num_acids > num_reachable )
+    {
+        target_num_acids = num_reachable;
+    }
+
+    int num_acids = 0;
+
+    while ( num_acids < target_num_acids )
+    {
+        int current_cluster_size =  0;
+
+        while ( 0 == current_cluster_size )
+        {
+            current_cluster_size = distribution( generator );
+        }
+
+        int current_pag = rng.bounded( num_pags - 1 );
+
+        if ( false == pag_dose.isEmpty() && rng.generateDouble() >= pag_dose[current_pag] )
+        {
+            continue;
+        }
+
+        if ( false == exposed[current_pag] )
+        {
+            exposed[current_pag] = true;
+            num_acids++;
+            current_cluster_size--;
+
+            int first = pag_start[current_pag];
+            int num_nearby = pag_start[current_pag + 1] - first;
+
+            for ( int k = 0; ( k < num_nearby ) && ( 0 < current_cluster_size ) && ( num_acids < target_num_acids ); k++ )
+            {
+                int nearby_pag = pag_neighbors[first + ( 1 == num_nearby ? 0 : rng.bounded( num_nearby - 1 ) )];
+
+                if ( false == exposed[nearby_pag] )
+                {
+                    exposed[nearby_pag] = true;
+                    num_acids++;
+                    current_cluster_size--;
+                }
+            }
+        }
+    }
+}
+
+
+
+void ExposureModel::select( double exposedFraction, int seed, QVector<char>& exposed ) const
+{
+    exposed.fill( false, pag_indices.count() );
+
+    if ( Clustered == exposure_type )
+    {
+        selectClustered( exposedFraction, seed, exposed );
+    }
+    else
+    {
+        selectRandom( exposedFraction, seed, exposed );
+    }
+}
+
+
+
+void ExposureModel::react( const QVector<char>& exposed, QVector<qint16>& types, Result& result ) const
+{
+    const char IS_ACTIVE = 0;
+    const char IS_DEPROTECTED = 1;
+    const char IS_NEUTRALIZED = 2;
+
+    QVector<char> state( reactive_indices.count(), IS_ACTIVE );
+
+    for ( int i = 0; i < pag_indices.count(); i++ )
+    {
+        if ( false == exposed[i] )
+        {
+            continue;
+        }
+
+        // the catalytic chain ends at the first quencher in the reaction volume
+        for ( int n = reactive_start[i]; n < reactive_start[i + 1]; n++ )
+        {
+            int j = reactive_neighbors[n];
+
+            if ( IS_NEUTRALIZED == state[j] )
+            {
+                continue;
+            }
+
+            if ( species_types.quencher_type == types[reactive_indices[j]] )
+            {
+                state[j] = IS_NEUTRALIZED;
+                result.num_neutralizations++;
+                break;
+            }
+
+            state[j] = IS_DEPROTECTED;
+            result.num_deprotections++;
+        }
+    }
+
+    for ( int j = 0; j < reactive_indices.count(); j++ )
+    {
+        if ( IS_DEPROTECTED == state[j] )
+        {
+            types[reactive_indices[j]] = species_types.deprotected_type;
+        }
+        else if ( IS_NEUTRALIZED == state[j] )
+        {
+            types[reactive_indices[j]] = species_types.neutralized_type;
+        }
+    }
+}
+
+
+
+void ExposureModel::reactByBake( const QVector<char>& exposed, QVector<qint16>& types, Result& result, const QString& bakeFileName )
+{
+    BakeSimulator simulator( box, bake.lattice_spacing );
+
+    simulator.setDiffusivities( bake.acid_diffusivity, bake.quencher_diffusivity );
+    simulator.setRateConstants( bake.deprotection_rate, bake.quenching_rate );
+    simulator.setSeed( random_seed );
+
+    for ( int i = 0; i < pag_indices.count(); i++ )
+    {
+        if ( exposed[i] )
+        {
+            simulator.addAcid( store.position( pag_indices[i] ) );
+        }
+    }
+
+    for ( int j = 0; j < reactive_indices.count(); j++ )
+    {
+        int index = reactive_indices[j];
+
+        if ( species_types.quencher_type == types[index] )
+        {
+            simulator.addQuencher( index, store.position( index ) );
+        }
+        else
+        {
+            simulator.addProtectingGroup( index, store.position( index ), store.chainIndex( index ) );
+        }
+    }
+
+    log_messages.append( QString( "baking..." ) );
+
+    simulator.start();
+    simulator.record();
+
+    for ( int r = 1; r <= bake.records; r++ )
+    {
+        simulator.advance( bake.time * r / bake.records );
+        simulator.record();
+
+        log_messages.append( QString( " t = %1 s: %2 deprotected, %3 acid and %4 quencher left" )
+                             .arg( simulator.time() ).arg( simulator.deprotectedCount() ).arg( simulator.acidAmount() ).arg( simulator.quencherAmount() ) );
+    }
+
+    QList<int> deprotected;
+    QList<int> neutralized;
+
+    simulator.finish( deprotected, neutralized );
+
+    result.num_deprotections = deprotected.count();
+    result.num_neutralizations = neutralized.count();
+
+    for ( int k = 0; k < deprotected.count(); k++ )
+    {
+        types[deprotected[k]] = species_types.deprotected_type;
+    }
+
+    for ( int n = 0; n < neutralized.count(); n++ )
+    {
+        types[neutralized[n]] = species_types.neutralized_type;
+    }
+
+    if ( false == bakeFileName.isEmpty() )
+    {
+        if ( simulator.writeCSV( bakeFileName ) )
+        {
+            log_messages.append( QString( "deprotection per chain written to %1" ).arg( bakeFileName ) );
+        }
+        else
+        {
+            log_messages.append( QString( "could not write %1" ).arg( bakeFileName ) );
+        }
+    }
+}
+
+
+
+void ExposureModel::tally( const QVector<qint16>& types, Result& result, QVector<ChainCounts>* chains ) const
+{
+    // per chain statistics, chains count from 1 and point cloud particles all go to the unused entry 0
+    int num_chains = store.maxChainIndex();
+
+    ChainCounts empty = { 0, 0, 0, 0, 0, 0, 0, 0, false };
+    QVector<ChainCounts> local;
+    QVector<ChainCounts>& counts = ( 0 != chains ) ? *chains : local;
+    counts.fill( empty, num_chains + 1 );
+
+    int final_count_deprotected = 0;
+    int final_count_protected = 0;
+    int final_count_ionizable = 0;
+
+    for ( int i = 0; i < store.count(); i++ )
+    {
+        int monomer_type = types[i];
+        ChainCounts& c = counts[qMax( 0, store.chainIndex( i ) )];
+
+        c.length++;
+
+        if ( species_types.protected_type == monomer_type )
+        {
+            c.protected_groups++;
+            final_count_protected++;
+        }
+
+        if ( species_types.deprotected_type == monomer_type )
+        {
+            c.deprotected++;
+            final_count_deprotected++;
+        }
+
+        if ( species_types.neutralized_type == monomer_type )
+        {
+            c.neutralized++;
+        }
+
+        if ( species_types.quencher_type == monomer_type )
+        {
+            c.quenchers++;
+        }
+
+        if ( species_types.exposed_type == monomer_type )
+        {
+            c.exposed_pags++;
+        }
+
+        if ( species_types.pag_type == monomer_type )
+        {
+            c.pags++;
+        }
+
+        if ( species_types.ionizable_type == monomer_type )
+        {
+            c.ionizable++;
+            final_count_ionizable++;
+        }
+    }
+
+    result.num_polymer_chains = 0;
+    result.num_soluble_chains = 0;
+
+    for ( int k = 1; k < counts.count(); k++ )
+    {
+        ChainCounts& c = counts[k];
+
+        // chains without protecting groups or ionizable monomers are not polymer
+        if ( 0 == c.deprotected && 0 == c.ionizable && 0 == c.protected_groups )
+        {
+            continue;
+        }
+
+        result.num_polymer_chains++;
+
+        if ( ( double )( c.deprotected + c.ionizable ) / ( double ) c.length > solubility_threshold )
+        {
+            c.soluble = true;
+            result.num_soluble_chains++;
+        }
+    }
+
+    int num_protecting = final_count_deprotected + final_count_protected;
+    result.deprotection_extent = ( 0 < num_protecting ) ? ( double ) final_count_deprotected / num_protecting : 0.0;
+    result.ionizable_fraction = ( 0 < store.count() ) ? ( double )( final_count_deprotected + final_count_ionizable ) / store.count() : 0.0;
+}
+
+
+
+ExposureModel::Result ExposureModel::run( double exposedFraction, int seed, QVector<qint16>& types, QVector<ChainCounts>* chains ) const
+{
+    Result result;
+    result.exposed_fraction = exposedFraction;
+    result.seed = seed;
+    result.num_exposed = 0;
+    result.num_deprotections = 0;
+    result.num_neutralizations = 0;
+
+    QVector<char> exposed;
+    select( exposedFraction, seed, exposed );
+
+    for ( int i = 0; i < exposed.count(); i++ )
+    {
+        if ( exposed[i] ) result.num_exposed++;
+    }
+
+    react( exposed, types, result );
+
+    for ( int i = 0; i < pag_indices.count(); i++ )
+    {
+        if ( exposed[i] )
+        {
+            types[pag_indices[i]] = species_types.exposed_type;
+        }
+    }
+
+    tally( types, result, chains );
+
+    return result;
+}
+
+
+
+ExposureModel::Result ExposureModel::expose( QVector<qint16>& types, QVector<ChainCounts>& chains, const QString& bakeFileName )
+{
+    log_messages.clear();
+
+    if ( false == bake.enabled )
+    {
+        return run( exposed_fraction, random_seed, types, &chains );
+    }
+
+    Result result;
+    result.exposed_fraction = exposed_fraction;
+    result.seed = random_seed;
+    result.num_exposed = 0;
+    result.num_deprotections = 0;
+    result.num_neutralizations = 0;
+
+    QVector<char> exposed;
+    select( exposed_fraction, random_seed, exposed );
+
+    for ( int i = 0; i < exposed.count(); i++ )
+    {
+        if ( exposed[i] ) result.num_exposed++;
+    }
+
+    reactByBake( exposed, types, result, bakeFileName );
+
+    for ( int i = 0; i < pag_indices.count(); i++ )
+    {
+        if ( exposed[i] )
+        {
+            types[pag_indices[i]] = species_types.exposed_type;
+        }
+    }
+
+    tally( types, result, &chains );
+
+    return result;
+}
+
+
+
+bool ExposureModel::writeChainCSV( const QString& fileName, const QVector<ChainCounts>& chains )
+{
+    QFile file( fileName );
+
+    if ( false == file.open( QFile::WriteOnly | QFile::Truncate ) )
+    {
+        return false;
+    }
+
+    QTextStream out( &file );
+
+    out << "ChainIndex,ChainLength,NumProtected,NumDeprotected,NumRemainingQuencher,NumNeutralizedQuencher,NumRemainingPAG,NumExposedPAG,NumNonReactiveIonizable,IsSoluble\n";
+
+    for ( int k = 1; k < chains.count(); k++ )
+    {
+        const ChainCounts& c = chains.at( k );
+
+        out << k << "," << c.length << "," << c.protected_groups << "," << c.deprotected << "," << c.quenchers << "," << c.neutralized << ","
+            << c.pags << "," << c.exposed_pags << "," << c.ionizable << "," << ( c.soluble ? 1 : 0 ) << "\n";
+    }
+
+    out.flush();
+
+    return QFile::NoError == file.error();
+}
+
+
+
+bool ExposureModel::writeSummaryJSON( const QString& fileName, const Result& result, const QStringList& monomerNames, const QJsonObject& profile ) const
+{
+    QFile file( fileName );
+
+    if ( false == file.open( QFile::WriteOnly | QFile::Truncate ) )
+    {
+        return false;
+    }
+
+    QJsonObject result_obj;
+
+    result_obj.insert( "monomers", store.count() );
+    result_obj.insert( "pags", pag_indices.count() );
+    result_obj.insert( "exposed_pags", result.num_exposed );
+    result_obj.insert( "deprotections", result.num_deprotections );
+    result_obj.insert( "neutralizations", result.num_neutralizations );
+    result_obj.insert( "deprotection_extent", result.deprotection_extent );
+    result_obj.insert( "ionizable_fraction", result.ionizable_fraction );
+    result_obj.insert( "polymer_chains", result.num_polymer_chains );
+    result_obj.insert( "soluble_chains", result.num_soluble_chains );
+
+    QJsonObject main_obj;
+
+    main_obj.insert( "config", toJson( monomerNames ) );
+    main_obj.insert( "result", result_obj );
+
+    if ( false == profile.isEmpty() )
+    {
+        main_obj.insert( "profile", profile );
+    }
+
+    QJsonDocument doc;
+    doc.setObject( main_obj );
+
+    file.write( doc.toJson( QJsonDocument::Indented ) );
+
+    return QFile::NoError == file.error();
+}
+
+
+
+QList<ExposureModel::Result> ExposureModel::sweep( const QList<double>& exposedFractions, const QList<int>& seeds ) const
+{
+    // one point per dose and seed, each on its own copy of the monomer types
+    QVector<Result> results( exposedFractions.count() * seeds.count() );
+
+    QVector<int> points;
+    for ( int i = 0; i < results.count(); i++ )
+    {
+        points.append( i );
+    }
+
+    QtConcurrent::blockingMap( points, [&]( int & point )
+    {
+        QVector<qint16> types = store.monomerTypes();
+        results[point] = run( exposedFractions.at( point / seeds.count() ), seeds.at( point % seeds.count() ), types );
+    } );
+
+    return results.toList();
+}
+
+
+
+bool ExposureModel::writeSweepCSV( const QString& fileName, const QList<Result>& results )
+{
+    QFile file( fileName );
+
+    if ( false == file.open( QFile::WriteOnly | QFile::Truncate ) )
+    {
+        return false;
+    }
+
+    QTextStream out( &file );
+
+    out << "exposed_fraction,seeds,deprotection_extent,deprotection_extent_sd,soluble_fraction,soluble_fraction_sd,exposed_pags,neutralizations\n";
+
+    // results of one dose are consecutive, summarized over the seeds
+    for ( int first = 0; first < results.count(); )
+    {
+        int last = first;
+        while ( last < results.count() && results.at( last ).exposed_fraction == results.at( first ).exposed_fraction )
+        {
+            last++;
+        }
+
+        int n = last - first;
+        double extent = 0.0, extent_sq = 0.0, soluble = 0.0, soluble_sq = 0.0, exposed = 0.0, neutralized = 0.0;
+
+        for ( int i = first; i < last; i++ )
+        {
+            const Result& r = results.at( i );
+            double f = ( 0 < r.num_polymer_chains ) ? ( double ) r.num_soluble_chains / r.num_polymer_chains : 0.0;
+
+            extent += r.deprotection_extent;
+            extent_sq += r.deprotection_extent * r.deprotection_extent;
+            soluble += f;
+            soluble_sq += f * f;
+            exposed += r.num_exposed;
+            neutralized += r.num_neutralizations;
+        }
+
+        extent /= n;
+        soluble /= n;
+
+        double extent_sd = ( 1 < n ) ? sqrt( qMax( 0.0, ( extent_sq - n * extent * extent ) / ( n - 1 ) ) ) : 0.0;
+        double soluble_sd = ( 1 < n ) ? sqrt( qMax( 0.0, ( soluble_sq - n * soluble * soluble ) / ( n - 1 ) ) ) : 0.0;
+
+        out << results.at( first ).exposed_fraction << "," << n << "," << extent << "," << extent_sd << ","
+            << soluble << "," << soluble_sd << "," << exposed / n << "," << neutralized / n << "\n";
+
+        first = last;
+    }
+
+    out.flush();
+
+    return QFile::NoError == file.error();
+}
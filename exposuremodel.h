@@ -0,0 +1,175 @@
+#ifndef EXPOSUREMODEL_H
+#define EXPOSUREMODEL_H
+
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+#include <QVector>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+
+#include "spatialindex.h"
+#include "speciesstore.h"
+#include "dosemap.h"
+
+// Exposure of a packing without any user interface: photolysis of the PAGs
+// (random or clustered), the acid catalysed deprotection and quenching
+// inside the reaction volume or by a post-exposure bake, and the per chain
+// solubility. The exposure dialog and the -E command line option are both
+// front ends to it. With a dose map the exposed fraction is the one at full
+// dose, each PAG is scaled by the relative dose at its position.
+//
+// The species lists and the neighbours of every PAG are found once in
+// prepare(); run() then exposes a copy of the monomer types for one dose
+// and seed, so any number of runs can share the prepared state and run in
+// parallel.
+
+class ExposureModel
+{
+public:
+    enum EXPOSURE_TYPE { Random, Clustered };
+
+    typedef struct
+    {
+        int protected_type;
+        int deprotected_type;
+        int pag_type;
+        int exposed_type;
+        int quencher_type;
+        int neutralized_type;
+        int ionizable_type;
+    } Species;
+
+    typedef struct
+    {
+        bool enabled;
+        double time;
+        double lattice_spacing;
+        double acid_diffusivity;
+        double quencher_diffusivity;
+        double deprotection_rate;
+        double quenching_rate;
+        int records;
+    } Bake;
+
+    typedef struct
+    {
+        double exposed_fraction;
+        int seed;
+        int num_exposed;
+        int num_deprotections;
+        int num_neutralizations;
+        double deprotection_extent;
+        double ionizable_fraction;
+        int num_polymer_chains;
+        int num_soluble_chains;
+    } Result;
+
+    typedef struct
+    {
+        int length;
+        int protected_groups;
+        int deprotected;
+        int quenchers;
+        int neutralized;
+        int pags;
+        int exposed_pags;
+        int ionizable;
+        bool soluble;
+    } ChainCounts;
+
+    ExposureModel( const SpeciesStore& speciesStore );
+
+    void setSpecies( const Species& s ) { species_types = s; }
+    void setReactionRadius( double r ) { reaction_radius = r; }
+    void setClustering( enum EXPOSURE_TYPE type, double acidsPerPhoton, double clusterRadius );
+    void setSolubilityThreshold( double t ) { solubility_threshold = t; }
+    void setPeriodic( bool periodic );
+    void setExposure( double exposedFraction, int seed ) { exposed_fraction = exposedFraction; random_seed = seed; }
+    void setBake( const Bake& b ) { bake = b; }
+    void setDoseMap( const DoseMap& map ) { dose_map = map; }
+
+    const Species& species() const { return species_types; }
+    const Bake& bakeParameters() const { return bake; }
+    const DoseMap& doseMap() const { return dose_map; }
+    const PeriodicBox& periodicBox() const { return box; }
+    double exposedFraction() const { return exposed_fraction; }
+    int seed() const { return random_seed; }
+
+    // relative file names in the configuration are relative to configDir
+    bool fromJson( const QJsonObject& config, const QStringList& monomerNames, const QString& configDir, QString& error );
+    QJsonObject toJson( const QStringList& monomerNames ) const;
+
+    void prepare();
+    Result run( double exposedFraction, int seed, QVector<qint16>& types, QVector<ChainCounts>* chains = 0 ) const;
+    Result expose( QVector<qint16>& types, QVector<ChainCounts>& chains, const QString& bakeFileName = QString() );
+    QList<Result> sweep( const QList<double>& exposedFractions, const QList<int>& seeds ) const;
+
+    int monomerCount() const { return store.count(); }
+    int pagCount() const { return pag_indices.count(); }
+    int reactiveCount() const { return reactive_indices.count(); }
+    const QStringList& messages() const { return log_messages; }
+
+    static bool writeChainCSV( const QString& fileName, const QVector<ChainCounts>& chains );
+    bool writeSummaryJSON( const QString& fileName, const Result& result, const QStringList& monomerNames, const QJsonObject& profile = QJsonObject() ) const;
+    static bool writeSweepCSV( const QString& fileName, const QList<Result>& results );
+
+protected:
+    const SpeciesStore& store;
+    PeriodicBox box;
+    Species species_types;
+    Bake bake;
+    double reaction_radius;
+    enum EXPOSURE_TYPE exposure_type;
+    double acids_per_photon;
+    double cluster_radius;
+    double solubility_threshold;
+    double exposed_fraction;
+    int random_seed;
+    QStringList log_messages;
+    DoseMap dose_map;
+
+    QVector<int> pag_indices;
+    QVector<int> reactive_indices;
+    QVector<float> pag_dose;
+
+    // per PAG, the reactive sites inside the reaction volume and the other
+    // PAGs inside the cluster radius, both in list order
+    QVector<int> reactive_start;
+    QVector<int> reactive_neighbors;
+    QVector<int> pag_start;
+    QVector<int> pag_neighbors;
+
+    bool isInVolume( int centerIndex, int queriedIndex, double radius ) const;
+    void findNeighbors( const QVector<int>& targets, double radius, QVector<int>& start, QVector<int>& neighbors ) const;
+    void select( double exposedFraction, int seed, QVector<char>& exposed ) const;
+    void selectRandom( double exposedFraction, int seed, QVector<char>& exposed ) const;
+    void selectClustered( double exposedFraction, int seed, QVector<char>& exposed ) const;
+    void react( const QVector<char>& exposed, QVector<qint16>& types, Result& result ) const;
+    void reactByBake( const QVector<char>& exposed, QVector<qint16>& types, Result& result, const QString& bakeFileName );
+    void tally( const QVector<qint16>& types, Result& result, QVector<ChainCounts>* chains ) const;
+};
+
+#endif // EXPOSUREMODEL_H
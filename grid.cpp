@@ -15,6 +15,8 @@
 #include <QDebug>
 #include <stdio.h>
 #include<stdlib.h>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
 #include "grid.h"
 #include "vector.h"
 #include "random.h"
@@ -40,6 +42,15 @@ void Grid_test( Grid* grid );
 
 #define OVER_RELAXATION 1.80
 
+#define JOURNAL_INCREMENT 4096
+
+Journal_Entry* Grid_journal_entry( Grid* grid, int kind, int nr );
+void Grid_journal_site( Grid* grid, int site_nr );
+void Grid_journal_empty( Grid* grid, int site_nr );
+void Grid_journal_chain( Grid* grid, int chain_nr );
+void Grid_journal_atom( Grid* grid, int chain_nr, int atom_nr );
+void Grid_journal_append( Grid* grid, int chain_nr, int atom_nr );
+
 /* ----------------------------------------------------------------------------------------- */
 void Grid_clear( Grid* grid )
 /* ----------------------------------------------------------------------------------------- */
@@ -56,9 +67,16 @@ void Grid_clear( Grid* grid )
         site->empty.next = i + 1;
         site->empty.prev = i - 1;
         site->marked = 0;
+        grid->site_overlap[i] = 0.0;
+        grid->overlap_dirty[i] = false;
     }
     grid->sites[0].empty.prev = NIL;
     grid->sites[grid->nr_sites - 1].empty.next = NIL;
+    grid->nr_dirty = 0;
+    for ( i = 0; i < 2 * grid->tree_size; i++ )
+        grid->overlap_tree[i] = 0.0;
+    grid->nr_journal = 0;
+    grid->nr_snapshots = 0;
 
     for ( i = 0; i < grid->max_chains; i++ )
     {
@@ -66,6 +84,7 @@ void Grid_clear( Grid* grid )
         grid->chains[i].offset = -nr;
         grid->chains[i].first = 0;
         grid->chains[i].last = 0;
+        grid->chains[i].dirty = 0;
     }
     grid->queue_first = 0;
     grid->queue_last = 0;
@@ -112,6 +131,17 @@ void Grid_init( Grid* grid, Parameters* params )
     grid->relaxed_atoms = NULL;
     grid->max_relaxed_atoms = 0;
 
+    grid->tree_size = 1;
+    while ( grid->tree_size < grid->nr_sites )
+        grid->tree_size *= 2;
+    grid->site_overlap = ( float* ) malloc( grid->nr_sites * sizeof( float ) );
+    grid->overlap_dirty = ( char* ) malloc( grid->nr_sites * sizeof( char ) );
+    grid->dirty_list = ( int* ) malloc( grid->nr_sites * sizeof( int ) );
+    grid->overlap_tree = ( float* ) malloc( 2 * grid->tree_size * sizeof( float ) );
+
+    grid->journal = NULL;
+    grid->max_journal = 0;
+
     Grid_clear( grid );
 }
 
@@ -130,6 +160,31 @@ void Grid_free( Grid* grid )
     free( ( void* )grid->marked_list );
     if ( grid->max_relaxed_atoms > 0 )
         free( ( void* )grid->relaxed_atoms );
+    free( ( void* )grid->site_overlap );
+    free( ( void* )grid->overlap_dirty );
+    free( ( void* )grid->dirty_list );
+    free( ( void* )grid->overlap_tree );
+    free( ( void* )grid->chains );
+    free( ( void* )grid->journal );
+
+    /* leave an empty grid behind, so that freeing twice is harmless */
+    grid->sites = NULL;
+    grid->chains = NULL;
+    grid->queue = NULL;
+    grid->marked_list = NULL;
+    grid->relaxed_atoms = NULL;
+    grid->site_overlap = NULL;
+    grid->overlap_dirty = NULL;
+    grid->dirty_list = NULL;
+    grid->overlap_tree = NULL;
+    grid->journal = NULL;
+    grid->nr_sites = 0;
+    grid->max_chains = 0;
+    grid->max_relaxed_atoms = 0;
+    grid->tree_size = 0;
+    grid->nr_journal = 0;
+    grid->max_journal = 0;
+    grid->nr_snapshots = 0;
 }
 
 
@@ -332,6 +387,19 @@ Vector Grid_vec_step( Grid* grid, Vector vec, int dir )
 
 
 
+/* ----------------------------------------------------------------------------------------- */
+void Grid_overlap_mark( Grid* grid, int site_nr )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* only flags the site, the overlap tree is brought up to date
+       lazily by Grid_overlap_update() */
+    if ( grid->overlap_dirty[site_nr] ) return;
+    grid->overlap_dirty[site_nr] = true;
+    grid->dirty_list[grid->nr_dirty] = site_nr;
+    grid->nr_dirty++;
+}
+
+
 /* ----------------------------------------------------------------------------------------- */
 void Grid_site_add_atom( Grid* grid, int chain_nr, int atom_nr, Vector vec )
 /* ----------------------------------------------------------------------------------------- */
@@ -350,10 +418,20 @@ void Grid_site_add_atom( Grid* grid, int chain_nr, int atom_nr, Vector vec )
         appWindow()->appendText( buffer );
         exit( 1 );
     }
+    if ( grid->nr_snapshots > 0 )
+    {
+        Grid_journal_site( grid, site_nr );
+        if ( nr == 0 )
+        {
+            Grid_journal_empty( grid, site->empty.prev );
+            if ( site->empty.next != NIL ) Grid_journal_empty( grid, site->empty.next );
+        }
+    }
     site->atoms[nr].chain_nr = chain_nr;
     site->atoms[nr].atom_nr = atom_nr;
     site->atoms[nr].vec = vec;
     site->nr_atoms++;
+    Grid_overlap_mark( grid, site_nr );
 
     if ( nr == 0 )    /* first atom */
     {
@@ -378,6 +456,8 @@ void Grid_site_add_atom( Grid* grid, int chain_nr, int atom_nr, Vector vec )
                 {
                     adj_nr = Grid_loc_to_site( grid, adj );
                     grid->sites[adj_nr].nr_occ_neighbours++;
+                    if ( grid->nr_snapshots > 0 )
+                        Grid_journal_entry( grid, JOURNAL_OCCUPANCY, adj_nr )->old.value = 1;
 
                     if ( adj.z == max_loc.z ) break;
                     adj.z++;
@@ -421,9 +501,20 @@ void Grid_site_remove_atom( Grid* grid, int chain_nr, int atom_nr )
         nr++;
     if ( nr >= site->nr_atoms ) return;
 
+    if ( grid->nr_snapshots > 0 )
+    {
+        Grid_journal_site( grid, site_nr );
+        if ( site->nr_atoms == 1 )
+        {
+            Grid_journal_empty( grid, site_nr );
+            Grid_journal_empty( grid, NIL );
+            if ( grid->first_empty != NIL ) Grid_journal_empty( grid, grid->first_empty );
+        }
+    }
     site->nr_atoms--;
     for ( i = nr; i < site->nr_atoms; i++ )
         site->atoms[i] = site->atoms[i + 1];
+    Grid_overlap_mark( grid, site_nr );
 
     if ( site->nr_atoms == 0 )
     {
@@ -447,6 +538,8 @@ void Grid_site_remove_atom( Grid* grid, int chain_nr, int atom_nr )
                 {
                     adj_nr = Grid_loc_to_site( grid, adj );
                     grid->sites[adj_nr].nr_occ_neighbours--;
+                    if ( grid->nr_snapshots > 0 )
+                        Grid_journal_entry( grid, JOURNAL_OCCUPANCY, adj_nr )->old.value = -1;
 
                     if ( adj.z == max_loc.z ) break;
                     adj.z++;
@@ -483,11 +576,34 @@ void Grid_new_chain( Grid* grid, int chain_nr )
             grid->chains[i].offset = 0;
             grid->chains[i].max_atoms = 0;
             grid->chains[i].atoms = NULL;
+            grid->chains[i].dirty = NO_ATOM;
         }
     }
 }
 
 
+/* ----------------------------------------------------------------------------------------- */
+void Grid_chain_mark( Grid* grid, int chain_nr, int atom_nr )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* lowers the watermark of the atoms a viewer has to redraw, appended
+       and removed atoms count as changed */
+    Chain* chain;
+
+    chain = &grid->chains[chain_nr];
+    if ( atom_nr < chain->dirty ) chain->dirty = atom_nr;
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+void Grid_chain_clean( Grid* grid, int chain_nr )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* the viewer has drawn the chain as it is now */
+    grid->chains[chain_nr].dirty = NO_ATOM;
+}
+
+
 /* ----------------------------------------------------------------------------------------- */
 int Grid_chain_append_atom( Grid* grid, int chain_nr, Vector vec, char head )
 /* ----------------------------------------------------------------------------------------- */
@@ -497,6 +613,7 @@ int Grid_chain_append_atom( Grid* grid, int chain_nr, Vector vec, char head )
 
     if ( chain_nr >= grid->max_chains ) Grid_new_chain( grid, chain_nr );
     chain = &grid->chains[chain_nr];
+    if ( grid->nr_snapshots > 0 ) Grid_journal_chain( grid, chain_nr );
 
     if ( chain->max_atoms == 0 )
     {
@@ -513,6 +630,7 @@ int Grid_chain_append_atom( Grid* grid, int chain_nr, Vector vec, char head )
             chain->max_atoms += MAX_ATOMS_INCREMENT;
             chain->atoms = ( Vector* )realloc( chain->atoms, chain->max_atoms * sizeof( Vector ) );
             chain->offset -= MAX_ATOMS_INCREMENT;
+            if ( grid->nr_snapshots > 0 ) Grid_journal_entry( grid, JOURNAL_SHIFT, chain_nr );
             for ( i = chain->last - chain->offset - 1; i >= chain->first - chain->offset; i-- )
                 chain->atoms[i] = chain->atoms[i - MAX_ATOMS_INCREMENT];
         }
@@ -529,7 +647,9 @@ int Grid_chain_append_atom( Grid* grid, int chain_nr, Vector vec, char head )
         nr = chain->last;
         chain->last++;
     }
+    if ( grid->nr_snapshots > 0 ) Grid_journal_append( grid, chain_nr, nr );
     chain->atoms[nr - chain->offset] = vec;
+    Grid_chain_mark( grid, chain_nr, nr );
     Grid_site_add_atom( grid, chain_nr, nr, vec );
     return nr;
 }
@@ -546,6 +666,13 @@ char Grid_chain_remove_atom( Grid* grid, int chain_nr, char head )
     chain = &grid->chains[chain_nr];
 
     if ( chain->first >= chain->last ) return false;
+    if ( grid->nr_snapshots > 0 )
+    {
+        /* the dropped atom may be overwritten before a rollback needs it */
+        Grid_journal_atom( grid, chain_nr, head ? chain->first : chain->last - 1 );
+        Grid_journal_chain( grid, chain_nr );
+    }
+    Grid_chain_mark( grid, chain_nr, head ? chain->first : chain->last - 1 );
     if ( head )
     {
         Grid_site_remove_atom( grid, chain_nr, chain->first );
@@ -572,10 +699,17 @@ char Grid_chain_remove( Grid* grid, int chain_nr )
 
     if ( chain->first >= chain->last ) return false;
 
+    if ( grid->nr_snapshots > 0 )
+    {
+        for ( nr = chain->first; nr < chain->last; nr++ )
+            Grid_journal_atom( grid, chain_nr, nr );
+        Grid_journal_chain( grid, chain_nr );
+    }
     for ( nr = chain->first; nr < chain->last; nr++ )
     {
         Grid_site_remove_atom( grid, chain_nr, nr );
     }
+    Grid_chain_mark( grid, chain_nr, chain->first );
     nr = chain->max_atoms / 2;
     chain->offset = -nr;
     chain->first = 0;
@@ -618,23 +752,21 @@ char Grid_chain_remove_tail( Grid* grid, int chain_nr )
 
 
 /* ----------------------------------------------------------------------------------------- */
-float Grid_overlap_atom( Grid* grid, Vector vec, int chain_nr, int atom_nr,
-                         int* overlap_chain, int* overlap_atom )
+float Grid_overlap_atoms( Grid* grid, Vector vec, int chain_nr, int atom_nr,
+                          int* overlap_chain, int* overlap_atom )
 /* ----------------------------------------------------------------------------------------- */
 {
-    /* chain_nr/atom_nr is the index of the new atom
-       used to neglect adjacent atoms */
+    /* atom-atom part of Grid_overlap_atom(), walls are not considered */
 
     Location loc, adj;
     Site* site;
     float d, ol, r, r1, r2, max;
-    float rad, radi1, box_height;
+    float rad;
     int i;
     Atom_Ref* atom;
 
     rad     = grid->params.atom_radius;
     if ( rad <= 0.0 ) rad = EPS;
-    radi1    = 1.0 / rad;
     r   = 2.0 * rad;
     r1  = 1.0 / r;
     r2  = r * r;
@@ -671,6 +803,26 @@ float Grid_overlap_atom( Grid* grid, Vector vec, int chain_nr, int atom_nr,
             }
         }
     }
+    return max;
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+float Grid_overlap_atom( Grid* grid, Vector vec, int chain_nr, int atom_nr,
+                         int* overlap_chain, int* overlap_atom )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* chain_nr/atom_nr is the index of the new atom
+       used to neglect adjacent atoms */
+
+    float ol, max;
+    float rad, radi1, box_height;
+    int i;
+
+    rad     = grid->params.atom_radius;
+    if ( rad <= 0.0 ) rad = EPS;
+    radi1    = 1.0 / rad;
+    max = Grid_overlap_atoms( grid, vec, chain_nr, atom_nr, overlap_chain, overlap_atom );
     if ( ( grid->params.brush || grid->params.film ) && ( atom_nr > grid->chains[chain_nr].first ) )
     {
         box_height = grid->params.box_size.z;
@@ -709,43 +861,118 @@ float Grid_overlap( Grid* grid, Vector vec, int chain_nr, int atom_nr )
 
 
 /* ----------------------------------------------------------------------------------------- */
-float Grid_max_overlap( Grid* grid, Grow_Parameters* grow_params )
+float Grid_site_overlap( Grid* grid, int site_nr )
 /* ----------------------------------------------------------------------------------------- */
 {
-    int nr, chain_nr;
+    int i, ol_chain, ol_atom;
     float ol, max;
-    Chain* chain;
-    int ol_chain, ol_atom;
-    int max_chain0, max_chain1, max_atom0, max_atom1;
+    Site* site;
+    Atom_Ref* atom;
 
+    site = &grid->sites[site_nr];
     max = 0.0;
-    for ( chain_nr = 0; chain_nr < grid->max_chains; chain_nr++ )
+    for ( i = 0; i < site->nr_atoms; i++ )
     {
-        chain = &grid->chains[chain_nr];
-        for ( nr = chain->first; nr < chain->last; nr++ )
-        {
-            ol = Grid_overlap_atom( grid, chain->atoms[nr - chain->offset], chain_nr, nr,
-                                    &ol_chain, &ol_atom );
-            if ( ( ol > max ) && ( -1 != ol_chain )  && ( -1 != ol_atom ) )
-            {
-                max = ol;
-                max_chain0 = ol_chain;
-                max_atom0 = ol_atom;
-                max_chain1 = chain_nr;
-                max_atom1 = nr;
-            }
+        atom = &site->atoms[i];
+        ol = Grid_overlap_atoms( grid, atom->vec, atom->chain_nr, atom->atom_nr,
+                                 &ol_chain, &ol_atom );
+        if ( ol > max ) max = ol;
+    }
+    return max;
+}
 
-            //            //    if ( ol > grow_params->max_overlap )
-            //            {
-            //                qDebug() << QString( "excess overlap %1 %2:%3 - %4:%5" ).arg( ol ).arg( ol_chain ).arg( ol_atom ).arg( chain_nr ).arg( nr );
-            //            }
 
+/* ----------------------------------------------------------------------------------------- */
+void Grid_overlap_tree_set( Grid* grid, int site_nr, float ol )
+/* ----------------------------------------------------------------------------------------- */
+{
+    int nr;
+    float* tree;
 
-        }
+    tree = grid->overlap_tree;
+    nr = grid->tree_size + site_nr;
+    tree[nr] = ol;
+    for ( nr = nr / 2; nr >= 1; nr = nr / 2 )
+        tree[nr] = ( tree[2 * nr] > tree[2 * nr + 1] ) ? tree[2 * nr] : tree[2 * nr + 1];
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+void Grid_overlap_update( Grid* grid )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* the overlap range 2 * atom_radius does not exceed the site width, so an
+       atom added to or removed from a site changes the overlap seen from that
+       site and its 26 neighbours only */
+
+    int i, nr, nr_changed, site_nr;
+    Location loc, adj;
+
+    nr_changed = grid->nr_dirty;
+    for ( i = 0; i < nr_changed; i++ )
+    {
+        loc = Grid_site_to_loc( grid, grid->dirty_list[i] );
+        for ( adj.x = loc.x - 1; adj.x <= loc.x + 1; adj.x++ )
+            for ( adj.y = loc.y - 1; adj.y <= loc.y + 1; adj.y++ )
+                for ( adj.z = loc.z - 1; adj.z <= loc.z + 1; adj.z++ )
+                    Grid_overlap_mark( grid, Grid_loc_to_site( grid, adj ) );
+    }
+    for ( nr = 0; nr < grid->nr_dirty; nr++ )
+    {
+        site_nr = grid->dirty_list[nr];
+        grid->overlap_dirty[site_nr] = false;
+        grid->site_overlap[site_nr] = Grid_site_overlap( grid, site_nr );
+        Grid_overlap_tree_set( grid, site_nr, grid->site_overlap[site_nr] );
     }
-    qDebug() << QString( "max overlap %1 %2:%3 - %4:%5" ).arg( max ).arg( max_chain0 ).arg( max_atom0 ).arg( max_chain1 ).arg( max_atom1 );
+    grid->nr_dirty = 0;
+}
 
-    return max;
+
+/* ----------------------------------------------------------------------------------------- */
+float Grid_max_overlap( Grid* grid )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* maximum atom-atom overlap of the packing, kept up to date
+       incrementally; only the sites changed since the last call
+       are recomputed */
+
+    Grid_overlap_update( grid );
+    return grid->overlap_tree[1];
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+float Grid_max_overlap_exact( Grid* grid )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* recompute the overlap of every site from scratch, one z layer per task,
+       and rebuild the overlap tree */
+
+    int i, layer_len;
+    float* tree;
+    QVector<int> layers;
+
+    layer_len = grid->Lx * grid->Ly;
+    for ( i = 0; i < grid->nr_sites; i += layer_len )
+        layers.append( i );
+
+    QtConcurrent::blockingMap( layers, [grid, layer_len]( int & first )
+    {
+        for ( int nr = first; nr < first + layer_len; nr++ )
+            grid->site_overlap[nr] = Grid_site_overlap( grid, nr );
+    } );
+
+    tree = grid->overlap_tree;
+    for ( i = 0; i < grid->tree_size; i++ )
+        tree[grid->tree_size + i] = ( i < grid->nr_sites ) ? grid->site_overlap[i] : 0.0;
+    for ( i = grid->tree_size - 1; i >= 1; i-- )
+        tree[i] = ( tree[2 * i] > tree[2 * i + 1] ) ? tree[2 * i] : tree[2 * i + 1];
+
+    for ( i = 0; i < grid->nr_dirty; i++ )
+        grid->overlap_dirty[grid->dirty_list[i]] = false;
+    grid->nr_dirty = 0;
+
+    return tree[1];
 }
 
 
@@ -955,7 +1182,9 @@ void Grid_reset_relaxed_atoms( Grid* grid )
         Grid_site_remove_atom( grid, atom->chain_nr, atom->atom_nr );
         Grid_site_add_atom( grid, atom->chain_nr, atom->atom_nr, atom->vec );
         chain = &grid->chains[atom->chain_nr];
+        if ( grid->nr_snapshots > 0 ) Grid_journal_atom( grid, atom->chain_nr, atom->atom_nr );
         chain->atoms[atom->atom_nr - chain->offset] = atom->vec;
+        Grid_chain_mark( grid, atom->chain_nr, atom->atom_nr );
     }
     grid->nr_relaxed_atoms = 0;
 }
@@ -1085,7 +1314,9 @@ char Grid_relax( Grid* grid, Vector where, float max_overlap )
 
                 Grid_site_remove_atom( grid, atom->chain_nr, atom->atom_nr );
                 Grid_site_add_atom( grid, atom->chain_nr, atom->atom_nr, vec );
+                if ( grid->nr_snapshots > 0 ) Grid_journal_atom( grid, atom->chain_nr, nr );
                 chain->atoms[nr - chain->offset] = vec;
+                Grid_chain_mark( grid, atom->chain_nr, nr );
             }
         } /* next atom */
 
@@ -1403,6 +1634,44 @@ int Grid_any_empty_site( Grid* grid )
 }
 
 
+/* ----------------------------------------------------------------------------------------- */
+void Grid_rebuild_empty_sites( Grid* grid )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* relinks the empty sites in site order, so that the list no longer
+       depends on the history of atom insertions and removals */
+
+    int site_nr, prev;
+
+    prev = NIL;
+    grid->first_empty = NIL;
+    for ( site_nr = 0; site_nr < grid->nr_sites; site_nr++ )
+    {
+        if ( grid->sites[site_nr].nr_atoms > 0 ) continue;
+        if ( prev == NIL )
+            grid->first_empty = site_nr;
+        else
+            grid->sites[prev].empty.next = site_nr;
+        grid->sites[site_nr].empty.prev = prev;
+        prev = site_nr;
+    }
+    if ( prev != NIL )
+        grid->sites[prev].empty.next = NIL;
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+int Grid_next_free_chain( Grid* grid )
+/* ----------------------------------------------------------------------------------------- */
+{
+    int chain_nr;
+
+    for ( chain_nr = grid->max_chains - 1; chain_nr >= 0; chain_nr-- )
+        if ( grid->chains[chain_nr].last > grid->chains[chain_nr].first ) break;
+    return chain_nr + 1;
+}
+
+
 /* ----------------------------------------------------------------------------------------- */
 void Grid_queue_clear( Grid* grid )
 /* ----------------------------------------------------------------------------------------- */
@@ -1729,122 +1998,335 @@ char Grid_site_splits_alldirs( Grid* grid, int site_nr, char soft )
 
 
 /* ----------------------------------------------------------------------------------------- */
-void Grid_copy( Grid* source, Grid* dest, char first )
+Journal_Entry* Grid_journal_entry( Grid* grid, int kind, int nr )
 /* ----------------------------------------------------------------------------------------- */
 {
-    int i, j;
+    Journal_Entry* entry;
 
-    dest->Lx = source->Lx;
-    dest->Ly = source->Ly;
-    dest->Lz = source->Lz;
-    dest->site_width = source->site_width;
-    dest->params = source->params;
-    if ( first )
-        dest->sites = ( Site* )malloc( source->nr_sites * sizeof( Site ) );
-    else
+    if ( grid->nr_journal >= grid->max_journal )
     {
-        if ( dest->nr_sites != source->nr_sites )
-            dest->sites = ( Site* )realloc( dest->sites, source->nr_sites * sizeof( Site ) );
+        grid->max_journal += JOURNAL_INCREMENT;
+        grid->journal = ( Journal_Entry* )realloc( grid->journal, grid->max_journal * sizeof( Journal_Entry ) );
     }
-    dest->nr_sites = source->nr_sites;
-    for ( i = 0; i < dest->nr_sites; i++ )
-        dest->sites[i] = source->sites[i];
-    dest->first_empty = source->first_empty;
+    entry = &grid->journal[grid->nr_journal++];
+    entry->kind = kind;
+    entry->nr = nr;
+    return entry;
+}
+
 
-    if ( first )
-        dest->chains = ( Chain* )malloc( source->max_chains * sizeof( Chain ) );
+/* ----------------------------------------------------------------------------------------- */
+void Grid_journal_site( Grid* grid, int site_nr )
+/* ----------------------------------------------------------------------------------------- */
+{
+    Journal_Entry* entry;
+    Site* site;
+    int i;
+
+    site = &grid->sites[site_nr];
+    entry = Grid_journal_entry( grid, JOURNAL_SITE, site_nr );
+    entry->old.site.nr_atoms = site->nr_atoms;
+    for ( i = 0; i < site->nr_atoms; i++ )
+        entry->old.site.atoms[i] = site->atoms[i];
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+void Grid_journal_empty( Grid* grid, int site_nr )
+/* ----------------------------------------------------------------------------------------- */
+{
+    if ( site_nr == NIL )
+        Grid_journal_entry( grid, JOURNAL_FIRST_EMPTY, NIL )->old.value = grid->first_empty;
     else
+        Grid_journal_entry( grid, JOURNAL_EMPTY, site_nr )->old.empty = grid->sites[site_nr].empty;
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+void Grid_journal_chain( Grid* grid, int chain_nr )
+/* ----------------------------------------------------------------------------------------- */
+{
+    Journal_Entry* entry;
+    Chain* chain;
+
+    chain = &grid->chains[chain_nr];
+    entry = Grid_journal_entry( grid, JOURNAL_CHAIN, chain_nr );
+    entry->old.chain.first = chain->first;
+    entry->old.chain.last = chain->last;
+    entry->old.chain.offset = chain->offset;
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+void Grid_journal_atom( Grid* grid, int chain_nr, int atom_nr )
+/* ----------------------------------------------------------------------------------------- */
+{
+    Journal_Entry* entry;
+    Chain* chain;
+
+    chain = &grid->chains[chain_nr];
+    entry = Grid_journal_entry( grid, JOURNAL_ATOM, chain_nr );
+    entry->atom_nr = atom_nr;
+    entry->old.vec = chain->atoms[atom_nr - chain->offset];
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+void Grid_journal_append( Grid* grid, int chain_nr, int atom_nr )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* the slot of an appended atom holds nothing worth restoring, the chain
+       entry before it takes the atom off again; only the index is kept to
+       mark the atom changed */
+
+    Grid_journal_entry( grid, JOURNAL_APPEND, chain_nr )->atom_nr = atom_nr;
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+int Grid_snapshot( Grid* grid )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* from here on every change of sites, empty list and chains is journaled,
+       the returned mark can be rolled back in O(changes); snapshots nest */
+
+    grid->nr_snapshots++;
+    return grid->nr_journal;
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+void Grid_release( Grid* grid )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* keeps the changes made since the innermost snapshot; an enclosing
+       snapshot can still roll them back */
+
+    if ( grid->nr_snapshots <= 0 ) return;
+    grid->nr_snapshots--;
+    if ( grid->nr_snapshots == 0 ) grid->nr_journal = 0;
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+void Grid_rollback( Grid* grid, int snapshot )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* undoes the journal back to the snapshot and releases it */
+
+    int i, j;
+    Journal_Entry* entry;
+    Site* site;
+    Chain* chain;
+
+    while ( grid->nr_journal > snapshot )
+    {
+        entry = &grid->journal[--grid->nr_journal];
+        switch ( entry->kind )
+        {
+            case JOURNAL_SITE:
+                site = &grid->sites[entry->nr];
+                site->nr_atoms = entry->old.site.nr_atoms;
+                for ( i = 0; i < site->nr_atoms; i++ )
+                    site->atoms[i] = entry->old.site.atoms[i];
+                Grid_overlap_mark( grid, entry->nr );
+                break;
+
+            case JOURNAL_EMPTY:
+                grid->sites[entry->nr].empty = entry->old.empty;
+                break;
+
+            case JOURNAL_FIRST_EMPTY:
+                grid->first_empty = entry->old.value;
+                break;
+
+            case JOURNAL_OCCUPANCY:
+                grid->sites[entry->nr].nr_occ_neighbours -= entry->old.value;
+                break;
+
+            case JOURNAL_CHAIN:
+                chain = &grid->chains[entry->nr];
+                chain->first = entry->old.chain.first;
+                chain->last = entry->old.chain.last;
+                chain->offset = entry->old.chain.offset;
+                break;
+
+            case JOURNAL_ATOM:
+                chain = &grid->chains[entry->nr];
+                chain->atoms[entry->atom_nr - chain->offset] = entry->old.vec;
+                Grid_chain_mark( grid, entry->nr, entry->atom_nr );
+                break;
+
+            case JOURNAL_APPEND:
+                Grid_chain_mark( grid, entry->nr, entry->atom_nr );
+                break;
+
+            case JOURNAL_SHIFT:
+                /* inverse of the head reallocation in Grid_chain_append_atom() */
+                chain = &grid->chains[entry->nr];
+                for ( j = 0; j < chain->max_atoms - MAX_ATOMS_INCREMENT; j++ )
+                    chain->atoms[j] = chain->atoms[j + MAX_ATOMS_INCREMENT];
+                chain->offset += MAX_ATOMS_INCREMENT;
+                break;
+        }
+    }
+    Grid_release( grid );
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+char Grid_write( Grid* grid, FILE* f )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* binary image of everything the packing depends on, including the order
+       of the atoms within a site and the order of the empty site list */
+
+    int nr, chain_nr, site_nr;
+    Chain* chain;
+    Site* site;
+
+    fwrite( &grid->params, sizeof( Parameters ), 1, f );
+
+    fwrite( &grid->max_chains, sizeof( int ), 1, f );
+    for ( chain_nr = 0; chain_nr < grid->max_chains; chain_nr++ )
     {
-        if ( dest->max_chains != source->max_chains )
-            dest->chains = ( Chain* )realloc( dest->chains, source->max_chains * sizeof( Chain ) );
+        chain = &grid->chains[chain_nr];
+        fwrite( &chain->first, sizeof( int ), 1, f );
+        fwrite( &chain->last, sizeof( int ), 1, f );
+        fwrite( &chain->offset, sizeof( int ), 1, f );
+        fwrite( &chain->max_atoms, sizeof( int ), 1, f );
+        nr = chain->last - chain->first;
+        if ( nr > 0 )
+            fwrite( &chain->atoms[chain->first - chain->offset], sizeof( Vector ), nr, f );
     }
-    dest->max_chains = source->max_chains;
-    for ( i = 0; i < dest->max_chains; i++ )
+
+    /* only sites that are occupied or have occupied neighbours */
+    nr = 0;
+    for ( site_nr = 0; site_nr < grid->nr_sites; site_nr++ )
     {
-        dest->chains[i].first     = source->chains[i].first;
-        dest->chains[i].last      = source->chains[i].last;
-        dest->chains[i].offset    = source->chains[i].offset;
-        if ( first )
-            dest->chains[i].atoms = ( Vector* )malloc( source->chains[i].max_atoms * sizeof( Vector ) );
-        else
+        site = &grid->sites[site_nr];
+        if ( ( site->nr_atoms > 0 ) || ( site->nr_occ_neighbours != 0 ) ) nr++;
+    }
+    fwrite( &nr, sizeof( int ), 1, f );
+    for ( site_nr = 0; site_nr < grid->nr_sites; site_nr++ )
+    {
+        site = &grid->sites[site_nr];
+        if ( ( site->nr_atoms > 0 ) || ( site->nr_occ_neighbours != 0 ) )
         {
-            if ( dest->chains[i].max_atoms != source->chains[i].max_atoms )
-                dest->chains[i].atoms = ( Vector* )realloc( dest->chains[i].atoms, source->chains[i].max_atoms * sizeof( Vector ) );
+            fwrite( &site_nr, sizeof( int ), 1, f );
+            fwrite( &site->nr_occ_neighbours, sizeof( int ), 1, f );
+            fwrite( &site->nr_atoms, sizeof( int ), 1, f );
+            fwrite( site->atoms, sizeof( Atom_Ref ), site->nr_atoms, f );
         }
-        dest->chains[i].max_atoms = source->chains[i].max_atoms;
-        for ( j = 0; j < dest->chains[i].max_atoms; j++ )
-            dest->chains[i].atoms[j] = source->chains[i].atoms[j];
     }
-    dest->queue_first = source->queue_first;
-    dest->queue_last = source->queue_last;
-    if ( first )
-        dest->queue = ( int* ) malloc( source->nr_sites * sizeof( int ) );
-    for ( i = 0; i < dest->nr_sites; i++ )
-        dest->queue[i] = source->queue[i];
 
-    dest->nr_marked = source->nr_marked;
-    if ( first )
-        dest->marked_list = ( int* ) malloc( source->nr_sites * sizeof( int ) );
-    for ( i = 0; i < dest->nr_sites; i++ )
-        dest->marked_list[i] = source->marked_list[i];
+    nr = 0;
+    for ( site_nr = grid->first_empty; site_nr != NIL; site_nr = grid->sites[site_nr].empty.next )
+        nr++;
+    fwrite( &nr, sizeof( int ), 1, f );
+    for ( site_nr = grid->first_empty; site_nr != NIL; site_nr = grid->sites[site_nr].empty.next )
+        fwrite( &site_nr, sizeof( int ), 1, f );
+
+    return !ferror( f );
 }
 
 
 /* ----------------------------------------------------------------------------------------- */
-char Grid_compare( Grid* source, Grid* dest )
+static long Grid_bytes_left( FILE* f )
 /* ----------------------------------------------------------------------------------------- */
 {
-    int i, j, nr, os, od, fs, fd;
+    /* bytes between the file position and the end of the file, -1 if unknown */
 
-    if ( dest->Lx != source->Lx ) return false;
-    if ( dest->Ly != source->Ly ) return false;
-    if ( dest->Lz != source->Lz ) return false;
-    if ( dest->site_width.x != source->site_width.x ) return false;
-    if ( dest->site_width.y != source->site_width.y ) return false;
-    if ( dest->site_width.z != source->site_width.z ) return false;
+    long here, end;
+
+    here = ftell( f );
+    if ( here < 0 || fseek( f, 0, SEEK_END ) != 0 ) return -1;
+    end = ftell( f );
+    if ( end < 0 || fseek( f, here, SEEK_SET ) != 0 ) return -1;
+    return end - here;
+}
 
-    if ( dest->params.bond_len != source->params.bond_len ) return false;
-    if ( dest->params.bond_angle != source->params.bond_angle ) return false;
-    if ( dest->params.atom_radius != source->params.atom_radius ) return false;
-    if ( dest->params.box_size.x == source->params.box_size.x ) return false;
-    if ( dest->params.box_size.y == source->params.box_size.y ) return false;
-    if ( dest->params.box_size.z == source->params.box_size.z ) return false;
 
-    if ( dest->nr_sites != source->nr_sites ) return false;
-    for ( i = 0; i < dest->nr_sites; i++ )
+/* ----------------------------------------------------------------------------------------- */
+char Grid_read( Grid* grid, FILE* f )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* counterpart of Grid_write(), re-initializes an initialized grid;
+       on failure the grid stays allocated but its contents are undefined */
+
+    int i, nr, nr_sites, max_chains, max_atoms, chain_nr, site_nr, prev;
+    long left;
+    Parameters params;
+    Chain* chain;
+    Site* site;
+
+    if ( fread( &params, sizeof( Parameters ), 1, f ) != 1 ) return false;
+    Grid_free( grid );
+    Grid_init( grid, &params );
+
+    /* counts are refused before allocating when the rest of the file can not hold
+       them, every chain takes at least four ints */
+    if ( fread( &max_chains, sizeof( int ), 1, f ) != 1 ) return false;
+    left = Grid_bytes_left( f );
+    if ( ( left < 0 ) || ( max_chains < 0 ) || ( ( unsigned long ) max_chains > ( unsigned long ) left / ( 4 * sizeof( int ) ) ) ) return false;
+    if ( max_chains > 0 ) Grid_new_chain( grid, max_chains - 1 );
+    for ( chain_nr = 0; chain_nr < max_chains; chain_nr++ )
     {
-        if ( dest->sites[i].nr_atoms != source->sites[i].nr_atoms ) return false;
-        if ( dest->sites[i].nr_occ_neighbours != source->sites[i].nr_occ_neighbours ) return false;
-        if ( dest->sites[i].marked != source->sites[i].marked ) return false;
-        for ( j = 0; j < dest->sites[i].nr_atoms; j++ )
+        chain = &grid->chains[chain_nr];
+        if ( fread( &chain->first, sizeof( int ), 1, f ) != 1 ) return false;
+        if ( fread( &chain->last, sizeof( int ), 1, f ) != 1 ) return false;
+        if ( fread( &chain->offset, sizeof( int ), 1, f ) != 1 ) return false;
+        if ( fread( &max_atoms, sizeof( int ), 1, f ) != 1 ) return false;
+        nr = chain->last - chain->first;
+        if ( ( nr < 0 ) || ( chain->first - chain->offset < 0 ) ||
+             ( chain->last - chain->offset > max_atoms ) ) return false;
+
+        /* only the atoms are in the file, a capacity beyond what the rest of
+           the file could hold plus two increments of growth is corrupt */
+        left = Grid_bytes_left( f );
+        if ( ( left < 0 ) || ( ( unsigned long ) max_atoms > ( unsigned long ) left / sizeof( Vector ) + 2 * MAX_ATOMS_INCREMENT ) ) return false;
+        if ( max_atoms > 0 )
         {
-            if ( dest->sites[i].atoms[j].chain_nr != source->sites[i].atoms[j].chain_nr ) return false;
-            if ( dest->sites[i].atoms[j].atom_nr != source->sites[i].atoms[j].atom_nr ) return false;
-            if ( dest->sites[i].atoms[j].vec.x != source->sites[i].atoms[j].vec.x ) return false;
-            if ( dest->sites[i].atoms[j].vec.y != source->sites[i].atoms[j].vec.y ) return false;
-            if ( dest->sites[i].atoms[j].vec.z != source->sites[i].atoms[j].vec.z ) return false;
+            /* max_atoms only set once allocated, Grid_free() relies on it */
+            chain->atoms = ( Vector* )malloc( ( size_t ) max_atoms * sizeof( Vector ) );
+            if ( chain->atoms == NULL ) return false;
+            chain->max_atoms = max_atoms;
         }
+        if ( nr > 0 )
+            if ( fread( &chain->atoms[chain->first - chain->offset], sizeof( Vector ), nr, f ) != ( size_t ) nr ) return false;
     }
-    /* if (dest->first_empty != source->first_empty) return false; */
 
-    if ( dest->max_chains != source->max_chains ) return false;
-    for ( i = 0; i < dest->max_chains; i++ )
+    if ( fread( &nr_sites, sizeof( int ), 1, f ) != 1 ) return false;
+    for ( i = 0; i < nr_sites; i++ )
     {
-        if ( dest->chains[i].first  != source->chains[i].first ) return false;
-        if ( dest->chains[i].last   != source->chains[i].last ) return false;
-
-        od = dest->chains[i].offset;
-        os = source->chains[i].offset;
-        fd = dest->chains[i].first;
-        fs = source->chains[i].first;
-        nr = dest->chains[i].last - fd;
-        for ( j = 0; j < nr; j++ )
-        {
-            if ( dest->chains[i].atoms[fd + j - od].x != source->chains[i].atoms[fs + j - os].x ) return false;
-            if ( dest->chains[i].atoms[fd + j - od].y != source->chains[i].atoms[fs + j - os].y ) return false;
-            if ( dest->chains[i].atoms[fd + j - od].z != source->chains[i].atoms[fs + j - os].z ) return false;
-        }
+        if ( fread( &site_nr, sizeof( int ), 1, f ) != 1 ) return false;
+        if ( ( site_nr < 0 ) || ( site_nr >= grid->nr_sites ) ) return false;
+        site = &grid->sites[site_nr];
+        if ( fread( &site->nr_occ_neighbours, sizeof( int ), 1, f ) != 1 ) return false;
+        if ( fread( &site->nr_atoms, sizeof( int ), 1, f ) != 1 ) return false;
+        if ( ( site->nr_atoms < 0 ) || ( site->nr_atoms > MAX_ATOMS_SITE ) ) return false;
+        if ( fread( site->atoms, sizeof( Atom_Ref ), site->nr_atoms, f ) != ( size_t ) site->nr_atoms ) return false;
     }
+
+    if ( fread( &nr, sizeof( int ), 1, f ) != 1 ) return false;
+    prev = NIL;
+    grid->first_empty = NIL;
+    for ( i = 0; i < nr; i++ )
+    {
+        if ( fread( &site_nr, sizeof( int ), 1, f ) != 1 ) return false;
+        if ( ( site_nr < 0 ) || ( site_nr >= grid->nr_sites ) ) return false;
+        if ( prev == NIL )
+            grid->first_empty = site_nr;
+        else
+            grid->sites[prev].empty.next = site_nr;
+        grid->sites[site_nr].empty.prev = prev;
+        prev = site_nr;
+    }
+    if ( prev != NIL )
+        grid->sites[prev].empty.next = NIL;
+
+    Grid_max_overlap_exact( grid );
+
     return true;
 }
 
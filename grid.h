@@ -14,6 +14,7 @@
 #ifndef GRID_H
 #define GRID_H
 
+#include <stdio.h>
 #include "vector.h"
 
 #define NO_CHAIN -1
@@ -84,6 +85,7 @@ typedef struct
     int offset;       /* nr of atoms[0] */
     int max_atoms;    /* length of atoms[] */
     Vector* atoms;
+    int dirty;        /* lowest atom nr changed since Grid_chain_clean(), NO_ATOM if none */
 } Chain;
 
 
@@ -122,6 +124,39 @@ typedef struct
 } Site;
 
 
+/* kinds of journaled grid changes, see Grid_snapshot() */
+#define JOURNAL_SITE        0   /* atoms of a site */
+#define JOURNAL_EMPTY       1   /* empty list links of a site */
+#define JOURNAL_FIRST_EMPTY 2
+#define JOURNAL_OCCUPANCY   3   /* change of nr_occ_neighbours */
+#define JOURNAL_CHAIN       4   /* first, last and offset of a chain */
+#define JOURNAL_ATOM        5   /* position of a chain atom */
+#define JOURNAL_SHIFT       6   /* atoms moved by a head reallocation */
+#define JOURNAL_APPEND      7   /* index of an appended chain atom, no position */
+
+typedef struct
+{
+    int kind;
+    int nr;           /* site or chain number */
+    int atom_nr;
+    union
+    {
+        int    value;
+        List   empty;
+        Vector vec;
+        struct
+        {
+            int first, last, offset;
+        } chain;
+        struct
+        {
+            int nr_atoms;
+            Atom_Ref atoms[MAX_ATOMS_SITE];
+        } site;
+    } old;
+} Journal_Entry;
+
+
 typedef struct
 {
     int Lx, Ly, Lz;
@@ -146,6 +181,18 @@ typedef struct
     Relaxed_Atom* relaxed_atoms;
     int max_relaxed_atoms;
     int nr_relaxed_atoms;
+
+    float* site_overlap;  /* max atom-atom overlap of the atoms in each site */
+    char*  overlap_dirty; /* site changed since the last overlap update */
+    int*   dirty_list;
+    int    nr_dirty;
+    float* overlap_tree;  /* max segment tree over site_overlap, root at [1] */
+    int    tree_size;     /* nr of leaves, power of 2 >= nr_sites */
+
+    Journal_Entry* journal;  /* undo log while a snapshot is held */
+    int    nr_journal;
+    int    max_journal;
+    int    nr_snapshots;
 } Grid;
 
 
@@ -167,6 +214,8 @@ Vector   Grid_vec_step( Grid* grid, Vector vec, int dir );
 
 char     Grid_site_is_empty( Grid* gird, int site_nr, char soft );
 int      Grid_any_empty_site( Grid* gird );
+void     Grid_rebuild_empty_sites( Grid* grid );
+int      Grid_next_free_chain( Grid* grid );
 char     Grid_available_sites( Grid* gird, int site_nr, int nr_sites, char soft );
 void     Grid_sites_per_dir( Grid* gird, int site_nr, int max_sites, char soft, int* nr_sites );
 int      Grid_min_sites_per_dir( Grid* grid, int site_nr, int max_sites, char soft );
@@ -176,6 +225,11 @@ char     Grid_site_splits( Grid* gird, int site_nr, char soft );
 float    Grid_overlap_atom( Grid* grid, Vector vec, int chain_nr, int atom_nr,
                             int* overlap_chain, int* overlap_atom );
 float    Grid_overlap( Grid* grid, Vector vec, int chain_nr, int atom_nr );
+float    Grid_overlap_atoms( Grid* grid, Vector vec, int chain_nr, int atom_nr,
+                             int* overlap_chain, int* overlap_atom );
+
+void     Grid_overlap_update( Grid* grid );
+float    Grid_max_overlap_exact( Grid* grid );
 
 char     Grid_reduce_overlap( Grid* grid, Vector* vec, int chain_nr, int atom_nr );
 char     Grid_reduce_overlap_bonded( Grid* grid, Vector last_vec,
@@ -204,10 +258,14 @@ char     Grid_chain_remove_head( Grid* grid, int chain_nr );
 char     Grid_chain_remove_tail( Grid* grid, int chain_nr );
 
 char     Grid_chain_remove( Grid* grid, int chain_nr );
+void     Grid_chain_clean( Grid* grid, int chain_nr );
 
 
-void     Grid_copy( Grid* source, Grid* dest, char first );
-char     Grid_compare( Grid* source, Grid* dest );
+int      Grid_snapshot( Grid* grid );
+void     Grid_release( Grid* grid );
+void     Grid_rollback( Grid* grid, int snapshot );
+char     Grid_write( Grid* grid, FILE* f );
+char     Grid_read( Grid* grid, FILE* f );
 
 
 #endif
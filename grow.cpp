@@ -19,6 +19,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "grow.h"
 #include "interface.h"
@@ -42,6 +43,30 @@ static char  buffer[BUFFER_LENGTH];
 
 static Grow_Parameters g_grow_params;
 
+#define CHECKPOINT_MAGIC 0x50434b50
+#define CHECKPOINT_FORMAT_NR 3
+#define MAX_RANDOM_STATE_LEN 65536
+
+typedef struct
+{
+    int  packing_nr;
+    int  chain_base;
+    int  chain_nr;
+    int  particles;
+    int  num_monomers;
+    char sparse;
+} Pack_State;
+
+static char   checkpoint_file[FILENAME_MAX] = "";
+static int    checkpoint_chains = 0;
+static int    checkpoint_seconds = 0;
+static int    last_checkpoint_chain = 0;
+static time_t last_checkpoint_time = 0;
+
+static int    chain_base = 0;     /* grid chain number of the first chain list entry */
+
+char Save_Checkpoint( char filename[], Grid* grid, Pack_State* state );
+
 typedef struct
 {
     int   angle_nr;
@@ -405,7 +430,7 @@ int Place_chain( Grid* grid, int chain_nr, int chain_len, char sparse )
 
 int Get_chain_len( int chain_nr )
 {
-    return chainList().chainLength( chain_nr );
+    return chainList().chainLength( chain_nr - chain_base );
 }
 
 
@@ -413,29 +438,39 @@ int Get_chain_len( int chain_nr )
 
 
 /* ----------------------------------------------------------------------------------------- */
-void Random_pack( Grid* grid )
+char Checkpoint_due( Pack_State* state )
 /* ----------------------------------------------------------------------------------------- */
 {
-    int chain_nr, chain_len, len, i;
-    int nr_chains, nr_tries, particles;
-    char OK, sparse;
-    Vector first_vec;
+    if ( checkpoint_file[0] == '\0' ) return false;
+    if ( ( checkpoint_chains > 0 ) &&
+         ( state->chain_nr - last_checkpoint_chain >= checkpoint_chains ) ) return true;
+    if ( ( checkpoint_seconds > 0 ) &&
+         ( difftime( time( NULL ), last_checkpoint_time ) >= checkpoint_seconds ) ) return true;
+    return false;
+}
 
-    chain_nr = 0;
-    particles = 0;
-    sparse = true;
 
-    int num_monomers = 0;
+/* ----------------------------------------------------------------------------------------- */
+void Random_pack( Grid* grid, Pack_State* state )
+/* ----------------------------------------------------------------------------------------- */
+{
+    int chain_len, len;
+    int nr_tries, snapshot;
+
     while ( true )
     {
-        appWindow()->updateStatus( chain_nr, particles );
+        /* chain boundary: nothing of the next chain has been drawn yet */
+        if ( Checkpoint_due( state ) )
+            Save_Checkpoint( checkpoint_file, grid, state );
+
+        appWindow()->updateStatus( state->chain_nr, state->particles );
 #ifdef VERBOSE
         sprintf( buffer, "   chain %3i, %i of %i particles\n",
-                 chain_nr, particles, g_grow_params.nr_particles );
+                 state->chain_nr, state->particles, g_grow_params.nr_particles );
         appWindow()->appendText( buffer );
 #endif
         /* XWinRefresh(); */
-        chain_len = Get_chain_len( chain_nr );
+        chain_len = Get_chain_len( state->chain_nr );
 
         if ( chain_len < 1 )
         {
@@ -446,13 +481,17 @@ void Random_pack( Grid* grid )
         while ( ( g_grow_params.nr_chain_trials == 0 ) ||
                 ( nr_tries < g_grow_params.nr_chain_trials ) )
         {
-            len = Place_chain( grid, chain_nr, chain_len, sparse );
+            /* a failed attempt is rolled back completely, including the
+               atoms of other chains moved while relaxing */
+            snapshot = Grid_snapshot( grid );
+            len = Place_chain( grid, state->chain_nr, chain_len, state->sparse );
             if ( len >= chain_len )
             {
-                num_monomers += len;
+                Grid_release( grid );
+                state->num_monomers += len;
                 break;
             }
-            Grid_chain_remove( grid, chain_nr );
+            Grid_rollback( grid, snapshot );
             len = 0;
 
             if ( getInterfaceState() == STATE_ABORT )
@@ -464,13 +503,13 @@ void Random_pack( Grid* grid )
             sprintf( buffer, "chain removed\n" );
             appWindow()->appendText( buffer );
 
-            if ( sparse )
+            if ( state->sparse )
             {
                 sprintf( buffer, "sparse becomes false\n" );
                 appWindow()->appendText( buffer );
             }
 #endif
-            sparse = false;
+            state->sparse = false;
             nr_tries++;
         }
         if ( len > 0 )
@@ -479,48 +518,47 @@ void Random_pack( Grid* grid )
             hist_atoms[len] += len;
         }
         if ( len < chain_len ) break;
-        chain_nr++;
-        particles += chain_len;
-        if ( particles >= g_grow_params.nr_particles ) break;
+        state->chain_nr++;
+        state->particles += chain_len;
+        if ( state->particles >= g_grow_params.nr_particles ) break;
     }
-    if ( particles < g_grow_params.nr_particles )
+    if ( state->particles < g_grow_params.nr_particles )
     {
         sprintf( buffer, "failed\n" );
         appWindow()->appendText( buffer );
     }
 
-    qDebug() << "monomer count in grow: " << num_monomers;
+    qDebug() << "monomer count in grow: " << state->num_monomers;
 }
 
 
 /* ----------------------------------------------------------------------------------------- */
-void Pack( Grid* grid, Grow_Parameters* grow_params )
+void Pack_packings( Grid* grid, Pack_State* state, char resumed )
 /* ----------------------------------------------------------------------------------------- */
 {
-    int i, j, len, total;
-
-    hist_atoms = ( int* ) malloc( ( grid->nr_sites + 1 ) * sizeof( int ) );
-    hist_chains = ( int* ) malloc( ( grid->nr_sites + 1 ) * sizeof( int ) );
+    int i, total;
 
-    g_grow_params = *grow_params;
-    if ( g_grow_params.nr_angles >= MAX_ANGLES )
-        g_grow_params.nr_angles = MAX_ANGLES - 1;
-
-    for ( i = 0; i <= grid->nr_sites; i++ )
-    {
-        hist_atoms[i] = 0;
-        hist_chains[i] = 0;
-    }
+    last_checkpoint_chain = state->chain_nr;
+    last_checkpoint_time = time( NULL );
 
     start_clock();
-    for ( i = 0; i < g_grow_params.nr_packings; i++ )
+    for ( ; state->packing_nr < g_grow_params.nr_packings; state->packing_nr++ )
     {
 #ifdef VERBOSE
-        sprintf( buffer, "===== packing %i =======\n", i );
+        sprintf( buffer, "===== packing %i =======\n", state->packing_nr );
         appWindow()->appendText( buffer );
 #endif
-        Grid_clear( grid );
-        Random_pack( grid );
+        if ( !resumed )
+        {
+            Grid_clear( grid );
+            state->chain_nr = state->chain_base;
+            state->particles = 0;
+            state->num_monomers = 0;
+            state->sparse = true;
+            last_checkpoint_chain = state->chain_base;
+        }
+        resumed = false;
+        Random_pack( grid, state );
         if ( getInterfaceState() == STATE_ABORT )
         {
             setInterfaceState( STATE_NOT_STARTED );
@@ -554,8 +592,290 @@ void Pack( Grid* grid, Grow_Parameters* grow_params )
 #endif
     free( ( void* )hist_atoms );
     free( ( void* )hist_chains );
+    hist_atoms = NULL;
+    hist_chains = NULL;
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+void Pack( Grid* grid, Grow_Parameters* grow_params )
+/* ----------------------------------------------------------------------------------------- */
+{
+    int i;
+    Pack_State state;
+
+    hist_atoms = ( int* ) malloc( ( grid->nr_sites + 1 ) * sizeof( int ) );
+    hist_chains = ( int* ) malloc( ( grid->nr_sites + 1 ) * sizeof( int ) );
+
+    g_grow_params = *grow_params;
+    if ( g_grow_params.nr_angles >= MAX_ANGLES )
+        g_grow_params.nr_angles = MAX_ANGLES - 1;
+
+    for ( i = 0; i <= grid->nr_sites; i++ )
+    {
+        hist_atoms[i] = 0;
+        hist_chains[i] = 0;
+    }
+
+    state.packing_nr = 0;
+    state.chain_base = 0;
+    chain_base = 0;
+    Pack_packings( grid, &state, false );
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+int Pack_append( Grid* grid, Grow_Parameters* grow_params )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* grows the chain list into an already populated grid, e.g. one restored
+       by Load_System(); returns the grid chain number of the first new chain */
+
+    int i;
+    Pack_State state;
+
+    hist_atoms = ( int* ) malloc( ( grid->nr_sites + 1 ) * sizeof( int ) );
+    hist_chains = ( int* ) malloc( ( grid->nr_sites + 1 ) * sizeof( int ) );
+
+    g_grow_params = *grow_params;
+    if ( g_grow_params.nr_angles >= MAX_ANGLES )
+        g_grow_params.nr_angles = MAX_ANGLES - 1;
+    g_grow_params.nr_packings = 1;
+
+    for ( i = 0; i <= grid->nr_sites; i++ )
+    {
+        hist_atoms[i] = 0;
+        hist_chains[i] = 0;
+    }
+
+    Grid_rebuild_empty_sites( grid );
+
+    state.packing_nr = 0;
+    state.chain_base = Grid_next_free_chain( grid );
+    state.chain_nr = state.chain_base;
+    state.particles = 0;
+    state.num_monomers = 0;
+    state.sparse = true;
+    chain_base = state.chain_base;
+
+    Pack_packings( grid, &state, true );
+    return state.chain_base;
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+void Pack_set_checkpoint( const char* filename, int nr_chains, int nr_seconds )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* empty filename switches checkpointing off */
+    strncpy( checkpoint_file, filename, FILENAME_MAX - 1 );
+    checkpoint_file[FILENAME_MAX - 1] = '\0';
+    checkpoint_chains = nr_chains;
+    checkpoint_seconds = nr_seconds;
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+char Save_Checkpoint( char filename[], Grid* grid, Pack_State* state )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* native binary snapshot of a running Pack(), written to a temporary file
+       first so that a crash while writing keeps the previous checkpoint */
+
+    FILE* f;
+    int i, nr;
+    QByteArray random_state;
+    char tmp_name[FILENAME_MAX + 4];
+    char OK;
+
+    snprintf( tmp_name, sizeof( tmp_name ), "%s.tmp", filename );
+    f = fopen( tmp_name, "wb" );
+    if ( f == NULL )
+    {
+        sprintf( buffer, "can not write checkpoint\n" );
+        appWindow()->appendText( buffer );
+        return false;
+    }
+
+    nr = CHECKPOINT_MAGIC;
+    fwrite( &nr, sizeof( int ), 1, f );
+    nr = CHECKPOINT_FORMAT_NR;
+    fwrite( &nr, sizeof( int ), 1, f );
+
+    fwrite( &g_grow_params, sizeof( Grow_Parameters ), 1, f );
+    fwrite( state, sizeof( Pack_State ), 1, f );
+
+    random_state = randomState();
+    nr = random_state.size();
+    fwrite( &nr, sizeof( int ), 1, f );
+    fwrite( random_state.constData(), sizeof( char ), nr, f );
+
+    const QVector<int>& lengths = chainList().chainLengths();
+    const QVector<int>& additive_counts = chainList().additiveChainCounts();
+    nr = lengths.count();
+    fwrite( &nr, sizeof( int ), 1, f );
+    fwrite( lengths.constData(), sizeof( int ), nr, f );
+    nr = additive_counts.count();
+    fwrite( &nr, sizeof( int ), 1, f );
+    fwrite( additive_counts.constData(), sizeof( int ), nr, f );
+    OK = chainList().additivesPrepended();
+    fwrite( &OK, sizeof( char ), 1, f );
+
+    OK = Grid_write( grid, f );
+
+    /* histograms, nonzero entries only, after the grid that sizes them */
+    nr = 0;
+    for ( i = 0; i <= grid->nr_sites; i++ )
+        if ( hist_chains[i] > 0 ) nr++;
+    fwrite( &nr, sizeof( int ), 1, f );
+    for ( i = 0; i <= grid->nr_sites; i++ )
+    {
+        if ( hist_chains[i] > 0 )
+        {
+            fwrite( &i, sizeof( int ), 1, f );
+            fwrite( &hist_chains[i], sizeof( int ), 1, f );
+            fwrite( &hist_atoms[i], sizeof( int ), 1, f );
+        }
+    }
+
+    if ( ferror( f ) ) OK = false;
+    if ( fclose( f ) != 0 ) OK = false;
+
+    if ( OK )
+    {
+        remove( filename );
+        OK = ( rename( tmp_name, filename ) == 0 );
+    }
+    if ( !OK )
+    {
+        sprintf( buffer, "writing checkpoint failed\n" );
+        appWindow()->appendText( buffer );
+    }
+
+    last_checkpoint_chain = state->chain_nr;
+    last_checkpoint_time = time( NULL );
+    return OK;
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+static char Read_ints( FILE* f, QVector<int>& values )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* a count and that many ints; a count the rest of the file can not hold is refused
+       before anything is allocated for it */
+    int nr;
+    long here, end;
+
+    if ( fread( &nr, sizeof( int ), 1, f ) != 1 || nr < 0 ) return false;
+
+    here = ftell( f );
+    if ( here < 0 || fseek( f, 0, SEEK_END ) != 0 ) return false;
+    end = ftell( f );
+    if ( end < 0 || fseek( f, here, SEEK_SET ) != 0 ) return false;
+    if ( ( unsigned long ) nr > ( unsigned long )( end - here ) / sizeof( int ) ) return false;
+
+    values.resize( nr );
+    return ( fread( values.data(), sizeof( int ), nr, f ) == ( size_t ) nr );
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+char Load_Checkpoint( char filename[], Grid* grid, Pack_State* state )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* everything is read into locals first, the globals and *state change only
+       once the whole file has parsed */
+    FILE* f;
+    int i, nr, nr_sites;
+    Grow_Parameters params;
+    Pack_State loaded;
+    QByteArray random_state;
+    char prepended;
+    QVector<int> lengths;
+    QVector<int> additive_counts;
+    QVector<int> hist;
+
+    f = fopen( filename, "rb" );
+    if ( f == NULL ) return false;
+
+    char OK = ( fread( &nr, sizeof( int ), 1, f ) == 1 ) && ( nr == CHECKPOINT_MAGIC ) &&
+              ( fread( &nr, sizeof( int ), 1, f ) == 1 ) && ( nr == CHECKPOINT_FORMAT_NR ) &&
+              ( fread( &params, sizeof( Grow_Parameters ), 1, f ) == 1 ) &&
+              ( fread( &loaded, sizeof( Pack_State ), 1, f ) == 1 ) &&
+              ( fread( &nr, sizeof( int ), 1, f ) == 1 ) && ( nr > 0 ) && ( nr <= MAX_RANDOM_STATE_LEN );
+    if ( OK )
+    {
+        random_state.resize( nr );
+        OK = ( fread( random_state.data(), sizeof( char ), nr, f ) == ( size_t ) nr );
+    }
+    OK = OK && Read_ints( f, lengths );
+    OK = OK && Read_ints( f, additive_counts );
+    OK = OK && ( fread( &prepended, sizeof( char ), 1, f ) == 1 );
+    OK = OK && Grid_read( grid, f );
+
+    /* histogram entries are site numbers, at most one per site */
+    nr_sites = OK ? grid->nr_sites : 0;
+    OK = OK && ( fread( &nr, sizeof( int ), 1, f ) == 1 ) && ( nr >= 0 ) && ( nr <= nr_sites + 1 );
+    if ( OK )
+    {
+        hist.resize( 3 * nr );
+        OK = ( fread( hist.data(), sizeof( int ), 3 * nr, f ) == ( size_t )( 3 * nr ) );
+    }
+    fclose( f );
+
+    /* the random number state is the last thing that can fail, it is restored as a whole or not at all */
+    OK = OK && restoreRandomNumberGenerator( random_state );
+    if ( !OK ) return false;
+
+    g_grow_params = params;
+    *state = loaded;
+
+    free( ( void* )hist_atoms );
+    free( ( void* )hist_chains );
+    hist_atoms = ( int* ) malloc( ( nr_sites + 1 ) * sizeof( int ) );
+    hist_chains = ( int* ) malloc( ( nr_sites + 1 ) * sizeof( int ) );
+    for ( i = 0; i <= nr_sites; i++ )
+    {
+        hist_atoms[i] = 0;
+        hist_chains[i] = 0;
+    }
+    for ( i = 0; i < nr; i++ )
+    {
+        if ( ( hist[3 * i] < 0 ) || ( hist[3 * i] > nr_sites ) ) continue;
+        hist_chains[hist[3 * i]] = hist[3 * i + 1];
+        hist_atoms[hist[3 * i]] = hist[3 * i + 2];
+    }
+
+    chainList().restore( lengths, additive_counts, prepended );
+    chain_base = state->chain_base;
+    return true;
+}
+
+
+/* ----------------------------------------------------------------------------------------- */
+char Pack_resume( char filename[], Grid* grid, Grow_Parameters* grow_params )
+/* ----------------------------------------------------------------------------------------- */
+{
+    /* continues a Pack() from its last checkpoint; the result is identical to
+       that of the uninterrupted run */
+
+    Pack_State state;
+
+    if ( !Load_Checkpoint( filename, grid, &state ) )
+    {
+        sprintf( buffer, "can not resume from checkpoint %s\n", filename );
+        appWindow()->appendText( buffer );
+        return false;
+    }
+    *grow_params = g_grow_params;
+    Vector_set_kappa( grid->params.kappa );
+
+    Pack_packings( grid, &state, true );
+    return true;
 }
 
+
 #define MAX_LINE_LEN 64000
 
 /* ----------------------------------------------------------------------------------------- */
@@ -847,7 +1167,7 @@ char Save_System( char filename[], Grid* grid, Grow_Parameters* grow_params, con
     }
     fprintf( f, "\n" );
 
-    fprintf( f, "/* maximum overlap %f */\n", Grid_max_overlap( grid, grow_params ) );
+    fprintf( f, "/* maximum overlap %f */\n", Grid_max_overlap( grid ) );
     fprintf( f, "\n" );
     fprintf( f, "/* Orientation matrix */\n" );
     if ( Anum <= 0 ) Anum = 1;
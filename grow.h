@@ -35,7 +35,10 @@ typedef struct
 } Grow_Parameters;
 
 void Pack( Grid* grid, Grow_Parameters* grow_params );
-float    Grid_max_overlap( Grid* grid, Grow_Parameters* grow_params );
+int  Pack_append( Grid* grid, Grow_Parameters* grow_params );
+void Pack_set_checkpoint( const char* filename, int nr_chains, int nr_seconds );
+char Pack_resume( char filename[], Grid* grid, Grow_Parameters* grow_params );
+float    Grid_max_overlap( Grid* grid );
 
 
 char Save_System( char filename[], Grid* grid, Grow_Parameters* grow_params, const char* monomerJsonList, const char* sequenceJsonList, const char* additivreJsonList );
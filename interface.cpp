@@ -65,13 +65,13 @@ void  interfaceStateProcess()
 
         case STATE_GO :
         case STATE_ABORT :
-            appWindow()->drawChains();
+            appWindow()->updateChains();
             qApp->processEvents();
             break;
 
         case STATE_STEP :
             gState = STATE_PAUSE;
-            appWindow()->drawChains();
+            appWindow()->updateChains();
 
             while ( gState == STATE_PAUSE )
             {
@@ -80,7 +80,7 @@ void  interfaceStateProcess()
             break;
 
         case STATE_PAUSE :
-            appWindow()->drawChains( );
+            appWindow()->updateChains();
             while ( gState == STATE_PAUSE )
             {
                 qApp->processEvents();
@@ -23,6 +23,7 @@
 
 #include "mainwindow.h"
 #include <QApplication>
+#include <string.h>
 
 MainWindow* mainwin = 0;
 
@@ -30,6 +31,15 @@ MainWindow* appWindow() { return mainwin; }
 
 int main( int argc, char* argv[] )
 {
+    // batch runs never show the window, so they need no display either
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( ( 0 == strncmp( argv[i], "-E", 2 ) || 0 == strncmp( argv[i], "-S", 2 ) ) && false == qEnvironmentVariableIsSet( "QT_QPA_PLATFORM" ) )
+        {
+            qputenv( "QT_QPA_PLATFORM", "offscreen" );
+        }
+    }
+
     QApplication a( argc, argv );
 
     QCoreApplication::setOrganizationName( "Columbia Hill Technical Consulting" );
@@ -59,10 +69,30 @@ int main( int argc, char* argv[] )
         printf( "  [-z exponent] z-Axis alignment, (p(u) = uz^exponent)\n" );
         printf( "  [-p nr_packings]\n" );
         printf( "  [-x] with X interface\n" );
+        printf( "  [-C file] write packing checkpoints to file\n" );
+        printf( "  [-N chains] checkpoint every N chains\n" );
+        printf( "  [-T seconds] checkpoint every T seconds (default 600)\n" );
+        printf( "  [-R file] resume packing from checkpoint file\n" );
+        printf( "  [-i file] load model file\n" );
+        printf( "  [-g] grow the loaded model instead of repacking\n" );
+        printf( "  [-G file] write g(r) and coordination numbers as CSV\n" );
+        printf( "  [-X r_max] g(r) cutoff radius (default 5.0)\n" );
+        printf( "  [-W width] g(r) bin width (default 0.05)\n" );
+        printf( "  [-P A,B] g(r) between monomer types A and B (default all, an empty name is all types)\n" );
+        printf( "  [-E file] expose the loaded model with the JSON configuration file, write the results and exit\n" );
+        printf( "  [-S file] render the loaded model, after the exposure if any, into a PNG file and exit\n" );
+        printf( "  [-V view] snapshot view: default (the default), top, front or side\n" );
+        printf( "  [-Q WxH] snapshot size in pixels (default 2048x2048)\n" );
         printf( "  chain_len = 0 means chain_len distribution\n" );
         printf( "\n" );
         exit( 1 );
     }
+    else if ( w.isBatchExposure() || w.isBatchSnapshot() )
+    {
+        if ( w.isBatchExposure() && false == w.runExposure() ) return 1;
+        if ( w.isBatchSnapshot() && false == w.writeSnapshot() ) return 1;
+        return 0;
+    }
     else
     {
         w.show();
@@ -25,11 +25,15 @@
 #include <QIntValidator>
 #include <QMessageBox>
 #include <QSettings>
+#include <QJsonDocument>
+#include <QJsonObject>
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include <qwt3d_graphplot.h>
 #include "exportgriddialog.h"
+#include "radialdistributiondialog.h"
+#include "radialdistribution.h"
 #include "random.h"
 
 #include <math.h>
@@ -44,6 +48,8 @@
 #include "vector.h"
 #include "monomersequence.h"
 #include "exposuredialog.h"
+#include "exposuremodel.h"
+#include "deprotectionprofile.h"
 #include "revision.h"
 
 static Grid            g_grid;
@@ -74,11 +80,27 @@ MainWindow::MainWindow( QWidget* parent ) :
     scan_index( 0 ),
     monomer_type_list(),
     sequence_list(),
+    species_store(),
     has_point_cloud_calculated( false ),
     file_name(),
     version_text( QString( "%1 rev %2, Build date %3" ).arg( QCoreApplication::applicationName() ).arg( REVISION ).arg( __DATE__ ) ),
     model_folder(),
-    output_folder()
+    output_folder(),
+    checkpoint_file(),
+    checkpoint_chains( 0 ),
+    checkpoint_seconds( 0 ),
+    resume_file(),
+    grow_loaded_model( false ),
+    first_grown_chain( 0 ),
+    rdf_file(),
+    rdf_cutoff( 5.0 ),
+    rdf_bin_width( 0.05 ),
+    rdf_types(),
+    exposure_config(),
+    snapshot_file(),
+    snapshot_view( "default" ),
+    snapshot_width( 2048 ),
+    snapshot_height( 2048 )
 {
     ui->setupUi( this );
 
@@ -140,10 +162,30 @@ bool MainWindow::initialize( int argc, char* argv[] )
     if ( true == rc )
     {
         initializeUserEntryFields();
+        ui->actionGrow_Loaded_Model->setChecked( grow_loaded_model );
     }
 
     appendText( versionTextStr() );
 
+    if ( true == rc && false == file_name.isEmpty() )
+    {
+        loadModel();
+    }
+
+    // the monomer names of -P are only known once the model is there
+    int type_a, type_b;
+
+    if ( true == rc && false == rdf_file.isEmpty() && false == radialDistributionTypes( type_a, type_b ) )
+    {
+        printf( "unknown monomer type in -P %s\n", rdf_types.toLocal8Bit().constData() );
+        rc = false;
+    }
+
+    if ( true == rc && false == file_name.isEmpty() )
+    {
+        writeRadialDistribution();
+    }
+
     return rc;
 }
 
@@ -155,10 +197,18 @@ const char* MainWindow::versionText() const
 
 
 
+bool MainWindow::isPeriodicInZ() const
+{
+    // films and brushes have a free surface at the top of the box
+    return ( false == g_params.film && false == g_params.brush );
+}
+
+
+
 void MainWindow::refreshChains()
 {
     QGuiApplication::setOverrideCursor( QCursor( Qt::WaitCursor ) );
-    ui->graphWidget->refreshChains();
+    ui->graphWidget->applySpecies( species_store, monomerList() );
     QGuiApplication::restoreOverrideCursor();
 }
 
@@ -176,6 +226,8 @@ void MainWindow::makeConnections()
     connect( ui->actionExpose, SIGNAL( triggered( bool ) ), this, SLOT( exposeButtonClicked() ) );
     connect( ui->actionReload, SIGNAL( triggered( bool ) ), this, SLOT( reloadButtonClicked() ) );
     connect( ui->actionCalculate_Rg, SIGNAL( triggered( bool ) ), this, SLOT( calculateRgClicked() ) );
+    connect( ui->actionRadial_Distribution, SIGNAL( triggered( bool ) ), this, SLOT( radialDistributionClicked() ) );
+    connect( ui->actionGrow_Loaded_Model, SIGNAL( toggled( bool ) ), this, SLOT( growLoadedModelToggled( bool ) ) );
 
     pauseAction = new QAction( "Pause" );
     connect( pauseAction, SIGNAL( triggered( bool ) ), this, SLOT( pauseButtonClicked() ) );
@@ -395,6 +447,13 @@ void MainWindow::scanChainSliderValueChanged( int newValue )
 
 
 
+void MainWindow::growLoadedModelToggled( bool checked )
+{
+    grow_loaded_model = checked;
+}
+
+
+
 void MainWindow::calculateRgClicked()
 {
     float radius = ui->graphWidget->avgRadiusOfGyration( &g_grid );
@@ -406,6 +465,230 @@ void MainWindow::calculateRgClicked()
 
 
 
+void MainWindow::radialDistributionClicked()
+{
+    RadialDistributionDialog dlg( &g_grid, &monomer_type_list, this );
+
+    dlg.exec();
+}
+
+
+
+bool MainWindow::radialDistributionTypes( int& type_a, int& type_b )
+{
+    // -P names the monomer types of the pair as "A,B", an empty name means all monomers
+    // and a single name pairs the type with itself; -1 is all, a name not in the model fails
+    QStringList names = rdf_types.split( ',' );
+    QStringList monomer_names = monomer_type_list.monomerNameList();
+    int types[2];
+
+    if ( names.count() > 2 )
+    {
+        return false;
+    }
+
+    for ( int i = 0; i < 2; i++ )
+    {
+        QString name = names.at( i < names.count() ? i : 0 ).trimmed();
+
+        types[i] = name.isEmpty() ? -1 : monomer_names.indexOf( name );
+
+        if ( false == name.isEmpty() && types[i] < 0 )
+        {
+            return false;
+        }
+    }
+
+    type_a = types[0];
+    type_b = types[1];
+    return true;
+}
+
+
+
+void MainWindow::writeRadialDistribution()
+{
+    if ( rdf_file.isEmpty() || 0 == g_grid.max_chains )
+    {
+        return;
+    }
+
+    int type_a, type_b;
+
+    if ( false == radialDistributionTypes( type_a, type_b ) )
+    {
+        appendText( QString( "unknown monomer type in %1, g(r) not written" ).arg( rdf_types ) );
+        return;
+    }
+
+    RadialDistribution rdf( rdf_cutoff, rdf_bin_width );
+    rdf.setTypes( type_a, type_b );
+
+    if ( rdf.compute( &g_grid ) && rdf.writeCSV( rdf_file ) )
+    {
+        appendText( QString( "g(r) of %1 A and %2 B monomers up to r = %3 written to %4, coordination number %5" )
+                    .arg( rdf.countA() ).arg( rdf.countB() ).arg( rdf.cutoff() ).arg( rdf_file ).arg( rdf.coordination( rdf.binCount() - 1 ) ) );
+    }
+    else
+    {
+        appendText( QString( "could not write g(r) to %1" ).arg( rdf_file ) );
+    }
+}
+
+
+
+bool MainWindow::runExposure()
+{
+    // messages go to the console, a batch exposure never shows the window
+    if ( 0 == species_store.count() )
+    {
+        printf( "no model to expose, load one with -i\n" );
+        return false;
+    }
+
+    QFile file( exposure_config );
+
+    if ( false == file.open( QIODevice::ReadOnly | QIODevice::Text ) )
+    {
+        printf( "could not read %s\n", exposure_config.toLocal8Bit().constData() );
+        return false;
+    }
+
+    QJsonParseError parse_error;
+    QJsonDocument doc = QJsonDocument::fromJson( file.readAll(), &parse_error );
+
+    if ( doc.isNull() )
+    {
+        printf( "%s: %s\n", exposure_config.toLocal8Bit().constData(), parse_error.errorString().toLocal8Bit().constData() );
+        return false;
+    }
+
+    QJsonObject config = doc.object();
+    QStringList monomer_names = monomer_type_list.monomerNameList();
+    QString error;
+
+    ExposureModel model( species_store );
+    QFileInfo info( exposure_config );
+
+    if ( false == model.fromJson( config, monomer_names, info.absolutePath(), error ) )
+    {
+        printf( "%s: %s\n", exposure_config.toLocal8Bit().constData(), error.toLocal8Bit().constData() );
+        return false;
+    }
+
+    // the profile of a patterned exposure divides the box by these widths
+    QJsonObject profile_config = config.value( "profile" ).toObject();
+    double slab_width = profile_config.value( "slab_width" ).toDouble( 1.0 );
+    double row_width = profile_config.value( "row_width" ).toDouble( 1.0 );
+
+    if ( slab_width <= 0.0 || row_width <= 0.0 )
+    {
+        printf( "%s: profile slab_width and row_width must be positive\n", exposure_config.toLocal8Bit().constData() );
+        return false;
+    }
+
+    // output files default to the name of the configuration
+    QString base_name = info.absolutePath() + "/" + info.completeBaseName();
+    QString chain_file = config.value( "chain_csv" ).toString( base_name + "_chains.csv" );
+    QString summary_file = config.value( "summary_json" ).toString( base_name + "_summary.json" );
+    QString bake_file = config.value( "bake_csv" ).toString( base_name + "_bake.csv" );
+    QString profile_file = config.value( "profile_csv" ).toString( base_name + "_profile.csv" );
+
+    model.prepare();
+
+    QVector<qint16> types = species_store.monomerTypes();
+    QVector<ExposureModel::ChainCounts> chains;
+
+    ExposureModel::Result result = model.expose( types, chains, model.bakeParameters().enabled ? bake_file : QString() );
+
+    for ( int m = 0; m < model.messages().count(); m++ )
+    {
+        printf( "%s\n", model.messages().at( m ).toLocal8Bit().constData() );
+    }
+
+    species_store.setMonomerTypes( types );
+
+    printf( "%s: %d of %d PAGs exposed, %d deprotections, %d neutralizations, extent of deprotection %g, %d of %d chains soluble\n",
+            file_name.toLocal8Bit().constData(), result.num_exposed, model.pagCount(), result.num_deprotections, result.num_neutralizations,
+            result.deprotection_extent, result.num_soluble_chains, result.num_polymer_chains );
+
+    bool rc = true;
+
+    // a patterned exposure is profiled across the lines
+    QJsonObject profile_obj;
+
+    if ( false == model.doseMap().isUniform() )
+    {
+        DeprotectionProfile profile( slab_width, row_width, profile_config.value( "threshold" ).toDouble( 0.5 ) );
+
+        if ( profile.compute( species_store, model.species().protected_type, model.species().deprotected_type, model.periodicBox(), model.doseMap() ) )
+        {
+            printf( "line width %g, LER %g, LWR %g (3 sigma, %d of %d rows with %d edges)\n", profile.meanLineWidth(), profile.lineEdgeRoughness(),
+                    profile.lineWidthRoughness(), profile.rowsUsed(), profile.rowCount(), profile.edgesPerRow() );
+
+            profile_obj.insert( "line_width", profile.meanLineWidth() );
+            profile_obj.insert( "ler", profile.lineEdgeRoughness() );
+            profile_obj.insert( "lwr", profile.lineWidthRoughness() );
+            profile_obj.insert( "rows_used", profile.rowsUsed() );
+            profile_obj.insert( "edges_per_row", profile.edgesPerRow() );
+
+            if ( false == profile.writeCSV( profile_file ) )
+            {
+                printf( "could not write %s\n", profile_file.toLocal8Bit().constData() );
+                rc = false;
+            }
+        }
+    }
+
+    if ( false == ExposureModel::writeChainCSV( chain_file, chains ) )
+    {
+        printf( "could not write %s\n", chain_file.toLocal8Bit().constData() );
+        rc = false;
+    }
+
+    if ( false == model.writeSummaryJSON( summary_file, result, monomer_names, profile_obj ) )
+    {
+        printf( "could not write %s\n", summary_file.toLocal8Bit().constData() );
+        rc = false;
+    }
+
+    return rc;
+}
+
+
+
+bool MainWindow::writeSnapshot()
+{
+    // like a batch exposure, messages go to the console and the window is never shown
+    if ( file_name.isEmpty() )
+    {
+        printf( "no model to render, load one with -i\n" );
+        return false;
+    }
+
+    if ( false == ui->graphWidget->showView( snapshot_view ) )
+    {
+        printf( "unknown view %s, use default, top, front or side\n", snapshot_view.toLocal8Bit().constData() );
+        return false;
+    }
+
+    // an exposure before changed the monomer types
+    ui->graphWidget->applySpecies( species_store, monomerList() );
+
+    if ( false == ui->graphWidget->renderSnapshot( snapshot_file, snapshot_width, snapshot_height ) )
+    {
+        printf( "could not write %s\n", snapshot_file.toLocal8Bit().constData() );
+        return false;
+    }
+
+    printf( "%s: %s view written to %s\n", file_name.toLocal8Bit().constData(), snapshot_view.toLocal8Bit().constData(),
+            snapshot_file.toLocal8Bit().constData() );
+
+    return true;
+}
+
+
+
 void MainWindow::monomerAddButtonClicked( )
 {
     int row = ui->monomerTableWidget->currentRow();
@@ -510,7 +793,7 @@ void MainWindow::calculateBoxSize()
 
 
 
-void MainWindow::drawChains()
+void MainWindow::drawChains( bool newSpecies )
 {
     ui->graphWidget->setShowMonomer( ui->showMonomerCheckBox->isChecked() );
     ui->graphWidget->setColoration( coloration() );
@@ -525,6 +808,49 @@ void MainWindow::drawChains()
     {
         ui->graphWidget->drawChains( &g_grid, monomerList() );
     }
+
+    // only a new grid or point cloud refills the store; a redraw of the same one shows
+    // the stored types again, so exposures survive hiding and showing the monomers
+    if ( newSpecies )
+    {
+        updateSpecies();
+    }
+    else
+    {
+        ui->graphWidget->applySpecies( species_store, monomerList() );
+    }
+}
+
+
+
+void MainWindow::updateChains()
+{
+    // live view while packing: only what changed since the last frame is redrawn, the
+    // species are left alone until the final drawChains() of the run
+    if ( g_params.point_cloud )
+    {
+        drawChains();
+        return;
+    }
+
+    ui->graphWidget->setShowMonomer( ui->showMonomerCheckBox->isChecked() );
+    ui->graphWidget->setColoration( coloration() );
+    ui->graphWidget->updateChains( &g_grid, monomerList() );
+}
+
+
+
+void MainWindow::updateSpecies()
+{
+    if ( g_params.point_cloud )
+    {
+        // a point cloud only exists as the nodes of the graph
+        species_store.fromNodes( ui->graphWidget->monomerArray(), g_params.box_size, isPeriodicInZ() );
+    }
+    else
+    {
+        species_store.fromGrid( &g_grid );
+    }
 }
 
 
@@ -704,12 +1030,90 @@ bool MainWindow::parseParameters( int argc, char* argv[] )
                 g_params.z_exponent = fabs( g_params.z_exponent );
             }
         }
+        else if ( strncmp( argv[i], "-C", 2 ) == 0 )
+        {
+            i++;
+            if ( i < argc ) checkpoint_file = QString( argv[i] );
+        }
+        else if ( strncmp( argv[i], "-N", 2 ) == 0 )
+        {
+            i++;
+            if ( i < argc ) sscanf( argv[i], "%i", &checkpoint_chains );
+        }
+        else if ( strncmp( argv[i], "-T", 2 ) == 0 )
+        {
+            i++;
+            if ( i < argc ) sscanf( argv[i], "%i", &checkpoint_seconds );
+        }
+        else if ( strncmp( argv[i], "-R", 2 ) == 0 )
+        {
+            i++;
+            if ( i < argc ) resume_file = QString( argv[i] );
+        }
+        else if ( strncmp( argv[i], "-i", 2 ) == 0 )
+        {
+            i++;
+            if ( i < argc ) file_name = QString( argv[i] );
+        }
+        else if ( strncmp( argv[i], "-g", 2 ) == 0 )
+        {
+            grow_loaded_model = true;
+        }
+        else if ( strncmp( argv[i], "-G", 2 ) == 0 )
+        {
+            i++;
+            if ( i < argc ) rdf_file = QString( argv[i] );
+        }
+        else if ( strncmp( argv[i], "-X", 2 ) == 0 )
+        {
+            i++;
+            if ( i < argc ) sscanf( argv[i], "%lf", &rdf_cutoff );
+        }
+        else if ( strncmp( argv[i], "-W", 2 ) == 0 )
+        {
+            i++;
+            if ( i < argc ) sscanf( argv[i], "%lf", &rdf_bin_width );
+        }
+        else if ( strncmp( argv[i], "-P", 2 ) == 0 )
+        {
+            i++;
+            if ( i < argc ) rdf_types = QString( argv[i] );
+        }
+        else if ( strncmp( argv[i], "-E", 2 ) == 0 )
+        {
+            i++;
+            if ( i < argc ) exposure_config = QString( argv[i] );
+        }
+        else if ( strncmp( argv[i], "-S", 2 ) == 0 )
+        {
+            i++;
+            if ( i < argc ) snapshot_file = QString( argv[i] );
+        }
+        else if ( strncmp( argv[i], "-V", 2 ) == 0 )
+        {
+            i++;
+            if ( i < argc ) snapshot_view = QString( argv[i] );
+        }
+        else if ( strncmp( argv[i], "-Q", 2 ) == 0 )
+        {
+            i++;
+            if ( i < argc && ( 2 != sscanf( argv[i], "%ix%i", &snapshot_width, &snapshot_height ) || snapshot_width < 1 || snapshot_height < 1 ) )
+            {
+                return false;
+            }
+        }
         else
         {
             return false;
         }
     }
 
+    if ( !checkpoint_file.isEmpty() && checkpoint_chains <= 0 && checkpoint_seconds <= 0 )
+    {
+        checkpoint_seconds = 600;
+    }
+    Pack_set_checkpoint( checkpoint_file.toLocal8Bit().constData(), checkpoint_chains, checkpoint_seconds );
+
     calculateBoxSize();
 
     return true;
@@ -849,7 +1253,7 @@ void MainWindow::updateStatus( int chain_num, int monomer_num )
 
 void MainWindow::exportAsGridButtonClicked()
 {
-    ExportGridDialog dlg( &g_grid, this );
+    ExportGridDialog dlg( &g_grid, &monomer_type_list, this );
 
     dlg.exec();
 
@@ -935,22 +1339,22 @@ bool MainWindow::exportAsCSV( const QString& fileName )
 
     stream << "x,y,z,monomer_name,monomer_id,chain_index" << Qt::endl;
 
-    const AtomVector& monomers = ui->graphWidget->monomerArray();
-    int num_monomers = monomers.size();
-    for ( int i = 2; i < num_monomers; i++ )
+    int num_monomers = species_store.count();
+    for ( int i = 0; i < num_monomers; i++ )
     {
-        Atom m = monomers[i];
+        Qwt3D::Triple pos = species_store.position( i );
+        int monomer_type = species_store.monomerType( i );
 
-        stream << m.pos.x << "," << m.pos.y << "," << m.pos.z;
+        stream << pos.x << "," << pos.y << "," << pos.z;
 
-        if ( 0 <= m.monomer_type && 0 < name_list.count() )
+        if ( 0 <= monomer_type && 0 < name_list.count() )
         {
-            stream << "," << name_list.at( m.monomer_type ) << "," << m.monomer_type;
+            stream << "," << name_list.at( monomer_type ) << "," << monomer_type;
         }
 
-        if ( Qwt3D::INVALID_CHAIN_INDEX != m.chain_index )
+        if ( Qwt3D::INVALID_CHAIN_INDEX != species_store.chainIndex( i ) )
         {
-            stream << "," << m.chain_index;
+            stream << "," << species_store.chainIndex( i );
         }
 
         stream << Qt::endl;
@@ -972,7 +1376,7 @@ void MainWindow::exitButtonClicked()
 
 void MainWindow::exposeButtonClicked()
 {
-    ExposureDialog dlg( &monomer_type_list, ui->graphWidget->monomerArray(), this );
+    ExposureDialog dlg( &monomer_type_list, species_store, this );
     dlg.exec();
 }
 
@@ -1169,7 +1573,7 @@ void MainWindow::showMonomerCheckBoxClicked()
 
 void MainWindow::colorationComboBoxChanged( int )
 {
-    drawChains();
+    updateChains();
 }
 
 
@@ -1199,18 +1603,19 @@ void MainWindow::speciateSpecies()
         if ( has_point_cloud_calculated )
         {
             ui->graphWidget->recolorPointCloud( &sequence_list, &additive_list );
+            updateSpecies();
         }
         else
         {
-            drawChains();
+            drawChains( true );
         }
     }
     else
     {
         if ( false == chainList().additivesPrepended() )
         {
-            int chain_nr = 0;
-            int num_chains = ( g_grid.max_chains < chain_list.polymerChainCount() ) ?  g_grid.max_chains : chain_list.polymerChainCount() ;
+            int chain_nr = first_grown_chain;
+            int num_chains = ( g_grid.max_chains < first_grown_chain + chain_list.polymerChainCount() ) ?  g_grid.max_chains : first_grown_chain + chain_list.polymerChainCount() ;
 
             // do the polymer chains first
             for ( ; chain_nr < num_chains; chain_nr++ )
@@ -1267,8 +1672,8 @@ void MainWindow::speciateSpecies()
         }
         else
         {
-            int chain_nr = 0;
-            int num_chains = 0;
+            int chain_nr = first_grown_chain;
+            int num_chains = first_grown_chain;
 
             //  first colorize any monomers
 
@@ -1331,7 +1736,8 @@ void MainWindow::speciateSpecies()
             }
         }
 
-        drawChains();
+        ui->graphWidget->retypeChains( &g_grid, monomerList() );
+        updateSpecies();
     }
 
     const MonomerCount& mcount = ui->graphWidget->updateMonomerCount( monomer_type_list.count() );
@@ -1395,6 +1801,7 @@ void MainWindow::loadModel()
         QGuiApplication::setOverrideCursor( QCursor( Qt::WaitCursor ) );
 
         Grid_free( &g_grid );
+        first_grown_chain = 0;
 
         QByteArray json_monomer_list;
         QByteArray json_sequence_list;
@@ -1415,7 +1822,7 @@ void MainWindow::loadModel()
 
         ui->graphWidget->clear();
         ui->scanChainSlider->setMaximum( num_chains_created );
-        drawChains();
+        drawChains( true );
         speciateSpecies();
 
 
@@ -1445,7 +1852,7 @@ void MainWindow::reloadButtonClicked()
 
 void MainWindow::onTimeout()
 {
-    drawChains();
+    updateChains();
     updateElapsedTime();
 }
 
@@ -1476,17 +1883,32 @@ void MainWindow::enableRunButtons( bool state )
 
 void MainWindow::updateElapsedTime()
 {
-    ui->elapsedTimeLabel->setText( QString( "calculation running time %1" ).arg( runningTime() ) );
+    if ( g_params.point_cloud )
+        ui->elapsedTimeLabel->setText( QString( "calculation running time %1" ).arg( runningTime() ) );
+    else
+        ui->elapsedTimeLabel->setText( QString( "calculation running time %1, max overlap %2" ).arg( runningTime() ).arg( Grid_max_overlap( &g_grid ) ) );
 }
 
 
 
 void MainWindow::startCalculation()
 {
-    Grid_free( &g_grid );
+    // growing keeps the packing in the grid and adds the new chain list behind it
+    bool grow = grow_loaded_model && g_grid.nr_sites > 0 && resume_file.isEmpty();
+
+    if ( false == grow )
+    {
+        Grid_free( &g_grid );
+    }
 
     readInputs();
 
+    if ( grow )
+    {
+        // the box is fixed by the existing packing
+        g_params = g_grid.params;
+    }
+
     int old_coloration = ui->colorationComboBox->currentIndex();
     ui->colorationComboBox->setCurrentIndex( 0 );
 
@@ -1508,7 +1930,8 @@ void MainWindow::startCalculation()
     ui->calculationProgressBar->setMaximum( g_grow_params.nr_particles );
     ui->calculationProgressBar->setValue( 0 );
 
-    total_num_chains = chain_list.chainCount();
+    first_grown_chain = grow ? Grid_next_free_chain( &g_grid ) : 0;
+    total_num_chains = first_grown_chain + chain_list.chainCount();
 
     seedRandomNumberGenerator( g_grow_params.seed );
     Vector_set_kappa( g_params.kappa );
@@ -1519,13 +1942,40 @@ void MainWindow::startCalculation()
     if ( g_params.point_cloud )
     {
         setInterfaceState( STATE_FAST );
-        drawChains();
+        drawChains( true );
     }
     else
     {
         ui->graphWidget->setTitle( QString( "Polymer chains" ) );
-        Grid_init( &g_grid, &g_params );
-        Pack( &g_grid, &g_grow_params );
+        if ( grow )
+        {
+            appendText( QString( "growing %1 chains onto %2 existing chains" ).arg( chain_list.chainCount() ).arg( first_grown_chain ) );
+            Pack_append( &g_grid, &g_grow_params );
+        }
+        else if ( resume_file.isEmpty() )
+        {
+            Grid_init( &g_grid, &g_params );
+            Pack( &g_grid, &g_grow_params );
+        }
+        else
+        {
+            // the checkpoint carries its own grid, chain list, parameters and random number state
+            QByteArray name = resume_file.toLocal8Bit();
+            resume_file.clear();
+            Grid_init( &g_grid, &g_params );
+            if ( Pack_resume( name.data(), &g_grid, &g_grow_params ) )
+            {
+                g_params = g_grid.params;
+                total_num_chains = chain_list.chainCount();
+                ui->calculationProgressBar->setMaximum( g_grow_params.nr_particles );
+            }
+            else
+            {
+                Grid_free( &g_grid );
+                Grid_init( &g_grid, &g_params );
+                Pack( &g_grid, &g_grow_params );
+            }
+        }
     }
     timer.stop();
 
@@ -1538,9 +1988,10 @@ void MainWindow::startCalculation()
 
     if ( !g_params.point_cloud )
     {
-        ui->elapsedTimeLabel->setText( QString( "calculation of %1 chains completed in %2, max overlap %3" ).arg( num_chains_created ).arg( runningTime() ).arg( Grid_max_overlap( &g_grid, &g_grow_params ) ) );
+        ui->elapsedTimeLabel->setText( QString( "calculation of %1 chains completed in %2, max overlap %3" ).arg( num_chains_created ).arg( runningTime() ).arg( Grid_max_overlap_exact( &g_grid ) ) );
         appendText( QString( "Final avg radius of gyration: %1" ).arg( ui->graphWidget->avgRadiusOfGyration() ) );
         speciateSpecies();
+        writeRadialDistribution();
     }
 
     enableRunButtons( false );
@@ -1551,5 +2002,5 @@ void MainWindow::startCalculation()
     updateActivations();
 
     ui->colorationComboBox->setCurrentIndex( old_coloration );
-    drawChains();
+    drawChains( true );
 }
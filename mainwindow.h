@@ -34,6 +34,7 @@
 #include "coloration.h"
 #include "additiveclusterlist.h"
 #include "additivelist.h"
+#include "speciesstore.h"
 
 namespace Ui
 {
@@ -57,16 +58,23 @@ public:
     void appendText( const QString& s );
     void updateStatus( int chain_num, int monomer_num );
     void calculateBoxSize();
-    void drawChains();
+    void drawChains( bool newSpecies = false );
+    void updateChains();
     void setCurrentChainTargetLength( int length );
     void updateCurrentChainLength( int length );
     enum COLORATION coloration() const;
     MonomerList* monomerList() { return &monomer_type_list; }
     MonomerSequence* sequenceList() { return &sequence_list; }
     AdditiveList* additiveList() { return &additive_list; }
+    SpeciesStore& species() { return species_store; }
     const QString& fileName() const { return file_name; }
     const QString& versionTextStr() const { return version_text;}
     const char* versionText() const;
+    bool isPeriodicInZ() const;
+    bool isBatchExposure() const { return !exposure_config.isEmpty(); }
+    bool runExposure();
+    bool isBatchSnapshot() const { return !snapshot_file.isEmpty(); }
+    bool writeSnapshot();
     const QString& outputFolder() const { return output_folder; }
     void setOutputFolder( const QString&  f )  { output_folder = f; }
     void reload() { reloadButtonClicked();}
@@ -104,11 +112,27 @@ private:
     MonomerList monomer_type_list;
     MonomerSequence sequence_list;
     AdditiveList additive_list;
+    SpeciesStore species_store;
     bool has_point_cloud_calculated;
     QString file_name;
     QString version_text;
     QString model_folder;
     QString output_folder;
+    QString checkpoint_file;
+    int checkpoint_chains;
+    int checkpoint_seconds;
+    QString resume_file;
+    bool grow_loaded_model;
+    int first_grown_chain;
+    QString rdf_file;
+    double rdf_cutoff;
+    double rdf_bin_width;
+    QString rdf_types;
+    QString exposure_config;
+    QString snapshot_file;
+    QString snapshot_view;
+    int snapshot_width;
+    int snapshot_height;
 
     void enableRunButtons( bool state );
     void makeConnections();
@@ -116,6 +140,9 @@ private:
     bool parseParameters( int argc, char* argv[] );
     void initializeUserEntryFields();
     void startCalculation();
+    bool radialDistributionTypes( int& type_a, int& type_b );
+    void writeRadialDistribution();
+    void updateSpecies();
 
 protected slots:
     void exportAsGridButtonClicked();
@@ -157,6 +184,8 @@ protected slots:
     void clearAdditiveListList();
     void scanChainSliderValueChanged( int newValue );
     void calculateRgClicked();
+    void radialDistributionClicked();
+    void growLoadedModelToggled( bool checked );
 };
 
 
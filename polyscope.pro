@@ -6,6 +6,7 @@
 
 QT       += core gui widgets
 QT       += opengl openglwidgets
+QT       += concurrent
 
 TARGET = polyscope
 TEMPLATE = app
@@ -67,6 +68,7 @@ SOURCES += \
     additivelist.cpp \
     additivetablewidget.cpp \
     comboboxdelegate.cpp \
+    crosssectiondialog.cpp \
     definedtablewidget.cpp \
     exportgriddialog.cpp \
     exposuredialog.cpp \
@@ -110,7 +112,18 @@ SOURCES += \
     chaingraph.cpp \
     colorring.cpp \
     chainlist.cpp \
-    random.cpp
+    random.cpp \
+    voxelizer.cpp \
+    spatialindex.cpp \
+    snapshotrenderer.cpp \
+    radialdistribution.cpp \
+    radialdistributiondialog.cpp \
+    speciesstore.cpp \
+    bakesimulator.cpp \
+    exposuremodel.cpp \
+    dissolution.cpp \
+    dosemap.cpp \
+    deprotectionprofile.cpp
 HEADERS += \
     additive.h \
     additiveclusterlist.h \
@@ -118,6 +131,7 @@ HEADERS += \
     additivetablewidget.h \
     coloration.h \
     comboboxdelegate.h \
+    crosssectiondialog.h \
     definedtablewidget.h \
     exportgriddialog.h \
     exposuredialog.h \
@@ -167,11 +181,24 @@ HEADERS += \
     chaingraph.h \
     colorring.h \
     chainlist.h \
-    random.h
+    random.h \
+    voxelizer.h \
+    spatialindex.h \
+    snapshotrenderer.h \
+    radialdistribution.h \
+    radialdistributiondialog.h \
+    speciesstore.h \
+    bakesimulator.h \
+    exposuremodel.h \
+    dissolution.h \
+    dosemap.h \
+    deprotectionprofile.h
 
 FORMS += \
+        crosssectiondialog.ui \
         exportgriddialog.ui \
         exposuredialog.ui \
+        radialdistributiondialog.ui \
         mainwindow.ui
 
 # Default rules for deployment.
@@ -5,6 +5,12 @@
 #include "qwt3d_plot3d.h"
 #include "qwt3d_data.h"
 
+#include <QOpenGLBuffer>
+#include <QPair>
+#include <memory>
+
+class QOpenGLShaderProgram;
+
 namespace Qwt3D
 {
 
@@ -14,12 +20,62 @@ class QWT3D_EXPORT GraphPlot : public Plot3D
 //    Q_OBJECT
 
 public:
+    //! Bond rendering styles
+    enum BONDSTYLE
+    {
+        STICKS,    //!< Tessellated cylinders in the display list
+        CYLINDERS, //!< Ray-cast capsule impostors, STICKS without shader support
+        LINES      //!< One line strip per chain
+    };
+
+    //! Sources of the impostor colors, nodes and bonds keep their own alpha
+    enum COLORSOURCE
+    {
+        OWNCOLORS,   //!< Atom::col and Bond::col
+        CHAINCOLORS, //!< Chain palette, indexed by Atom::index and Bond::index
+        TYPECOLORS   //!< Type palette for nodes, indexed by Atom::monomer_type, one color for all bonds
+    };
+
     GraphPlot( QWidget * parent = 0, const  QOpenGLWidget* shareWidget = 0 );
+    ~GraphPlot();
  
     int createDataset( Qwt3D::AtomVector const& nodes, Qwt3D::BondVector const& edges, bool append = false );
+    int createDataset( std::shared_ptr<const Qwt3D::RenderNodeVector> nodes, std::shared_ptr<const Qwt3D::RenderBondVector> edges,
+                       Qwt3D::ParallelEpiped const& hull, bool append = false );
+    void updateDataTail( unsigned firstNode, unsigned firstBond ); //!< Like updateData(), for shared data that changed from these indices on only
+
+    void setImpostors( bool val ); //!< Draw nodes as ray-cast sphere impostors when the context supports them (default)
+    bool impostors() const { return impostors_; } //!< Returns true, if sphere impostors are requested
+    bool impostorsAvailable() const { return 0 != sphere_program_; } //!< Returns true, if the context compiled the impostor shaders
+
+    void setBondStyle( BONDSTYLE val ); //!< Sets the bond style (default CYLINDERS)
+    BONDSTYLE bondStyle() const { return bond_style_; } //!< Returns the bond style
+    void setBondLineWidth( double val ); //!< Sets the line width for LINES bonds
+    double bondLineWidth() const { return bond_line_width_; } //!< Returns the line width for LINES bonds
+    double bondRadius() const; //!< Returns the radius of STICKS and CYLINDERS bonds, in proportion to the hull
+
+    void setColorSource( COLORSOURCE val ); //!< Sets the impostor color source (default OWNCOLORS)
+    COLORSOURCE colorSource() const { return color_source_; } //!< Returns the impostor color source
+    void setChainPalette( std::vector<Qwt3D::RGBA> const& colors ); //!< Sets the colors for CHAINCOLORS
+    void setTypePalette( std::vector<Qwt3D::RGBA> const& colors, Qwt3D::RGBA const& bondColor ); //!< Sets the colors for TYPECOLORS
+    void setChainVisibility( std::vector<bool> const& visible ); //!< Hides the chains with a false entry, an empty vector shows all
+    std::vector<bool> const& chainVisibility() const { return chain_visibility_; } //!< Returns the chain visibility
+    bool paletteAvailable() const { return impostors_ && 0 != sphere_program_ && CYLINDERS == bond_style_; } //!< Returns true, if every node and bond is drawn through the palette
+    void updateAttributes(); //!< Like updateData(), for shared data that changed in its node types only
+
+    void setChunkSize( Qwt3D::Triple const& size ); //!< Sets the edge lengths of the culling chunks, zero components divide the hull into 16
+    void setSpriteSize( double pixels ); //!< Draws chunks whose nodes appear smaller than this as point sprites, 0 disables (default 3)
+    double spriteSize() const { return sprite_size_; } //!< Returns the node size in pixels below which chunks become point sprites
+    void setClipBox( Qwt3D::ParallelEpiped const& box ); //!< Shows only the nodes and bonds centred inside the box
+    void clearClipBox(); //!< Shows the whole graph again
+    bool clipped() const { return clipped_; } //!< Returns true, if a clip box is set
+    Qwt3D::ParallelEpiped const& clipBox() const { return clip_box_; } //!< Returns the clip box
 
 protected:
+    void initializeGL();
+    void createOpenGlData();
     void createOpenGlData(const Plotlet& pl);
+    void drawOpenGlData();
 
 private:
     class GraphData : public Data
@@ -30,9 +86,70 @@ private:
         GraphData* clone() const {return new GraphData(*this);}
         bool empty() const;
 
-        AtomVector nodes;
-        BondVector bonds;
+        // shared with the caller of createDataset, clones share them as well
+        std::shared_ptr<const RenderNodeVector> nodes;
+        std::shared_ptr<const RenderBondVector> bonds;
     };
+
+    bool initializeImpostors();
+    void appendSphereInstances( RenderNodeVector const& nodes, unsigned first = 0 );
+    void appendBondPolylines( RenderBondVector const& bonds, unsigned first = 0 );
+    void drawSphereImpostors();
+    void drawSphereSprites();
+    void drawBondImpostors();
+    void setInstanceUniforms( QOpenGLShaderProgram* program );
+    void uploadPalette();
+    void layoutChunks();
+    void updateChunks();
+
+    bool impostors_;
+    BONDSTYLE bond_style_;
+    double bond_line_width_;
+    double bond_radius_;
+    std::vector<float> sphere_instances_; // x, y, z, radius, r, g, b, a per visible node
+    std::vector<float> bond_vertices_; // x, y, z, bond flag, r, g, b, a per polyline vertex
+    std::vector< QPair<int, int> > bond_runs_; // first vertex and vertex count per polyline
+    std::vector<float> sphere_keys_; // type and chain id per visible node
+    std::vector<float> bond_keys_; // no type (-1) and chain id per polyline vertex
+    std::vector<int> node_marks_; // size of sphere_instances_ before each node
+    std::vector< QPair<int, int> > bond_marks_; // size of bond_vertices_ and bond_runs_ before each bond
+    size_t sphere_upload_from_; // first float of sphere_instances_ not yet in sphere_buffer_
+    size_t bond_upload_from_;
+    int sphere_capacity_; // bytes allocated in sphere_buffer_
+    int bond_capacity_;
+    int sphere_key_capacity_;
+    int bond_key_capacity_;
+    bool sphere_keys_changed_;
+    COLORSOURCE color_source_;
+    std::vector<RGBA> chain_palette_;
+    std::vector<RGBA> type_palette_;
+    RGBA typeless_color_; // bonds with TYPECOLORS
+    std::vector<bool> chain_visibility_;
+    bool palette_changed_;
+    GLuint palette_texture_; // rows of type colors, chain colors and chain visibility
+    Triple chunk_size_; // as requested, zero for automatic
+    Triple chunk_origin_;
+    Triple chunk_width_;
+    int chunk_counts_[3];
+    std::vector<GLubyte> chunk_states_; // hidden, sprites or full, as RGBA texels per chunk
+    bool chunks_changed_;
+    bool full_chunks_; // some chunk is drawn with impostors
+    bool sprite_chunks_;
+    double sprite_size_;
+    double node_reach_; // largest node radius, chunk bounds grow by it
+    double bond_reach_; // largest bond length plus radius
+    bool clipped_;
+    ParallelEpiped clip_box_;
+    GLuint chunk_texture_;
+    QOpenGLShaderProgram* sphere_program_;
+    QOpenGLShaderProgram* sprite_program_;
+    QOpenGLShaderProgram* bond_program_;
+    QOpenGLBuffer corner_buffer_;
+    QOpenGLBuffer box_buffer_;
+    QOpenGLBuffer sphere_buffer_;
+    QOpenGLBuffer bond_buffer_;
+    QOpenGLBuffer sphere_key_buffer_;
+    QOpenGLBuffer bond_key_buffer_;
 };
 
 } // ns
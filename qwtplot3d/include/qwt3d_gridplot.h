@@ -1,7 +1,10 @@
 #ifndef qwt3d_gridplot_h__2005_7_10_begin_guarded_code
 #define qwt3d_gridplot_h__2005_7_10_begin_guarded_code
 
-#include <QtCore/QThread>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+#include <QOpenGLBuffer>
 
 #include "qwt3d_surfaceplot.h"
 
@@ -18,7 +21,7 @@ class QWT3D_EXPORT GridPlot : public SurfacePlot
 
 public:
     GridPlot(QWidget* parent = 0, const QOpenGLWidget* shareWidget = 0);
-    virtual ~GridPlot() {}
+    virtual ~GridPlot();
 
     int	resolution() const {return resolution_p;} //!< Returns data resolution (1 means all data)
 
@@ -86,46 +89,64 @@ protected:
         void clear();
     };
 
-	// thread vector processor
-	class CVertexProcessor: public QThread
+	// vector processor, run on the thread pool of the plot
+	class CVertexProcessor: public QRunnable
 	{
 	public:
 		CVertexProcessor();
 
 		void setup(int dataWidth, int dataLength, const GridData& data, int row, int step, 
 			bool useColorMap, const Qwt3D::RGBA& fixedColor, const Color* colorData = NULL,
-			bool showMesh = false, const Qwt3D::RGBA& meshColor = Qwt3D::RGBA(0,0,0,0));
+			bool showMesh = false, const Qwt3D::RGBA& meshColor = Qwt3D::RGBA(0,0,0,0),
+			QSemaphore* done = NULL);
 
 		virtual void run();
 
 		void paintGL();
+		void destroyBuffers();
 
 	private:
+		//! Interleaved vertex of the filled strips
+		struct FillVertex
+		{
+			GLfloat position[3];
+			GLfloat normal[3];
+			GLfloat color[4];
+		};
+
 		void processVertex(bool& stripStarted, int i, int j, int& index, int& size);
 		void endVertex(int& index, int& size);
 
 		void processLineStripVertex(bool& stripStarted, int i, int j, int& index, int& size);
 		void endLineVertex(int& index, int& size);
 
+		void upload();
+
 		int m_dataWidth, m_dataLength, m_row, m_step;
-		TripleVector m_draw_normals, m_draw_vertices;
-		ColorVector m_draw_colors;
+		std::vector<FillVertex> m_draw_vertices;
 		std::vector< QPair<int,int> > m_drawList;
 		const GridData* m_data;
 		bool m_drawFill, m_useColorMap;
 		Qwt3D::RGBA m_fixedColor;
 		const Color* m_colorData;
+		QSemaphore* m_done;
 
 		bool m_drawMesh;
 		Qwt3D::RGBA m_meshColor;
-		TripleVector m_mesh_vertices;
-		ColorVector m_mesh_colors;
+		std::vector<GLfloat> m_mesh_vertices; // x, y, z per vertex, the mesh has one color
 		std::vector< QPair<int,int> > m_drawMeshList;
+
+		// run() fills the vectors without a GL context, the first paintGL() moves them into the buffers
+		bool m_uploaded;
+		QOpenGLBuffer m_fillBuffer;
+		QOpenGLBuffer m_meshBuffer;
 	};
 
 	int m_threadsCount;
 	CVertexProcessor m_workers[10];
     bool m_useThreads;
+	QThreadPool m_pool; //!< Keeps its threads between calls of createOpenGlData()
+	QSemaphore m_workersDone; //!< Released once by every worker when it is done
 
     void createNormals(const Plotlet& pl);
     void data2Floor(const Plotlet& pl);
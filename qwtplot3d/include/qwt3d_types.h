@@ -462,7 +462,92 @@ public:
 typedef std::vector<Bond> BondVector;
 typedef std::vector<Atom> AtomVector;
 
+//! Packs a color into 8 bits per channel, red in the lowest byte
+inline GLuint packRGBA( Qwt3D::RGBA const& c )
+{
+    double ch[4] = { c.r, c.g, c.b, c.a };
+    GLuint packed = 0;
+
+    for ( int i = 0; i < 4; ++i )
+        packed |= GLuint( std::min( std::max( ch[i], 0.0 ), 1.0 ) * 255.0 + 0.5 ) << ( 8 * i );
+
+    return packed;
+}
+
+//! Unpacks a color packed by packRGBA()
+inline Qwt3D::RGBA unpackRGBA( GLuint packed )
+{
+    return Qwt3D::RGBA( ( packed & 0xff ) / 255.0, ( ( packed >> 8 ) & 0xff ) / 255.0,
+                        ( ( packed >> 16 ) & 0xff ) / 255.0, ( packed >> 24 ) / 255.0 );
+}
+
+//! Compact Atom for large graphs, 32 bytes in place of about 80
+class RenderNode
+{
+public:
+    GLfloat pos[3];
+    GLfloat radius;
+    GLuint col; //!< packRGBA() color
+    int index;
+    int monomer_type;
+    int chain_index;
+
+    RenderNode() {}
+    RenderNode( int i, Triple p, double r, Qwt3D::RGBA c = Qwt3D::RGBA(), int monomerType = -1, int chainIndex = INVALID_CHAIN_INDEX )
+    {
+        index = i; setPosition( p ); radius = GLfloat( r ); col = packRGBA( c ); monomer_type = monomerType; chain_index = chainIndex;
+    }
+    explicit RenderNode( Atom const& a )
+    {
+        index = a.index; setPosition( a.pos ); radius = GLfloat( a.radius ); col = packRGBA( a.col ); monomer_type = a.monomer_type; chain_index = a.chain_index;
+    }
+
+    Atom atom() const { return Atom( index, position(), radius, color(), monomer_type, chain_index ); }
+    Triple position() const { return Triple( pos[0], pos[1], pos[2] ); }
+    void setPosition( Triple const& p ) { pos[0] = GLfloat( p.x ); pos[1] = GLfloat( p.y ); pos[2] = GLfloat( p.z ); }
+    Qwt3D::RGBA color() const { return unpackRGBA( col ); }
+    void setColor( Qwt3D::RGBA const& c ) { col = packRGBA( c ); }
+    void setAlpha( double a ) { col = ( col & 0x00ffffff ) | ( packRGBA( Qwt3D::RGBA( 0, 0, 0, a ) ) & 0xff000000 ); }
+    bool visible() const { return 0 != ( col >> 24 ); } //!< Nonzero alpha
+};
+
+//! Compact Bond for large graphs, 32 bytes in place of about 88
+class RenderBond
+{
+public:
+    GLfloat first[3];
+    GLfloat second[3];
+    GLuint col; //!< packRGBA() color
+    int index;
+
+    RenderBond() {}
+    RenderBond( int i, Triple t1, Triple t2, Qwt3D::RGBA c = Qwt3D::RGBA() )
+    {
+        index = i; setEnds( t1, t2 ); col = packRGBA( c );
+    }
+    explicit RenderBond( Bond const& b )
+    {
+        index = b.index; setEnds( b.first, b.second ); col = packRGBA( b.col );
+    }
+
+    Bond bond() const { return Bond( index, begin(), end(), color() ); }
+    Triple begin() const { return Triple( first[0], first[1], first[2] ); }
+    Triple end() const { return Triple( second[0], second[1], second[2] ); }
+    void setEnds( Triple const& t1, Triple const& t2 )
+    {
+        first[0] = GLfloat( t1.x ); first[1] = GLfloat( t1.y ); first[2] = GLfloat( t1.z );
+        second[0] = GLfloat( t2.x ); second[1] = GLfloat( t2.y ); second[2] = GLfloat( t2.z );
+    }
+    Qwt3D::RGBA color() const { return unpackRGBA( col ); }
+    void setColor( Qwt3D::RGBA const& c ) { col = packRGBA( c ); }
+    void setAlpha( double a ) { col = ( col & 0x00ffffff ) | ( packRGBA( Qwt3D::RGBA( 0, 0, 0, a ) ) & 0xff000000 ); }
+    bool visible() const { return 0 != ( col >> 24 ); } //!< Nonzero alpha
+};
+typedef std::vector<RenderBond> RenderBondVector;
+typedef std::vector<RenderNode> RenderNodeVector;
+
 QWT3D_EXPORT Qwt3D::ParallelEpiped hull( AtomVector const& data );
+QWT3D_EXPORT Qwt3D::ParallelEpiped hull( RenderNodeVector const& data );
 
 
 
@@ -6,12 +6,359 @@
 
 #include "qwt3d_graphplot.h"
 
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+#ifndef GL_PROGRAM_POINT_SIZE
+#define GL_PROGRAM_POINT_SIZE 0x8642
+#endif
+#ifndef GL_POINT_SPRITE
+#define GL_POINT_SPRITE 0x8861
+#endif
+
 using namespace Qwt3D;
 
+namespace
+{
+
+// Impostors: every node is a quad facing the camera in front of its sphere, every bond a box
+// around its capsule. The fragment shaders intersect the view ray with the sphere or capsule
+// and write the true depth. The fixed function matrices and light 0 set up by Plot3D are read
+// through the compatibility built-ins; Plot3D keeps the camera distance in the projection
+// matrix, so the camera is recovered from its inverse.
+
+const char* impostor_functions =
+    "#version 130\n"
+    "uniform bool lighting;\n"
+    "void viewRay( vec3 eye_position, out vec3 origin, out vec3 ray )\n"
+    "{\n"
+    "    bool ortho = 0.0 == gl_ProjectionMatrix[2][3];\n"
+    "    vec4 camera = gl_ProjectionMatrixInverse * vec4( 0.0, 0.0, 1.0, 0.0 );\n"
+    "    origin = ortho ? eye_position : camera.xyz / camera.w;\n"
+    "    ray = normalize( ortho ? camera.xyz : eye_position - origin );\n"
+    "}\n"
+    "float fragmentDepth( vec3 hit )\n"
+    "{\n"
+    "    vec4 clip = gl_ProjectionMatrix * vec4( hit, 1.0 );\n"
+    "    return 0.5 * ( gl_DepthRange.diff * clip.z / clip.w + gl_DepthRange.near + gl_DepthRange.far );\n"
+    "}\n"
+    "vec4 shade( vec3 hit, vec3 normal, vec4 color )\n"
+    "{\n"
+    "    vec3 rgb = color.rgb;\n"
+    "    if ( lighting )\n"
+    "    {\n"
+    "        vec4 lpos = gl_LightSource[0].position;\n"
+    "        vec3 light = normalize( 0.0 == lpos.w ? lpos.xyz : lpos.xyz - hit );\n"
+    "        float diffuse = max( dot( normal, light ), 0.0 );\n"
+    "        vec3 half_vector = normalize( light + vec3( 0.0, 0.0, 1.0 ) );\n"
+    "        float specular = 0.0 < diffuse ? pow( max( dot( normal, half_vector ), 0.0 ), gl_FrontMaterial.shininess ) : 0.0;\n"
+    "        rgb = rgb * ( gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb + gl_LightSource[0].diffuse.rgb * diffuse )\n"
+    "            + gl_FrontMaterial.specular.rgb * gl_LightSource[0].specular.rgb * specular;\n"
+    "    }\n"
+    "    return vec4( min( rgb, vec3( 1.0 ) ), color.a );\n"
+    "}\n";
+
+// The palette texture holds rows of PALETTE_WIDTH texels: type colors, chain colors and chain
+// visibility, each table starting at a row of its own. Every instance carries its type and chain
+// id (key), so recoloring or hiding chains changes the texture and uniforms, not the geometry.
+// The chunk texture holds the state of every chunk of the scene for the current view: hidden
+// (culled or clipped), drawn as point sprites or drawn as impostors. Nodes belong to the chunk
+// of their centre, bonds to the chunk of their midpoint.
+const int PALETTE_WIDTH = 256;
+const int CHUNKS_PER_AXIS = 16; // automatic chunk size
+const int MAX_CHUNKS_PER_AXIS = 64;
+const GLubyte CHUNK_HIDDEN = 0;
+const GLubyte CHUNK_SPRITES = 1;
+const GLubyte CHUNK_FULL = 2;
+
+const char* instance_functions =
+    "#version 130\n"
+    "uniform sampler2D palette;\n"
+    "uniform sampler2D chunks;\n"
+    "uniform vec3 chunk_origin;\n"
+    "uniform vec3 chunk_width;\n"
+    "uniform vec3 chunk_counts;\n"
+    "uniform vec3 clip_min;\n"
+    "uniform vec3 clip_max;\n"
+    "uniform int color_source;\n"
+    "uniform int type_row;\n"
+    "uniform int type_count;\n"
+    "uniform int chain_row;\n"
+    "uniform int chain_count;\n"
+    "uniform int visibility_row;\n"
+    "uniform int visibility_count;\n"
+    "vec4 paletteEntry( int row, int index )\n"
+    "{\n"
+    "    return texelFetch( palette, ivec2( index % 256, row + index / 256 ), 0 );\n"
+    "}\n"
+    "bool chainVisible( int chain )\n"
+    "{\n"
+    "    return chain < 0 || chain >= visibility_count || 0.5 < paletteEntry( visibility_row, chain ).r;\n"
+    "}\n"
+    "int chunkState( vec3 p )\n"
+    "{\n"
+    "    if ( any( lessThan( p, clip_min ) ) || any( greaterThan( p, clip_max ) ) )\n"
+    "        return 0;\n"
+    "    ivec3 counts = ivec3( chunk_counts );\n"
+    "    ivec3 c = clamp( ivec3( floor( ( p - chunk_origin ) / chunk_width ) ), ivec3( 0 ), counts - 1 );\n"
+    "    int index = c.x + counts.x * ( c.y + counts.y * c.z );\n"
+    "    return int( texelFetch( chunks, ivec2( index % 256, index / 256 ), 0 ).r * 255.0 + 0.5 );\n"
+    "}\n"
+    "vec4 paletteColor( vec4 color, vec2 key )\n"
+    "{\n"
+    "    int type = int( key.x );\n"
+    "    int chain = int( key.y );\n"
+    "    if ( 1 == color_source && 0 <= chain && chain < chain_count )\n"
+    "        color.rgb = paletteEntry( chain_row, chain ).rgb;\n"
+    "    else if ( 2 == color_source && 0 <= type && type < type_count )\n"
+    "        color.rgb = paletteEntry( type_row, type ).rgb;\n"
+    "    return color;\n"
+    "}\n";
+
+const char* sphere_vertex_shader =
+    "in vec2 corner;\n"
+    "in vec4 sphere;\n"
+    "in vec4 color;\n"
+    "in vec2 key;\n"
+    "out vec3 eye_position;\n"
+    "flat out vec3 eye_centre;\n"
+    "flat out float eye_radius;\n"
+    "flat out vec4 sphere_color;\n"
+    "void main()\n"
+    "{\n"
+    "    if ( 2 != chunkState( sphere.xyz ) || !chainVisible( int( key.y ) ) )\n"
+    "    {\n"
+    "        gl_Position = vec4( 0.0, 0.0, 2.0, 1.0 );\n"
+    "        return;\n"
+    "    }\n"
+    "    vec4 centre = gl_ModelViewMatrix * vec4( sphere.xyz, 1.0 );\n"
+    "    float scale = max( length( gl_ModelViewMatrix[0].xyz ), max( length( gl_ModelViewMatrix[1].xyz ), length( gl_ModelViewMatrix[2].xyz ) ) );\n"
+    "    eye_centre = centre.xyz / centre.w;\n"
+    "    eye_radius = sphere.w * scale;\n"
+    "    sphere_color = paletteColor( color, key );\n"
+    "    bool ortho = 0.0 == gl_ProjectionMatrix[2][3];\n"
+    "    vec4 camera = gl_ProjectionMatrixInverse * vec4( 0.0, 0.0, 1.0, 0.0 );\n"
+    "    vec3 view = normalize( ortho ? -camera.xyz : camera.xyz / camera.w - eye_centre );\n"
+    "    vec3 side = normalize( cross( abs( view.y ) < 0.99 ? vec3( 0.0, 1.0, 0.0 ) : vec3( 1.0, 0.0, 0.0 ), view ) );\n"
+    "    eye_position = eye_centre + eye_radius * ( corner.x * side + corner.y * cross( view, side ) + view );\n"
+    "    gl_Position = gl_ProjectionMatrix * vec4( eye_position, 1.0 );\n"
+    "}\n";
+
+const char* sphere_fragment_shader =
+    "in vec3 eye_position;\n"
+    "flat in vec3 eye_centre;\n"
+    "flat in float eye_radius;\n"
+    "flat in vec4 sphere_color;\n"
+    "void main()\n"
+    "{\n"
+    "    vec3 origin, ray;\n"
+    "    viewRay( eye_position, origin, ray );\n"
+    "    vec3 oc = origin - eye_centre;\n"
+    "    float b = dot( ray, oc );\n"
+    "    float disc = b * b - dot( oc, oc ) + eye_radius * eye_radius;\n"
+    "    if ( disc < 0.0 )\n"
+    "        discard;\n"
+    "    vec3 hit = origin + ( -b - sqrt( disc ) ) * ray;\n"
+    "    gl_FragDepth = fragmentDepth( hit );\n"
+    "    gl_FragColor = shade( hit, ( hit - eye_centre ) / eye_radius, sphere_color );\n"
+    "}\n";
+
+// far nodes are point sprites, shaded like a sphere facing the viewer
+const char* sprite_vertex_shader =
+    "uniform float viewport_height;\n"
+    "in vec4 sphere;\n"
+    "in vec4 color;\n"
+    "in vec2 key;\n"
+    "flat out vec3 eye_centre;\n"
+    "flat out float eye_radius;\n"
+    "flat out vec4 sphere_color;\n"
+    "void main()\n"
+    "{\n"
+    "    if ( 1 != chunkState( sphere.xyz ) || !chainVisible( int( key.y ) ) )\n"
+    "    {\n"
+    "        gl_Position = vec4( 0.0, 0.0, 2.0, 1.0 );\n"
+    "        gl_PointSize = 1.0;\n"
+    "        return;\n"
+    "    }\n"
+    "    vec4 centre = gl_ModelViewMatrix * vec4( sphere.xyz, 1.0 );\n"
+    "    float scale = max( length( gl_ModelViewMatrix[0].xyz ), max( length( gl_ModelViewMatrix[1].xyz ), length( gl_ModelViewMatrix[2].xyz ) ) );\n"
+    "    eye_centre = centre.xyz / centre.w;\n"
+    "    eye_radius = sphere.w * scale;\n"
+    "    sphere_color = paletteColor( color, key );\n"
+    "    gl_Position = gl_ProjectionMatrix * vec4( eye_centre, 1.0 );\n"
+    "    gl_PointSize = max( 1.0, viewport_height * gl_ProjectionMatrix[1][1] * eye_radius / gl_Position.w );\n"
+    "}\n";
+
+const char* sprite_fragment_shader =
+    "flat in vec3 eye_centre;\n"
+    "flat in float eye_radius;\n"
+    "flat in vec4 sphere_color;\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 p = 2.0 * gl_PointCoord - 1.0;\n"
+    "    float r2 = dot( p, p );\n"
+    "    if ( r2 > 1.0 )\n"
+    "        discard;\n"
+    "    vec3 normal = vec3( p.x, -p.y, sqrt( 1.0 - r2 ) );\n"
+    "    vec3 hit = eye_centre + eye_radius * normal;\n"
+    "    gl_FragDepth = fragmentDepth( hit );\n"
+    "    gl_FragColor = shade( hit, normal, sphere_color );\n"
+    "}\n";
+
+// a bond instance reads two consecutive polyline vertices, beg.w is zero where no bond starts
+const char* bond_vertex_shader =
+    "uniform float radius;\n"
+    "uniform vec4 typeless_color;\n"
+    "in vec3 corner;\n"
+    "in vec4 beg;\n"
+    "in vec3 end;\n"
+    "in vec4 color;\n"
+    "in vec2 key;\n"
+    "out vec3 eye_position;\n"
+    "flat out vec3 eye_beg;\n"
+    "flat out vec3 eye_end;\n"
+    "flat out float eye_radius;\n"
+    "flat out vec4 bond_color;\n"
+    "void main()\n"
+    "{\n"
+    "    if ( 0.0 == beg.w || 2 != chunkState( 0.5 * ( beg.xyz + end ) ) || !chainVisible( int( key.y ) ) )\n"
+    "    {\n"
+    "        gl_Position = vec4( 0.0, 0.0, 2.0, 1.0 );\n"
+    "        return;\n"
+    "    }\n"
+    "    vec4 b = gl_ModelViewMatrix * vec4( beg.xyz, 1.0 );\n"
+    "    vec4 e = gl_ModelViewMatrix * vec4( end, 1.0 );\n"
+    "    float scale = max( length( gl_ModelViewMatrix[0].xyz ), max( length( gl_ModelViewMatrix[1].xyz ), length( gl_ModelViewMatrix[2].xyz ) ) );\n"
+    "    eye_beg = b.xyz / b.w;\n"
+    "    eye_end = e.xyz / e.w;\n"
+    "    eye_radius = radius * scale;\n"
+    "    bond_color = 2 == color_source ? vec4( typeless_color.rgb, color.a ) : paletteColor( color, key );\n"
+    "    vec3 axis = eye_end - eye_beg;\n"
+    "    float half_length = 0.5 * length( axis );\n"
+    "    axis = 0.0 < half_length ? axis / ( 2.0 * half_length ) : vec3( 0.0, 0.0, 1.0 );\n"
+    "    vec3 side = normalize( cross( axis, abs( axis.y ) < 0.99 ? vec3( 0.0, 1.0, 0.0 ) : vec3( 1.0, 0.0, 0.0 ) ) );\n"
+    "    eye_position = 0.5 * ( eye_beg + eye_end ) + eye_radius * ( corner.x * side + corner.y * cross( axis, side ) )\n"
+    "        + corner.z * ( half_length + eye_radius ) * axis;\n"
+    "    gl_Position = gl_ProjectionMatrix * vec4( eye_position, 1.0 );\n"
+    "}\n";
+
+const char* bond_fragment_shader =
+    "in vec3 eye_position;\n"
+    "flat in vec3 eye_beg;\n"
+    "flat in vec3 eye_end;\n"
+    "flat in float eye_radius;\n"
+    "flat in vec4 bond_color;\n"
+    "void main()\n"
+    "{\n"
+    "    vec3 origin, ray;\n"
+    "    viewRay( eye_position, origin, ray );\n"
+    "    vec3 ba = eye_end - eye_beg;\n"
+    "    vec3 oa = origin - eye_beg;\n"
+    "    float baba = dot( ba, ba );\n"
+    "    float bard = dot( ba, ray );\n"
+    "    float baoa = dot( ba, oa );\n"
+    "    float a = baba - bard * bard;\n"
+    "    float b = baba * dot( ray, oa ) - baoa * bard;\n"
+    "    float c = baba * dot( oa, oa ) - baoa * baoa - eye_radius * eye_radius * baba;\n"
+    "    float h = b * b - a * c;\n"
+    "    if ( h < 0.0 )\n"
+    "        discard;\n"
+    "    float t = 0.0;\n"
+    "    float y = 0.0 < bard ? -1.0 : baba + 1.0;\n"
+    "    if ( a > 1.0e-6 * baba )\n"
+    "    {\n"
+    "        t = ( -b - sqrt( h ) ) / a;\n"
+    "        y = baoa + t * bard;\n"
+    "    }\n"
+    "    if ( y <= 0.0 || y >= baba )\n"
+    "    {\n"
+    "        vec3 oc = y <= 0.0 ? oa : origin - eye_end;\n"
+    "        float bc = dot( ray, oc );\n"
+    "        float hc = bc * bc - dot( oc, oc ) + eye_radius * eye_radius;\n"
+    "        if ( hc < 0.0 )\n"
+    "            discard;\n"
+    "        t = -bc - sqrt( hc );\n"
+    "    }\n"
+    "    vec3 hit = origin + t * ray;\n"
+    "    vec3 pa = hit - eye_beg;\n"
+    "    vec3 normal = ( pa - clamp( dot( pa, ba ) / max( baba, 1.0e-12 ), 0.0, 1.0 ) * ba ) / eye_radius;\n"
+    "    gl_FragDepth = fragmentDepth( hit );\n"
+    "    gl_FragColor = shade( hit, normal, bond_color );\n"
+    "}\n";
+
+QOpenGLShaderProgram* buildImpostorProgram( const char* vertexShader, const char* fragmentShader )
+{
+    QOpenGLShaderProgram* program = new QOpenGLShaderProgram;
+
+    if ( !program->addShaderFromSourceCode( QOpenGLShader::Vertex, QByteArray( instance_functions ) + vertexShader )
+         || !program->addShaderFromSourceCode( QOpenGLShader::Fragment, QByteArray( impostor_functions ) + fragmentShader )
+         || !program->link() )
+    {
+        qDebug() << "GraphPlot: impostors unavailable:" << program->log();
+        delete program;
+        return 0;
+    }
+
+    return program;
+}
+
+// Copy data[from..] into the buffer. The buffer grows with some headroom, so a growing
+// scene usually costs a write of its new tail instead of a reallocation.
+void uploadTail( QOpenGLBuffer& buffer, int& capacity, const std::vector<float>& data, size_t from )
+{
+    int size = int( data.size() * sizeof( float ) );
+
+    buffer.bind();
+
+    if ( size > capacity )
+    {
+        capacity = size + size / 2;
+        buffer.allocate( capacity );
+        from = 0;
+    }
+
+    if ( from < data.size() )
+        buffer.write( int( from * sizeof( float ) ), &data[from], int( ( data.size() - from ) * sizeof( float ) ) );
+
+    buffer.release();
+}
+
+// Upload RGBA texels in rows of PALETTE_WIDTH.
+void uploadTexels( GLuint texture, const std::vector<GLubyte>& texels )
+{
+    glBindTexture( GL_TEXTURE_2D, texture );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, PALETTE_WIDTH, GLsizei( texels.size() / ( 4 * PALETTE_WIDTH ) ), 0,
+                  GL_RGBA, GL_UNSIGNED_BYTE, &texels[0] );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+    glBindTexture( GL_TEXTURE_2D, 0 );
+}
+
+GLuint createTexture()
+{
+    GLuint texture = 0;
+
+    glGenTextures( 1, &texture );
+    glBindTexture( GL_TEXTURE_2D, texture );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glBindTexture( GL_TEXTURE_2D, 0 );
+
+    return texture;
+}
+
+} // ns
+
 // Data class (private)
 
 
 GraphPlot::GraphData::GraphData()
+    : nodes( std::make_shared<RenderNodeVector>() ),
+      bonds( std::make_shared<RenderBondVector>() )
 {
     datatype_p = Qwt3D::GRAPH;
     setHull( ParallelEpiped() );
@@ -20,22 +367,790 @@ GraphPlot::GraphData::GraphData()
 GraphPlot::GraphData::~GraphData()
 {
     setHull( ParallelEpiped() );
-    nodes.clear();
-    bonds.clear();
 }
 
 bool GraphPlot::GraphData::empty() const
 {
-    return nodes.empty();
+    return nodes->empty();
 }
 
 // Data class end
 
 
 GraphPlot::GraphPlot( QWidget* parent, const QOpenGLWidget* shareWidget )
-    : Plot3D( parent, shareWidget )
+    : Plot3D( parent, shareWidget ),
+      impostors_( true ),
+      bond_style_( CYLINDERS ),
+      bond_line_width_( 1.0 ),
+      bond_radius_( 0.0 ),
+      sphere_upload_from_( 0 ),
+      bond_upload_from_( 0 ),
+      sphere_capacity_( 0 ),
+      bond_capacity_( 0 ),
+      sphere_key_capacity_( 0 ),
+      bond_key_capacity_( 0 ),
+      sphere_keys_changed_( false ),
+      color_source_( OWNCOLORS ),
+      typeless_color_( 0.5, 0.5, 0.5 ),
+      palette_changed_( false ),
+      palette_texture_( 0 ),
+      chunks_changed_( false ),
+      full_chunks_( true ),
+      sprite_chunks_( false ),
+      sprite_size_( 3.0 ),
+      node_reach_( 0.0 ),
+      bond_reach_( 0.0 ),
+      clipped_( false ),
+      chunk_texture_( 0 ),
+      sphere_program_( 0 ),
+      sprite_program_( 0 ),
+      bond_program_( 0 ),
+      corner_buffer_( QOpenGLBuffer::VertexBuffer ),
+      box_buffer_( QOpenGLBuffer::VertexBuffer ),
+      sphere_buffer_( QOpenGLBuffer::VertexBuffer ),
+      bond_buffer_( QOpenGLBuffer::VertexBuffer ),
+      sphere_key_buffer_( QOpenGLBuffer::VertexBuffer ),
+      bond_key_buffer_( QOpenGLBuffer::VertexBuffer )
 {
     plotlets_p[0].data = ValuePtr<Data>( new GraphData );
+    chunk_counts_[0] = chunk_counts_[1] = chunk_counts_[2] = 1;
+}
+
+GraphPlot::~GraphPlot()
+{
+    makeCurrent();
+    delete sphere_program_;
+    delete sprite_program_;
+    delete bond_program_;
+    corner_buffer_.destroy();
+    box_buffer_.destroy();
+    sphere_buffer_.destroy();
+    bond_buffer_.destroy();
+    sphere_key_buffer_.destroy();
+    bond_key_buffer_.destroy();
+
+    if ( palette_texture_ )
+        glDeleteTextures( 1, &palette_texture_ );
+
+    if ( chunk_texture_ )
+        glDeleteTextures( 1, &chunk_texture_ );
+}
+
+void GraphPlot::initializeGL()
+{
+    // the shaders have to exist before Plot3D compiles the first display list
+    initializeImpostors();
+    Plot3D::initializeGL();
+}
+
+/*!
+  Compile the sphere and bond impostor shaders. Instanced arrays need OpenGL 3.3 (or ARB_instanced_arrays),
+  the shaders read the fixed function state, so a core profile context falls back as well.
+  \return true, if the impostor path can be used
+*/
+bool GraphPlot::initializeImpostors()
+{
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+
+    if ( !ctx || ctx->isOpenGLES() || QSurfaceFormat::CoreProfile == ctx->format().profile() )
+        return false;
+
+    if ( ctx->format().version() < qMakePair( 3, 3 ) && !ctx->hasExtension( "GL_ARB_instanced_arrays" ) )
+        return false;
+
+    QOpenGLShaderProgram* spheres = buildImpostorProgram( sphere_vertex_shader, sphere_fragment_shader );
+    QOpenGLShaderProgram* bonds = spheres ? buildImpostorProgram( bond_vertex_shader, bond_fragment_shader ) : 0;
+
+    if ( !bonds )
+    {
+        delete spheres;
+        return false;
+    }
+
+    // one quad per node and one box per bond, drawn once per instance
+    static const GLfloat corners[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    static const GLfloat box[] = { -1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f,
+                                   1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f,
+                                   -1.0f, 1.0f, -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, -1.0f,
+                                   -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f };
+
+    corner_buffer_.create();
+    corner_buffer_.bind();
+    corner_buffer_.allocate( corners, sizeof( corners ) );
+    corner_buffer_.release();
+
+    box_buffer_.create();
+    box_buffer_.bind();
+    box_buffer_.allocate( box, sizeof( box ) );
+    box_buffer_.release();
+
+    sphere_buffer_.create();
+    sphere_buffer_.setUsagePattern( QOpenGLBuffer::DynamicDraw );
+    bond_buffer_.create();
+    bond_buffer_.setUsagePattern( QOpenGLBuffer::DynamicDraw );
+    sphere_key_buffer_.create();
+    sphere_key_buffer_.setUsagePattern( QOpenGLBuffer::DynamicDraw );
+    bond_key_buffer_.create();
+    bond_key_buffer_.setUsagePattern( QOpenGLBuffer::DynamicDraw );
+
+    palette_texture_ = createTexture();
+    palette_changed_ = true;
+    chunk_texture_ = createTexture();
+    chunks_changed_ = true;
+
+    // without point sprites every visible chunk is drawn with impostors
+    sprite_program_ = buildImpostorProgram( sprite_vertex_shader, sprite_fragment_shader );
+    sphere_program_ = spheres;
+    bond_program_ = bonds;
+    return true;
+}
+
+/*!
+  Switch between sphere impostors and tessellated spheres. Without shader support
+  the tessellated spheres are drawn regardless.
+*/
+void GraphPlot::setImpostors( bool val )
+{
+    if ( val == impostors_ )
+        return;
+
+    impostors_ = val;
+    updateData();
+}
+
+/*!
+  Set the bond style. CYLINDERS falls back to STICKS without shader support.
+*/
+void GraphPlot::setBondStyle( BONDSTYLE val )
+{
+    if ( val == bond_style_ )
+        return;
+
+    bond_style_ = val;
+    updateData();
+}
+
+/*!
+  Set the width of bonds drawn as LINES, in pixels.
+*/
+void GraphPlot::setBondLineWidth( double val )
+{
+    if ( val == bond_line_width_ )
+        return;
+
+    bond_line_width_ = val;
+
+    if ( LINES == bond_style_ )
+        updateData();
+}
+
+double GraphPlot::bondRadius() const
+{
+    return ( hull().maxVertex - hull().minVertex ).length() / 750;
+}
+
+/*!
+  Select where the impostors take their colors from. The palettes are looked up in the vertex
+  shaders by the type and chain id of every node and bond, so switching costs no data update.
+  Nodes with an id outside the palette, and the fallback styles, keep their own colors.
+*/
+void GraphPlot::setColorSource( COLORSOURCE val )
+{
+    color_source_ = val;
+}
+
+/*!
+  Set the CHAINCOLORS palette, entry i for the nodes and bonds with index i.
+*/
+void GraphPlot::setChainPalette( std::vector<RGBA> const& colors )
+{
+    chain_palette_ = colors;
+    palette_changed_ = true;
+}
+
+/*!
+  Set the TYPECOLORS palette, entry i for the nodes with monomer_type i. Bonds have no type,
+  they are drawn in \c bondColor.
+*/
+void GraphPlot::setTypePalette( std::vector<RGBA> const& colors, RGBA const& bondColor )
+{
+    type_palette_ = colors;
+    typeless_color_ = bondColor;
+    palette_changed_ = true;
+}
+
+/*!
+  Hide the impostors of every chain i with visible[i] false, chains beyond the vector stay visible.
+*/
+void GraphPlot::setChainVisibility( std::vector<bool> const& visible )
+{
+    if ( visible == chain_visibility_ )
+        return;
+
+    chain_visibility_ = visible;
+    palette_changed_ = true;
+}
+
+/*!
+  Set the edge lengths of the chunks the impostors are culled by, typically a multiple of the cell
+  size of the data. Zero components divide the hull into 16 chunks along that axis. No more than
+  64 chunks are made per axis.
+*/
+void GraphPlot::setChunkSize( Triple const& size )
+{
+    chunk_size_ = size;
+    layoutChunks();
+}
+
+/*!
+  Draw the nodes of chunks, whose nodes appear smaller than \c pixels on screen, as point sprites,
+  and skip their bonds. 0 draws every chunk with impostors.
+*/
+void GraphPlot::setSpriteSize( double pixels )
+{
+    sprite_size_ = pixels;
+}
+
+/*!
+  Show only the nodes and bonds centred inside \c box, giving slabs along x, y and z.
+  Impostors are clipped as a whole, the tessellated styles are cut at the box faces.
+*/
+void GraphPlot::setClipBox( ParallelEpiped const& box )
+{
+    clip_box_ = box;
+    clipped_ = true;
+}
+
+void GraphPlot::clearClipBox()
+{
+    clipped_ = false;
+}
+
+void GraphPlot::createOpenGlData()
+{
+    sphere_instances_.clear();
+    bond_vertices_.clear();
+    bond_runs_.clear();
+    sphere_keys_.clear();
+    bond_keys_.clear();
+    node_marks_.clear();
+    bond_marks_.clear();
+    sphere_upload_from_ = 0;
+    bond_upload_from_ = 0;
+
+    // the stick radius, used for the impostors as well
+    bond_radius_ = bondRadius();
+    node_reach_ = 0.0;
+    bond_reach_ = 0.0;
+    layoutChunks();
+
+    Plot3D::createOpenGlData();
+}
+
+void GraphPlot::drawOpenGlData()
+{
+    // the tessellated styles are cut at the faces of the clip box
+    if ( clipped_ )
+    {
+        const Triple& lo = clip_box_.minVertex;
+        const Triple& hi = clip_box_.maxVertex;
+        const GLdouble planes[6][4] = { { 1.0, 0.0, 0.0, -lo.x }, { -1.0, 0.0, 0.0, hi.x },
+                                        { 0.0, 1.0, 0.0, -lo.y }, { 0.0, -1.0, 0.0, hi.y },
+                                        { 0.0, 0.0, 1.0, -lo.z }, { 0.0, 0.0, -1.0, hi.z } };
+
+        for ( int i = 0; i != 6; ++i )
+        {
+            glClipPlane( GL_CLIP_PLANE0 + i, planes[i] );
+            glEnable( GL_CLIP_PLANE0 + i );
+        }
+    }
+
+    Plot3D::drawOpenGlData();
+
+    if ( clipped_ )
+    {
+        for ( int i = 0; i != 6; ++i )
+            glDisable( GL_CLIP_PLANE0 + i );
+    }
+
+    if ( !sphere_program_ )
+        return;
+
+    // two key floats per eight instance floats
+    if ( sphere_keys_changed_ )
+        uploadTail( sphere_key_buffer_, sphere_key_capacity_, sphere_keys_, 0 );
+    else if ( sphere_upload_from_ < sphere_instances_.size() )
+        uploadTail( sphere_key_buffer_, sphere_key_capacity_, sphere_keys_, sphere_upload_from_ / 4 );
+
+    if ( sphere_upload_from_ < sphere_instances_.size() )
+        uploadTail( sphere_buffer_, sphere_capacity_, sphere_instances_, sphere_upload_from_ );
+
+    if ( bond_upload_from_ < bond_vertices_.size() )
+    {
+        uploadTail( bond_buffer_, bond_capacity_, bond_vertices_, bond_upload_from_ );
+        uploadTail( bond_key_buffer_, bond_key_capacity_, bond_keys_, bond_upload_from_ / 4 );
+    }
+
+    sphere_upload_from_ = sphere_instances_.size();
+    bond_upload_from_ = bond_vertices_.size();
+    sphere_keys_changed_ = false;
+
+    if ( palette_changed_ )
+        uploadPalette();
+
+    updateChunks();
+
+    GLStateBewarer dt( GL_DEPTH_TEST, true );
+    GLStateBewarer lt( GL_LIGHTING, false );
+
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+    f->glActiveTexture( GL_TEXTURE1 );
+    glBindTexture( GL_TEXTURE_2D, chunk_texture_ );
+    f->glActiveTexture( GL_TEXTURE0 );
+    glBindTexture( GL_TEXTURE_2D, palette_texture_ );
+
+    if ( CYLINDERS == bond_style_ && full_chunks_ )
+        drawBondImpostors();
+
+    if ( impostors_ && full_chunks_ )
+        drawSphereImpostors();
+
+    if ( impostors_ && sprite_chunks_ )
+        drawSphereSprites();
+
+    f->glActiveTexture( GL_TEXTURE1 );
+    glBindTexture( GL_TEXTURE_2D, 0 );
+    f->glActiveTexture( GL_TEXTURE0 );
+    glBindTexture( GL_TEXTURE_2D, 0 );
+}
+
+/*!
+  Lay the chunk grid over the hull.
+*/
+void GraphPlot::layoutChunks()
+{
+    Triple extent = hull().maxVertex - hull().minVertex;
+    const double size[3] = { chunk_size_.x, chunk_size_.y, chunk_size_.z };
+    const double length[3] = { extent.x, extent.y, extent.z };
+    double width[3];
+
+    for ( int a = 0; a != 3; ++a )
+    {
+        width[a] = ( 0.0 < size[a] ) ? size[a] : length[a] / CHUNKS_PER_AXIS;
+        chunk_counts_[a] = ( 0.0 < width[a] ) ? std::max( 1, int( ceil( length[a] / width[a] ) ) ) : 1;
+
+        if ( chunk_counts_[a] > MAX_CHUNKS_PER_AXIS )
+        {
+            width[a] = length[a] / MAX_CHUNKS_PER_AXIS;
+            chunk_counts_[a] = MAX_CHUNKS_PER_AXIS;
+        }
+
+        if ( 0.0 >= width[a] )
+            width[a] = 1.0;
+    }
+
+    chunk_origin_ = hull().minVertex;
+    chunk_width_ = Triple( width[0], width[1], width[2] );
+    chunks_changed_ = true;
+}
+
+/*!
+  Classify the chunks for the current view. Chunks outside the clip box or the view frustum are
+  hidden, chunks whose nodes would be drawn smaller than spriteSize() pixels become point sprites.
+  The chunk bounds grow by the largest node radius and bond length, as nodes and bonds belong
+  to a chunk by their centre only.
+*/
+void GraphPlot::updateChunks()
+{
+    GLdouble mv[16], pr[16];
+    GLint viewport[4];
+
+    glGetDoublev( GL_MODELVIEW_MATRIX, mv );
+    glGetDoublev( GL_PROJECTION_MATRIX, pr );
+    glGetIntegerv( GL_VIEWPORT, viewport );
+
+    // rows of projection * modelview, the frustum planes are their sums and differences
+    double rows[4][4];
+
+    for ( int r = 0; r != 4; ++r )
+    {
+        for ( int c = 0; c != 4; ++c )
+            rows[r][c] = pr[r] * mv[4 * c] + pr[4 + r] * mv[4 * c + 1] + pr[8 + r] * mv[4 * c + 2] + pr[12 + r] * mv[4 * c + 3];
+    }
+
+    double planes[6][4];
+
+    for ( int i = 0; i != 3; ++i )
+    {
+        for ( int c = 0; c != 4; ++c )
+        {
+            planes[2 * i][c] = rows[3][c] + rows[i][c];
+            planes[2 * i + 1][c] = rows[3][c] - rows[i][c];
+        }
+    }
+
+    // pixels per unit of node radius at w = 1, w being the distance along the view axis
+    double scale = std::max( Triple( mv[0], mv[1], mv[2] ).length(), std::max( Triple( mv[4], mv[5], mv[6] ).length(), Triple( mv[8], mv[9], mv[10] ).length() ) );
+    double pixels = 0.5 * viewport[3] * pr[5] * scale * node_reach_;
+    double margin = std::max( node_reach_, bond_reach_ );
+    bool sprites = sprite_program_ && 0.0 < sprite_size_;
+    int count = chunk_counts_[0] * chunk_counts_[1] * chunk_counts_[2];
+    std::vector<GLubyte> states( 4 * PALETTE_WIDTH * ( ( count + PALETTE_WIDTH - 1 ) / PALETTE_WIDTH ), CHUNK_HIDDEN );
+
+    full_chunks_ = false;
+    sprite_chunks_ = false;
+
+    for ( int index = 0; index != count; ++index )
+    {
+        int ix = index % chunk_counts_[0];
+        int iy = ( index / chunk_counts_[0] ) % chunk_counts_[1];
+        int iz = index / ( chunk_counts_[0] * chunk_counts_[1] );
+        Triple lo = chunk_origin_ + Triple( ix * chunk_width_.x, iy * chunk_width_.y, iz * chunk_width_.z );
+        Triple hi = lo + chunk_width_;
+        GLubyte state = CHUNK_FULL;
+
+        if ( clipped_ && ( hi.x < clip_box_.minVertex.x || lo.x > clip_box_.maxVertex.x || hi.y < clip_box_.minVertex.y
+                           || lo.y > clip_box_.maxVertex.y || hi.z < clip_box_.minVertex.z || lo.z > clip_box_.maxVertex.z ) )
+        {
+            state = CHUNK_HIDDEN;
+        }
+
+        lo = lo - Triple( margin, margin, margin );
+        hi = hi + Triple( margin, margin, margin );
+
+        // outside, if the corner farthest along the plane normal is outside
+        for ( int i = 0; i != 6 && CHUNK_FULL == state; ++i )
+        {
+            const double* n = planes[i];
+
+            if ( n[0] * ( 0.0 < n[0] ? hi.x : lo.x ) + n[1] * ( 0.0 < n[1] ? hi.y : lo.y ) + n[2] * ( 0.0 < n[2] ? hi.z : lo.z ) + n[3] < 0.0 )
+                state = CHUNK_HIDDEN;
+        }
+
+        if ( CHUNK_FULL == state && sprites )
+        {
+            const double* n = rows[3];
+            double w = n[0] * ( 0.0 < n[0] ? lo.x : hi.x ) + n[1] * ( 0.0 < n[1] ? lo.y : hi.y ) + n[2] * ( 0.0 < n[2] ? lo.z : hi.z ) + n[3];
+
+            if ( 0.0 < w && pixels < sprite_size_ * w )
+                state = CHUNK_SPRITES;
+        }
+
+        states[4 * index] = state;
+        full_chunks_ = full_chunks_ || CHUNK_FULL == state;
+        sprite_chunks_ = sprite_chunks_ || CHUNK_SPRITES == state;
+    }
+
+    if ( chunks_changed_ || states != chunk_states_ )
+    {
+        chunk_states_.swap( states );
+        uploadTexels( chunk_texture_, chunk_states_ );
+        chunks_changed_ = false;
+    }
+}
+
+/*!
+  Upload the type palette, the chain palette and the chain visibility into the palette texture,
+  each table starting at a new row.
+*/
+void GraphPlot::uploadPalette()
+{
+    int type_rows = int( ( type_palette_.size() + PALETTE_WIDTH - 1 ) / PALETTE_WIDTH );
+    int chain_rows = int( ( chain_palette_.size() + PALETTE_WIDTH - 1 ) / PALETTE_WIDTH );
+    int visibility_rows = int( ( chain_visibility_.size() + PALETTE_WIDTH - 1 ) / PALETTE_WIDTH );
+
+    int rows = std::max( 1, type_rows + chain_rows + visibility_rows );
+    std::vector<GLubyte> texels( 4 * PALETTE_WIDTH * rows, 0 );
+
+    for ( size_t i = 0; i != type_palette_.size(); ++i )
+    {
+        const RGBA& c = type_palette_[i];
+        GLubyte* t = &texels[4 * i];
+        t[0] = GLubyte( 255 * std::min( std::max( c.r, 0.0 ), 1.0 ) );
+        t[1] = GLubyte( 255 * std::min( std::max( c.g, 0.0 ), 1.0 ) );
+        t[2] = GLubyte( 255 * std::min( std::max( c.b, 0.0 ), 1.0 ) );
+    }
+
+    for ( size_t i = 0; i != chain_palette_.size(); ++i )
+    {
+        const RGBA& c = chain_palette_[i];
+        GLubyte* t = &texels[4 * ( PALETTE_WIDTH * type_rows + i )];
+        t[0] = GLubyte( 255 * std::min( std::max( c.r, 0.0 ), 1.0 ) );
+        t[1] = GLubyte( 255 * std::min( std::max( c.g, 0.0 ), 1.0 ) );
+        t[2] = GLubyte( 255 * std::min( std::max( c.b, 0.0 ), 1.0 ) );
+    }
+
+    for ( size_t i = 0; i != chain_visibility_.size(); ++i )
+        texels[4 * ( PALETTE_WIDTH * ( type_rows + chain_rows ) + i )] = chain_visibility_[i] ? 255 : 0;
+
+    uploadTexels( palette_texture_, texels );
+    palette_changed_ = false;
+}
+
+void GraphPlot::setInstanceUniforms( QOpenGLShaderProgram* program )
+{
+    int type_rows = int( ( type_palette_.size() + PALETTE_WIDTH - 1 ) / PALETTE_WIDTH );
+    int chain_rows = int( ( chain_palette_.size() + PALETTE_WIDTH - 1 ) / PALETTE_WIDTH );
+
+    program->setUniformValue( "palette", 0 );
+    program->setUniformValue( "color_source", int( color_source_ ) );
+    program->setUniformValue( "type_row", 0 );
+    program->setUniformValue( "type_count", int( type_palette_.size() ) );
+    program->setUniformValue( "chain_row", type_rows );
+    program->setUniformValue( "chain_count", int( chain_palette_.size() ) );
+    program->setUniformValue( "visibility_row", type_rows + chain_rows );
+    program->setUniformValue( "visibility_count", int( chain_visibility_.size() ) );
+
+    const Triple huge( 1.0e30, 1.0e30, 1.0e30 );
+    const Triple clip_min = clipped_ ? clip_box_.minVertex : -1.0 * huge;
+    const Triple clip_max = clipped_ ? clip_box_.maxVertex : huge;
+
+    program->setUniformValue( "chunks", 1 );
+    program->setUniformValue( "chunk_origin", GLfloat( chunk_origin_.x ), GLfloat( chunk_origin_.y ), GLfloat( chunk_origin_.z ) );
+    program->setUniformValue( "chunk_width", GLfloat( chunk_width_.x ), GLfloat( chunk_width_.y ), GLfloat( chunk_width_.z ) );
+    program->setUniformValue( "chunk_counts", GLfloat( chunk_counts_[0] ), GLfloat( chunk_counts_[1] ), GLfloat( chunk_counts_[2] ) );
+    program->setUniformValue( "clip_min", GLfloat( clip_min.x ), GLfloat( clip_min.y ), GLfloat( clip_min.z ) );
+    program->setUniformValue( "clip_max", GLfloat( clip_max.x ), GLfloat( clip_max.y ), GLfloat( clip_max.z ) );
+}
+
+/*!
+  Draw all sphere impostors with a single instanced call. The instance buffer is uploaded
+  only after createOpenGlData() or updateDataTail() has changed it.
+*/
+void GraphPlot::drawSphereImpostors()
+{
+    GLsizei count = GLsizei( sphere_instances_.size() / 8 );
+
+    if ( 0 == count )
+        return;
+
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+    sphere_program_->bind();
+    sphere_program_->setUniformValue( "lighting", lightingEnabled() );
+    setInstanceUniforms( sphere_program_ );
+
+    int corner = sphere_program_->attributeLocation( "corner" );
+    int sphere = sphere_program_->attributeLocation( "sphere" );
+    int color = sphere_program_->attributeLocation( "color" );
+    int key = sphere_program_->attributeLocation( "key" );
+
+    corner_buffer_.bind();
+    sphere_program_->enableAttributeArray( corner );
+    sphere_program_->setAttributeBuffer( corner, GL_FLOAT, 0, 2 );
+
+    sphere_buffer_.bind();
+    sphere_program_->enableAttributeArray( sphere );
+    sphere_program_->setAttributeBuffer( sphere, GL_FLOAT, 0, 4, 8 * sizeof( float ) );
+    sphere_program_->enableAttributeArray( color );
+    sphere_program_->setAttributeBuffer( color, GL_FLOAT, 4 * sizeof( float ), 4, 8 * sizeof( float ) );
+    sphere_key_buffer_.bind();
+    sphere_program_->enableAttributeArray( key );
+    sphere_program_->setAttributeBuffer( key, GL_FLOAT, 0, 2 );
+    f->glVertexAttribDivisor( sphere, 1 );
+    f->glVertexAttribDivisor( color, 1 );
+    f->glVertexAttribDivisor( key, 1 );
+
+    f->glDrawArraysInstanced( GL_TRIANGLE_STRIP, 0, 4, count );
+
+    // leave the attribute state as the fixed function code expects it
+    f->glVertexAttribDivisor( sphere, 0 );
+    f->glVertexAttribDivisor( color, 0 );
+    f->glVertexAttribDivisor( key, 0 );
+    sphere_program_->disableAttributeArray( corner );
+    sphere_program_->disableAttributeArray( sphere );
+    sphere_program_->disableAttributeArray( color );
+    sphere_program_->disableAttributeArray( key );
+    sphere_key_buffer_.release();
+    sphere_program_->release();
+}
+
+/*!
+  Draw the nodes of the sprite chunks as point sprites, one point per instance.
+*/
+void GraphPlot::drawSphereSprites()
+{
+    GLsizei count = GLsizei( sphere_instances_.size() / 8 );
+
+    if ( 0 == count )
+        return;
+
+    GLint viewport[4];
+    glGetIntegerv( GL_VIEWPORT, viewport );
+
+    GLStateBewarer ps( GL_PROGRAM_POINT_SIZE, true );
+    GLStateBewarer sp( GL_POINT_SPRITE, true );
+
+    sprite_program_->bind();
+    sprite_program_->setUniformValue( "lighting", lightingEnabled() );
+    sprite_program_->setUniformValue( "viewport_height", GLfloat( viewport[3] ) );
+    setInstanceUniforms( sprite_program_ );
+
+    int sphere = sprite_program_->attributeLocation( "sphere" );
+    int color = sprite_program_->attributeLocation( "color" );
+    int key = sprite_program_->attributeLocation( "key" );
+
+    sphere_buffer_.bind();
+    sprite_program_->enableAttributeArray( sphere );
+    sprite_program_->setAttributeBuffer( sphere, GL_FLOAT, 0, 4, 8 * sizeof( float ) );
+    sprite_program_->enableAttributeArray( color );
+    sprite_program_->setAttributeBuffer( color, GL_FLOAT, 4 * sizeof( float ), 4, 8 * sizeof( float ) );
+    sphere_key_buffer_.bind();
+    sprite_program_->enableAttributeArray( key );
+    sprite_program_->setAttributeBuffer( key, GL_FLOAT, 0, 2 );
+
+    glDrawArrays( GL_POINTS, 0, count );
+
+    sprite_program_->disableAttributeArray( sphere );
+    sprite_program_->disableAttributeArray( color );
+    sprite_program_->disableAttributeArray( key );
+    sphere_key_buffer_.release();
+    sprite_program_->release();
+}
+
+/*!
+  Draw all bonds as capsule impostors with a single instanced call. Instance i joins
+  polyline vertices i and i+1, instances across a run boundary are culled in the vertex shader.
+*/
+void GraphPlot::drawBondImpostors()
+{
+    GLsizei count = GLsizei( bond_vertices_.size() / 8 ) - 1;
+
+    if ( 0 >= count )
+        return;
+
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+    bond_program_->bind();
+    bond_program_->setUniformValue( "lighting", lightingEnabled() );
+    bond_program_->setUniformValue( "radius", GLfloat( bond_radius_ ) );
+    bond_program_->setUniformValue( "typeless_color", GLfloat( typeless_color_.r ), GLfloat( typeless_color_.g ),
+                                    GLfloat( typeless_color_.b ), GLfloat( typeless_color_.a ) );
+    setInstanceUniforms( bond_program_ );
+
+    int corner = bond_program_->attributeLocation( "corner" );
+    int beg = bond_program_->attributeLocation( "beg" );
+    int end = bond_program_->attributeLocation( "end" );
+    int color = bond_program_->attributeLocation( "color" );
+    int key = bond_program_->attributeLocation( "key" );
+
+    box_buffer_.bind();
+    bond_program_->enableAttributeArray( corner );
+    bond_program_->setAttributeBuffer( corner, GL_FLOAT, 0, 3 );
+
+    bond_buffer_.bind();
+    bond_program_->enableAttributeArray( beg );
+    bond_program_->setAttributeBuffer( beg, GL_FLOAT, 0, 4, 8 * sizeof( float ) );
+    bond_program_->enableAttributeArray( end );
+    bond_program_->setAttributeBuffer( end, GL_FLOAT, 8 * sizeof( float ), 3, 8 * sizeof( float ) );
+    bond_program_->enableAttributeArray( color );
+    bond_program_->setAttributeBuffer( color, GL_FLOAT, 4 * sizeof( float ), 4, 8 * sizeof( float ) );
+    bond_key_buffer_.bind();
+    bond_program_->enableAttributeArray( key );
+    bond_program_->setAttributeBuffer( key, GL_FLOAT, 0, 2 );
+    f->glVertexAttribDivisor( beg, 1 );
+    f->glVertexAttribDivisor( end, 1 );
+    f->glVertexAttribDivisor( color, 1 );
+    f->glVertexAttribDivisor( key, 1 );
+
+    f->glDrawArraysInstanced( GL_TRIANGLE_STRIP, 0, 14, count );
+
+    f->glVertexAttribDivisor( beg, 0 );
+    f->glVertexAttribDivisor( end, 0 );
+    f->glVertexAttribDivisor( color, 0 );
+    f->glVertexAttribDivisor( key, 0 );
+    bond_program_->disableAttributeArray( corner );
+    bond_program_->disableAttributeArray( beg );
+    bond_program_->disableAttributeArray( end );
+    bond_program_->disableAttributeArray( color );
+    bond_program_->disableAttributeArray( key );
+    bond_key_buffer_.release();
+    bond_program_->release();
+}
+
+/*!
+  Append the bonds of one plotlet to the polyline buffer. A bond starting where the previous
+  one ended extends the current run, anything else - a new chain, or a bond split at a periodic
+  boundary - starts a new one. Every vertex holds x, y, z, a bond flag and the bond color,
+  its key the bond index. Bonds before \c first are already in the buffer.
+*/
+void GraphPlot::appendBondPolylines( const RenderBondVector& bonds, unsigned first /*= 0*/ )
+{
+    for ( unsigned i = first; i < bonds.size(); ++i )
+    {
+        const RenderBond& bd = bonds[i];
+
+        bond_marks_.push_back( QPair<int, int>( int( bond_vertices_.size() ), int( bond_runs_.size() ) ) );
+
+        if ( !bd.visible() )
+            continue;
+
+        bond_reach_ = std::max( bond_reach_, ( bd.end() - bd.begin() ).length() + bond_radius_ );
+
+        const RGBA col = bd.color();
+        size_t last = bond_vertices_.size();
+        bool extend = !bond_runs_.empty() && bond_runs_.back().first + bond_runs_.back().second == int( last / 8 )
+                      && last >= 8 && std::equal( bd.first, bd.first + 3, &bond_vertices_[last - 8] );
+
+        if ( extend )
+        {
+            bond_vertices_[last - 5] = 1.0f;
+            bond_vertices_[last - 4] = float( col.r );
+            bond_vertices_[last - 3] = float( col.g );
+            bond_vertices_[last - 2] = float( col.b );
+            bond_vertices_[last - 1] = float( col.a );
+            bond_keys_[last / 4 - 1] = float( bd.index );
+            bond_runs_.back().second++;
+        }
+        else
+        {
+            const float vertex[8] = { bd.first[0], bd.first[1], bd.first[2], 1.0f,
+                                      float( col.r ), float( col.g ), float( col.b ), float( col.a ) };
+            bond_vertices_.insert( bond_vertices_.end(), vertex, vertex + 8 );
+            bond_keys_.push_back( -1.0f );
+            bond_keys_.push_back( float( bd.index ) );
+            bond_runs_.push_back( QPair<int, int>( int( last / 8 ), 2 ) );
+        }
+
+        const float vertex[8] = { bd.second[0], bd.second[1], bd.second[2], 0.0f,
+                                  float( col.r ), float( col.g ), float( col.b ), float( col.a ) };
+        bond_vertices_.insert( bond_vertices_.end(), vertex, vertex + 8 );
+        bond_keys_.push_back( -1.0f );
+        bond_keys_.push_back( float( bd.index ) );
+    }
+}
+
+/*!
+  Append the visible nodes from \c first on to the sphere instance buffer, their monomer
+  type and index to the keys.
+*/
+void GraphPlot::appendSphereInstances( const RenderNodeVector& nodes, unsigned first /*= 0*/ )
+{
+    // a tail update appends a few nodes, reserving for them would reallocate every time
+    if ( 0 == first )
+    {
+        sphere_instances_.reserve( sphere_instances_.size() + 8 * nodes.size() );
+        sphere_keys_.reserve( sphere_keys_.size() + 2 * nodes.size() );
+    }
+
+    for ( unsigned j = first; j < nodes.size(); ++j )
+    {
+        const RenderNode& a = nodes[j];
+
+        node_marks_.push_back( int( sphere_instances_.size() ) );
+
+        if ( a.visible() )
+        {
+            const RGBA col = a.color();
+            const float instance[8] = { a.pos[0], a.pos[1], a.pos[2], a.radius,
+                                        float( col.r ), float( col.g ), float( col.b ), float( col.a ) };
+            sphere_instances_.insert( sphere_instances_.end(), instance, instance + 8 );
+            sphere_keys_.push_back( float( a.monomer_type ) );
+            sphere_keys_.push_back( float( a.index ) );
+            node_reach_ = std::max( node_reach_, double( a.radius ) );
+        }
+    }
 }
 
 void GraphPlot::createOpenGlData( const Plotlet& pl )
@@ -44,37 +1159,72 @@ void GraphPlot::createOpenGlData( const Plotlet& pl )
         return;
 
     const GraphData& data = dynamic_cast<const GraphData&>( *pl.data );
+    const RenderNodeVector& nodes = *data.nodes;
+    const RenderBondVector& bonds = *data.bonds;
 
     //   glEnable( GL_POLYGON_SMOOTH );
     //   glEnable( GL_LINE_SMOOTH );
 
-    Stick s( ( hull().maxVertex - hull().minVertex ).length() / 750, 16 );
+    BONDSTYLE bond_style = ( CYLINDERS == bond_style_ && !bond_program_ ) ? STICKS : bond_style_;
 
-    for ( unsigned i = 0; i != data.bonds.size(); ++i )
+    if ( STICKS != bond_style )
     {
-        const Triple& beg = data.bonds[i].first;
-        const Triple& end = data.bonds[i].second;
-        s.setColor( data.bonds[i].col );
+        size_t first_run = bond_runs_.size();
 
-        if ( 0.0 < data.bonds[i].col.a )
+        appendBondPolylines( bonds );
+
+        // line strips go into the display list, the client arrays are copied when it is compiled
+        if ( LINES == bond_style && first_run < bond_runs_.size() )
         {
-            s.draw( beg, end );
+            GLStateBewarer lt( GL_LIGHTING, false );
+            glLineWidth( bond_line_width_ );
+
+            glEnableClientState( GL_VERTEX_ARRAY );
+            glEnableClientState( GL_COLOR_ARRAY );
+            glVertexPointer( 3, GL_FLOAT, 8 * sizeof( float ), &bond_vertices_[0] );
+            glColorPointer( 4, GL_FLOAT, 8 * sizeof( float ), &bond_vertices_[4] );
+
+            for ( size_t r = first_run; r != bond_runs_.size(); ++r )
+                glDrawArrays( GL_LINE_STRIP, bond_runs_[r].first, bond_runs_[r].second );
+
+            glDisableClientState( GL_VERTEX_ARRAY );
+            glDisableClientState( GL_COLOR_ARRAY );
         }
     }
+    else
+    {
+        Stick s( bond_radius_, 16 );
+
+        for ( unsigned i = 0; i != bonds.size(); ++i )
+        {
+            s.setColor( bonds[i].color() );
 
+            if ( bonds[i].visible() )
+            {
+                s.draw( bonds[i].begin(), bonds[i].end() );
+            }
+        }
+    }
+
+    if ( impostors_ && sphere_program_ )
+    {
+        // nodes go to the instance buffer, drawOpenGlData() renders them outside the display list
+        appendSphereInstances( nodes );
+        return;
+    }
 
     Ball b( ( hull().maxVertex - hull().minVertex ).length() / 250, 8 );
 
     b.setColor( RGBA( 0.5, 0, 0 ) );
 
-    for ( unsigned j = 0; j != data.nodes.size(); ++j )
+    for ( unsigned j = 0; j != nodes.size(); ++j )
     {
-        b.setRadius( data.nodes[j].radius );
-        b.setColor( data.nodes[j].col );
+        b.setRadius( nodes[j].radius );
+        b.setColor( nodes[j].color() );
 
-        if ( 0.0 < data.nodes[j].col.a )
+        if ( nodes[j].visible() )
         {
-            b.draw( data.nodes[j].pos );
+            b.draw( nodes[j].position() );
         }
     }
 }
@@ -84,12 +1234,43 @@ void GraphPlot::createOpenGlData( const Plotlet& pl )
 Convert user defined graph data to internal structure.
 See also Qwt3D::TripleVector and Qwt3D::EdgeVector
 
+The nodes and bonds are copied into the compact Qwt3D::RenderNode and Qwt3D::RenderBond format,
+positions and radii in single precision and colors in 8 bits per channel. Large graphs should
+share the compact format directly, see below.
+
 \param append For append==true the new dataset will be appended. If false (default), all data  will
 be replaced by the new data. This includes destruction of possible additional datasets/Plotlets.
 \return Index of new entry in dataset array (append == true), 0 (append == false) or -1 for errors
 */
 int GraphPlot::createDataset( AtomVector const& nodes, BondVector const& bonds, bool append /*= false*/ )
 {
+    std::shared_ptr<RenderNodeVector> render_nodes = std::make_shared<RenderNodeVector>();
+    std::shared_ptr<RenderBondVector> render_bonds = std::make_shared<RenderBondVector>();
+
+    render_nodes->reserve( nodes.size() );
+    render_bonds->reserve( bonds.size() );
+
+    for ( unsigned j = 0; j != nodes.size(); ++j )
+        render_nodes->push_back( RenderNode( nodes[j] ) );
+    for ( unsigned i = 0; i != bonds.size(); ++i )
+        render_bonds->push_back( RenderBond( bonds[i] ) );
+
+    return createDataset( render_nodes, render_bonds, Qwt3D::hull( nodes ), append );
+}
+
+/*!
+Share graph data with the plot instead of copying it. The caller may keep modifying the buffers,
+the plot reads them whenever it rebuilds its OpenGL data (updateData()).
+
+\param hull Hull of the nodes, typically known to the caller (the simulation box) without a pass over the data
+\param append See above
+\return Index of new entry in dataset array (append == true), 0 (append == false) or -1 for errors
+*/
+int GraphPlot::createDataset( std::shared_ptr<const RenderNodeVector> nodes, std::shared_ptr<const RenderBondVector> bonds,
+                              ParallelEpiped const& hull, bool append /*= false*/ )
+{
+    if ( !nodes || !bonds )
+        return -1;
 
     int ret = prepareDatasetCreation<GraphData>( append );
     if ( ret < 0 )
@@ -99,10 +1280,100 @@ int GraphPlot::createDataset( AtomVector const& nodes, BondVector const& bonds,
 
     data.nodes = nodes;
     data.bonds = bonds;
-    data.setHull( Qwt3D::hull( nodes ) );
+    data.setHull( hull );
     updateData();
     createCoordinateSystem();
 
     return ret;
 }
 
+/*!
+Update the plot after the shared data of createDataset() changed from the given node and bond
+on, the nodes and bonds before them and the hull being the same. With sphere and bond impostors
+only the tails of the instance buffers are rebuilt and uploaded, the display list is kept.
+Other styles, or several datasets, get a full updateData().
+
+\param firstNode Index of the first new or changed node
+\param firstBond Index of the first new or changed bond
+*/
+void GraphPlot::updateDataTail( unsigned firstNode, unsigned firstBond )
+{
+    if ( !impostors_ || !sphere_program_ || CYLINDERS != bond_style_ || 1 != plotlets_p.size()
+         || NOPLOT == plotlets_p[0].appearance->plotStyle()
+         || firstNode > node_marks_.size() || firstBond > bond_marks_.size() )
+    {
+        updateData();
+        return;
+    }
+
+    const GraphData& data = dynamic_cast<const GraphData&>( *plotlets_p[0].data );
+
+    if ( firstNode < node_marks_.size() )
+    {
+        sphere_instances_.resize( node_marks_[firstNode] );
+        sphere_keys_.resize( node_marks_[firstNode] / 4 );
+        node_marks_.resize( firstNode );
+    }
+
+    sphere_upload_from_ = std::min( sphere_upload_from_, sphere_instances_.size() );
+    appendSphereInstances( *data.nodes, firstNode );
+
+    if ( firstBond < bond_marks_.size() )
+    {
+        int vertices = bond_marks_[firstBond].first;
+
+        bond_vertices_.resize( vertices );
+        bond_keys_.resize( vertices / 4 );
+        bond_runs_.resize( bond_marks_[firstBond].second );
+        bond_marks_.resize( firstBond );
+
+        // the run the first cut bond extended ends at the cut again
+        if ( !bond_runs_.empty() )
+        {
+            bond_runs_.back().second = vertices / 8 - bond_runs_.back().first;
+            bond_vertices_[vertices - 5] = 0.0f;
+        }
+    }
+
+    // an extension rewrites the last vertex in the buffer
+    bond_upload_from_ = std::min( bond_upload_from_, bond_vertices_.size() < 8 ? 0 : bond_vertices_.size() - 8 );
+    appendBondPolylines( *data.bonds, firstBond );
+}
+
+
+/*!
+Update the plot after the monomer types in the shared data of createDataset() changed, positions,
+colors and visibility of the nodes being the same. With the palette available (paletteAvailable())
+only the type and chain ids of the sphere instances are rebuilt and uploaded, otherwise the
+plot gets a full updateData().
+*/
+void GraphPlot::updateAttributes()
+{
+    if ( !paletteAvailable() || 1 != plotlets_p.size() || NOPLOT == plotlets_p[0].appearance->plotStyle() )
+    {
+        updateData();
+        return;
+    }
+
+    const RenderNodeVector& nodes = *dynamic_cast<const GraphData&>( *plotlets_p[0].data ).nodes;
+
+    sphere_keys_.clear();
+
+    for ( unsigned j = 0; j != nodes.size(); ++j )
+    {
+        if ( nodes[j].visible() )
+        {
+            sphere_keys_.push_back( float( nodes[j].monomer_type ) );
+            sphere_keys_.push_back( float( nodes[j].index ) );
+        }
+    }
+
+    // a node shown or hidden since changes the instances as well
+    if ( 4 * sphere_keys_.size() != sphere_instances_.size() )
+    {
+        updateData();
+        return;
+    }
+
+    sphere_keys_changed_ = true;
+}
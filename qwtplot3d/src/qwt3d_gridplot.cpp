@@ -5,6 +5,7 @@
 
 #include <QtCore/QElapsedTimer>
 #include <QDebug>
+#include <cstddef>
 
 #include "qwt3d_gridplot.h"
 #include "qwt3d_enrichment_std.h"
@@ -57,17 +58,24 @@ void GridPlot::GridData::setSize(unsigned int columns, unsigned int rows)
 // CVertexProcessor class
 
 GridPlot::CVertexProcessor::CVertexProcessor()
+	: m_fillBuffer(QOpenGLBuffer::VertexBuffer),
+	m_meshBuffer(QOpenGLBuffer::VertexBuffer)
 {
 	m_step = 1;
 	m_useColorMap = false;
 	m_colorData = NULL;
 	m_dataWidth = m_dataLength = 0;
 	m_data = NULL;
+	m_done = NULL;
+	m_uploaded = true;
+
+	// the plot owns its workers
+	setAutoDelete(false);
 }
 
 void GridPlot::CVertexProcessor::setup(int dataWidth, int dataLength, const GridPlot::GridData& data, int row, int step,
 									   bool useColorMap, const Qwt3D::RGBA& fixedColor, const Color* colorData,
-									   bool showMesh, const Qwt3D::RGBA& meshColor)
+									   bool showMesh, const Qwt3D::RGBA& meshColor, QSemaphore* done)
 {
 	m_dataWidth = dataWidth;
 	m_dataLength = dataLength;
@@ -80,22 +88,20 @@ void GridPlot::CVertexProcessor::setup(int dataWidth, int dataLength, const Grid
 	m_fixedColor = fixedColor;
 	m_drawMesh = showMesh;
 	m_meshColor = meshColor;
+	m_done = done;
 }
 
 void GridPlot::CVertexProcessor::run()
 {
 	// prepare draw arrays
-	m_draw_normals.clear();
 	m_draw_vertices.clear();
-	m_draw_colors.clear();
 	m_drawList.clear();
+	m_uploaded = false;
 
     if (m_drawFill && 0 != (m_dataLength*m_dataWidth))
 	{
 		// reserve() gives up to 10% speedup
-		m_draw_normals.reserve(m_dataLength*m_dataWidth*2);
 		m_draw_vertices.reserve(m_dataLength*m_dataWidth*2);
-		m_draw_colors.reserve(m_dataLength*m_dataWidth*2);
 		m_drawList.reserve(m_dataLength*m_dataWidth*2);
 
 		int index = 0;
@@ -120,7 +126,6 @@ void GridPlot::CVertexProcessor::run()
 
 	// prepare mesh arrays
 	m_mesh_vertices.clear();
-	m_mesh_colors.clear();
 	m_drawMeshList.clear();
 	
     if (m_drawMesh && 0 != (m_dataLength*m_dataWidth) )
@@ -154,6 +159,9 @@ void GridPlot::CVertexProcessor::run()
 			endLineVertex(index, size);
 		}		
 	}
+
+	if (m_done)
+		m_done->release();
 }
 
 void GridPlot::CVertexProcessor::processVertex(bool& stripStarted, int i, int j, int& index, int& size)
@@ -172,15 +180,12 @@ void GridPlot::CVertexProcessor::processVertex(bool& stripStarted, int i, int j,
 			stripStarted = true;
 		}
 
-		m_draw_vertices.push_back(v);
-		m_draw_normals.push_back(m_data->normals[j][i]);
+		const Triple& n = m_data->normals[j][i];
+		RGBA c = m_useColorMap ? m_colorData->rgba(v) : m_fixedColor;
 
-		if (m_useColorMap){
-			m_draw_colors.push_back(m_colorData->rgba(v));
-		}
-		else{
-			m_draw_colors.push_back(m_fixedColor);
-		}
+		FillVertex fv = { {GLfloat(v.x), GLfloat(v.y), GLfloat(v.z)}, {GLfloat(n.x), GLfloat(n.y), GLfloat(n.z)},
+			{GLfloat(c.r), GLfloat(c.g), GLfloat(c.b), GLfloat(c.a)} };
+		m_draw_vertices.push_back(fv);
 
 		size++;
 	}
@@ -213,9 +218,9 @@ void GridPlot::CVertexProcessor::processLineStripVertex(bool& stripStarted, int
 			stripStarted = true;
 		}
 
-		m_mesh_vertices.push_back(v);
-
-		m_mesh_colors.push_back(m_meshColor);
+		m_mesh_vertices.push_back(GLfloat(v.x));
+		m_mesh_vertices.push_back(GLfloat(v.y));
+		m_mesh_vertices.push_back(GLfloat(v.z));
 
 		size++;
 	}
@@ -228,44 +233,89 @@ void GridPlot::CVertexProcessor::endLineVertex(int& index, int& size)
 	}
 
 	// next available index
-	index = m_mesh_vertices.size();
+	index = m_mesh_vertices.size() / 3;
 	size = 0;
 }
 
+void GridPlot::CVertexProcessor::upload()
+{
+	if (!m_draw_vertices.empty())
+	{
+		if (!m_fillBuffer.isCreated())
+			m_fillBuffer.create();
+
+		m_fillBuffer.bind();
+		m_fillBuffer.allocate(&m_draw_vertices[0], int(m_draw_vertices.size() * sizeof(FillVertex)));
+		m_fillBuffer.release();
+	}
+
+	if (!m_mesh_vertices.empty())
+	{
+		if (!m_meshBuffer.isCreated())
+			m_meshBuffer.create();
+
+		m_meshBuffer.bind();
+		m_meshBuffer.allocate(&m_mesh_vertices[0], int(m_mesh_vertices.size() * sizeof(GLfloat)));
+		m_meshBuffer.release();
+	}
+
+	// the buffers hold the only copy now, the draw lists stay
+	std::vector<FillVertex>().swap(m_draw_vertices);
+	std::vector<GLfloat>().swap(m_mesh_vertices);
+	m_uploaded = true;
+}
+
 void GridPlot::CVertexProcessor::paintGL()
 {
- 	if (!m_draw_vertices.empty())
+	if (!m_uploaded)
+		upload();
+
+ 	if (!m_drawList.empty())
 	{
-		Q_ASSERT(m_draw_vertices.size() == m_draw_normals.size());
-		Q_ASSERT(m_draw_vertices.size() == m_draw_colors.size());
+		m_fillBuffer.bind();
 
-		glVertexPointer(3, GL_DOUBLE, 0, &m_draw_vertices[0]);
-		glNormalPointer(GL_DOUBLE, 0, &m_draw_normals[0]);
-		glColorPointer(4, GL_DOUBLE, 0, &m_draw_colors[0]);
+		glVertexPointer(3, GL_FLOAT, sizeof(FillVertex), (const GLvoid*) offsetof(FillVertex, position));
+		glNormalPointer(GL_FLOAT, sizeof(FillVertex), (const GLvoid*) offsetof(FillVertex, normal));
+		glColorPointer(4, GL_FLOAT, sizeof(FillVertex), (const GLvoid*) offsetof(FillVertex, color));
 
 		for (unsigned int i = 0; i < m_drawList.size(); i++)
 		{
 			const QPair<int,int>& p = m_drawList.at(i);
 			glDrawArrays(GL_TRIANGLE_STRIP, p.first, p.second);
 		}
+
+		m_fillBuffer.release();
 	}
 
-	// mesh
+	// mesh, in one color
 	if (!m_drawMeshList.empty())
 	{
-		Q_ASSERT(m_mesh_vertices.size() == m_mesh_colors.size());
+		glDisableClientState(GL_COLOR_ARRAY);
+		glDisableClientState(GL_NORMAL_ARRAY);
+		glColor4d(m_meshColor.r, m_meshColor.g, m_meshColor.b, m_meshColor.a);
 
-		glVertexPointer(3, GL_DOUBLE, 0, &m_mesh_vertices[0]);
-		glColorPointer(4, GL_DOUBLE, 0, &m_mesh_colors[0]);
+		m_meshBuffer.bind();
+		glVertexPointer(3, GL_FLOAT, 0, 0);
 
 		for (unsigned int i = 0; i < m_drawMeshList.size(); i++)
 		{
 			const QPair<int,int>& p = m_drawMeshList.at(i);
 			glDrawArrays(GL_LINE_STRIP, p.first, p.second);
 		}
+
+		m_meshBuffer.release();
+
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
 	}
 }
 
+void GridPlot::CVertexProcessor::destroyBuffers()
+{
+	m_fillBuffer.destroy();
+	m_meshBuffer.destroy();
+}
+
 
 // GridPlot class
 
@@ -279,6 +329,17 @@ GridPlot::GridPlot(QWidget* parent, const QOpenGLWidget* shareWidget)
 {
     resolution_p = 1;
     plotlets_p[0].data = ValuePtr<Data>(new GridData);
+
+	// idle threads wait for the next call instead of expiring
+	m_pool.setExpiryTimeout(-1);
+}
+
+GridPlot::~GridPlot()
+{
+	makeCurrent();
+
+	for (int i = 0; i < 10; i++)
+		m_workers[i].destroyBuffers();
 }
 
 void GridPlot::setColorFromVertex(const Color& colorData, const Triple& vertex, RGBA& lastColor, bool skip) const
@@ -909,16 +970,19 @@ void GridPlot::createOpenGlData(const Plotlet& pl)
 
 			m_workers[i].setup(lastcol, length, data, r, step, 
 				!hl, col, drawFill ? &colorData : NULL, 
-				drawMesh, app.meshColor());
-
-			m_workers[i].start(QThread::HighPriority);
+				drawMesh, app.meshColor(), &m_workersDone);
 
 			r += length;
 		}
 
-		// wait while threads are done
-		for (int i = 0; i < m_threadsCount; i++)
-			while (m_workers[i].isRunning());
+		// the pool takes all but the last share, this thread does that one instead of waiting idle
+		for (int i = 0; i < m_threadsCount - 1; i++)
+			m_pool.start(&m_workers[i]);
+
+		m_workers[m_threadsCount - 1].run();
+
+		// sleeps until every worker has released once
+		m_workersDone.acquire(m_threadsCount);
 	}
 
 	//qDebug() << "GridPlot::createOpenGlData(): " << timer.elapsed();
@@ -953,6 +1017,8 @@ void GridPlot::setRenderThreadsCount(int count)
 		m_threadsCount = 10;
 	else
 		m_threadsCount = count;
+
+	m_pool.setMaxThreadCount(qMax(1, m_threadsCount - 1));
 }
 
 void GridPlot::processVertex(const Triple& vert1, const Triple& norm1, 
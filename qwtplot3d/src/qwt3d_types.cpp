@@ -181,4 +181,31 @@ Qwt3D::ParallelEpiped Qwt3D::hull(AtomVector const& data)
 }
 
 
+Qwt3D::ParallelEpiped Qwt3D::hull(RenderNodeVector const& data)
+{
+    ParallelEpiped hull(Triple(DBL_MAX,DBL_MAX,DBL_MAX), Triple(-DBL_MAX,-DBL_MAX,-DBL_MAX));
+
+    for (unsigned i = 0; i < data.size(); ++i)
+    {
+        const Triple vert = data[i].position();
+
+        if (vert.x < hull.minVertex.x)
+            hull.minVertex.x = vert.x;
+        if (vert.y < hull.minVertex.y)
+            hull.minVertex.y = vert.y;
+        if (vert.z < hull.minVertex.z)
+            hull.minVertex.z = vert.z;
+
+        if (vert.x > hull.maxVertex.x)
+            hull.maxVertex.x = vert.x;
+        if (vert.y > hull.maxVertex.y)
+            hull.maxVertex.y = vert.y;
+        if (vert.z > hull.maxVertex.z)
+            hull.maxVertex.z = vert.z;
+    }
+
+    return hull;
+}
+
+
 #endif // QWT3D_NOT_FOR_DOXYGEN
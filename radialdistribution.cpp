@@ -0,0 +1,272 @@
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+#include "radialdistribution.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+#include <math.h>
+
+const int MIN_PARTICLES_PER_TASK = 2000;
+
+
+RadialDistribution::RadialDistribution( double rMax, double binWidth ) :
+    r_max( rMax ),
+    bin_width( binWidth ),
+    type_a( -1 ),
+    type_b( -1 ),
+    num_a( 0 ),
+    num_b( 0 ),
+    num_common( 0 ),
+    volume( 0.0 ),
+    hist_intra(),
+    hist_inter()
+{
+}
+
+
+
+bool RadialDistribution::compute( Grid* grid )
+{
+    QVector<Qwt3D::Triple> positions;
+    QVector<int> types;
+    QVector<int> chains;
+
+    Vector box_size = grid->params.box_size;
+
+    for ( int chain_nr = 0; chain_nr < grid->max_chains; chain_nr++ )
+    {
+        Chain* chain = &grid->chains[chain_nr];
+
+        for ( int j = chain->first; j < chain->last; j++ )
+        {
+            Vector v = Vector_periodic_box( chain->atoms[j - chain->offset], box_size );
+            positions.append( Qwt3D::Triple( v.x, v.y, v.z ) );
+            types.append( v.monomer_type );
+            chains.append( chain_nr );
+        }
+    }
+
+    bool periodic_z = !( grid->params.film || grid->params.brush );
+    PeriodicBox box( Qwt3D::Triple( 0.0, 0.0, 0.0 ), Qwt3D::Triple( box_size.x, box_size.y, box_size.z ), true, true, periodic_z );
+
+    return compute( positions, types, chains, box );
+}
+
+
+
+bool RadialDistribution::compute( const QVector<Qwt3D::Triple>& positions, const QVector<int>& types, const QVector<int>& chains, const PeriodicBox& box )
+{
+    hist_intra.clear();
+    hist_inter.clear();
+
+    volume = box.length( 0 ) * box.length( 1 ) * box.length( 2 );
+
+    // beyond half a periodic length a pair would be seen through two images
+    for ( int a = 0; a < 3; a++ )
+    {
+        if ( box.isPeriodic( a ) )
+        {
+            r_max = qMin( r_max, 0.5 * box.length( a ) );
+        }
+    }
+
+    if ( r_max <= 0.0 || bin_width <= 0.0 || volume <= 0.0 )
+    {
+        return false;
+    }
+
+    int num_bins = ( int ) ceil( r_max / bin_width - 1.0e-9 );
+    if ( num_bins < 1 ) num_bins = 1;
+
+    QVector<int> a_indices;
+    QVector<int> b_indices;
+    QVector<Qwt3D::Triple> b_positions;
+
+    num_common = 0;
+
+    for ( int i = 0; i < positions.count(); i++ )
+    {
+        bool is_a = ( type_a < 0 || type_a == types.at( i ) );
+        bool is_b = ( type_b < 0 || type_b == types.at( i ) );
+
+        if ( is_a )
+        {
+            a_indices.append( i );
+        }
+
+        if ( is_b )
+        {
+            b_indices.append( i );
+            b_positions.append( positions.at( i ) );
+        }
+
+        if ( is_a && is_b )
+        {
+            num_common++;
+        }
+    }
+
+    num_a = a_indices.count();
+    num_b = b_indices.count();
+
+    hist_intra.fill( 0, num_bins );
+    hist_inter.fill( 0, num_bins );
+
+    if ( 0 == num_a || 0 == num_b )
+    {
+        return true;
+    }
+
+    SpatialIndex index;
+    index.build( box, r_max, b_positions );
+
+    // each task histograms a contiguous range of A particles, counts are
+    // summed afterwards so the result does not depend on the thread count
+
+    int num_tasks = QThread::idealThreadCount();
+
+    int max_tasks = ( num_a + MIN_PARTICLES_PER_TASK - 1 ) / MIN_PARTICLES_PER_TASK;
+    if ( num_tasks > max_tasks ) num_tasks = max_tasks;
+    if ( num_tasks < 1 ) num_tasks = 1;
+
+    QVector< QVector<qint64> > local( num_tasks );
+    QVector<qint64>* local_hist = local.data();
+
+    QVector<int> tasks;
+    for ( int i = 0; i < num_tasks; i++ )
+    {
+        tasks.append( i );
+    }
+
+    const double cutoff = r_max;
+    const double width = bin_width;
+
+    QtConcurrent::blockingMap( tasks, [&]( int & task )
+    {
+        // intra-chain counts first, inter-chain counts after them
+        QVector<qint64>& hist = local_hist[task];
+        hist.fill( 0, 2 * num_bins );
+
+        QVector<int> nearby;
+
+        int first = ( qint64 ) num_a * task / num_tasks;
+        int last = ( qint64 ) num_a * ( task + 1 ) / num_tasks;
+
+        for ( int n = first; n < last; n++ )
+        {
+            int i = a_indices.at( n );
+            const Qwt3D::Triple& p = positions.at( i );
+
+            index.candidates( p, cutoff, nearby );
+
+            for ( int k = 0; k < nearby.count(); k++ )
+            {
+                int j = b_indices.at( nearby.at( k ) );
+                if ( j == i )
+                {
+                    continue;
+                }
+
+                Qwt3D::Triple d = box.separation( p, positions.at( j ) );
+                double r = sqrt( d.x * d.x + d.y * d.y + d.z * d.z );
+
+                if ( r <= cutoff )
+                {
+                    int bin = qMin( ( int )( r / width ), num_bins - 1 );
+                    hist[( chains.at( i ) == chains.at( j ) ? 0 : num_bins ) + bin]++;
+                }
+            }
+        }
+    } );
+
+    for ( int t = 0; t < num_tasks; t++ )
+    {
+        for ( int bin = 0; bin < num_bins; bin++ )
+        {
+            hist_intra[bin] += local.at( t ).at( bin );
+            hist_inter[bin] += local.at( t ).at( num_bins + bin );
+        }
+    }
+
+    return true;
+}
+
+
+
+double RadialDistribution::idealCount( int bin ) const
+{
+    // pairs an uncorrelated system of the same density puts into the shell
+    double r_in = bin * bin_width;
+    double r_out = qMin( ( bin + 1 ) * bin_width, r_max );
+    double shell = 4.0 / 3.0 * M_PI * ( pow( r_out, 3.0 ) - pow( r_in, 3.0 ) );
+    double pairs = ( double ) num_a * num_b - num_common;
+
+    double ideal = pairs * shell / volume;
+    return ( ideal > 0.0 ) ? ideal : 1.0;
+}
+
+
+
+double RadialDistribution::coordination( int bin ) const
+{
+    if ( 0 == num_a )
+    {
+        return 0.0;
+    }
+
+    qint64 sum = 0;
+    for ( int k = 0; k <= bin; k++ )
+    {
+        sum += hist_intra.at( k ) + hist_inter.at( k );
+    }
+
+    return ( double ) sum / num_a;
+}
+
+
+
+bool RadialDistribution::writeCSV( const QString& fileName ) const
+{
+    QFile file( fileName );
+
+    if ( false == file.open( QFile::WriteOnly | QFile::Truncate ) )
+    {
+        return false;
+    }
+
+    QTextStream out( &file );
+
+    out << "r,g,g_intra,g_inter,n\n";
+
+    for ( int bin = 0; bin < binCount(); bin++ )
+    {
+        out << radius( bin ) << "," << g( bin ) << "," << gIntra( bin ) << "," << gInter( bin ) << "," << coordination( bin ) << "\n";
+    }
+
+    out.flush();
+
+    return QFile::NoError == file.error();
+}
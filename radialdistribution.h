@@ -0,0 +1,78 @@
+#ifndef RADIALDISTRIBUTION_H
+#define RADIALDISTRIBUTION_H
+
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+#include <QVector>
+#include <QString>
+
+#include "grid.h"
+#include "spatialindex.h"
+
+// Radial distribution function g(r) and running coordination number n(r)
+// between the monomers of type A and those of type B (-1 selects every
+// type). Pairs are split into intra- and inter-chain contributions, with
+// g(r) = g_intra(r) + g_inter(r). The reference density is the B density of
+// the whole box, so on a film or brush g(r) drops below one where the
+// free surface cuts into the shell. The cutoff is limited to half of the
+// shortest periodic box length.
+
+class RadialDistribution
+{
+public:
+    RadialDistribution( double rMax, double binWidth );
+
+    void setTypes( int typeA, int typeB ) { type_a = typeA; type_b = typeB; }
+
+    bool compute( Grid* grid );
+    bool compute( const QVector<Qwt3D::Triple>& positions, const QVector<int>& types, const QVector<int>& chains, const PeriodicBox& box );
+
+    int binCount() const { return hist_intra.count(); }
+    double cutoff() const { return r_max; }
+    double radius( int bin ) const { return ( bin + 0.5 ) * bin_width; }
+    double g( int bin ) const { return gIntra( bin ) + gInter( bin ); }
+    double gIntra( int bin ) const { return hist_intra.at( bin ) / idealCount( bin ); }
+    double gInter( int bin ) const { return hist_inter.at( bin ) / idealCount( bin ); }
+    double coordination( int bin ) const;
+    int countA() const { return num_a; }
+    int countB() const { return num_b; }
+
+    bool writeCSV( const QString& fileName ) const;
+
+protected:
+    double r_max;
+    double bin_width;
+    int type_a;
+    int type_b;
+    int num_a;
+    int num_b;
+    int num_common;
+    double volume;
+    QVector<qint64> hist_intra;
+    QVector<qint64> hist_inter;
+
+    double idealCount( int bin ) const;
+};
+
+#endif // RADIALDISTRIBUTION_H
@@ -0,0 +1,100 @@
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include "radialdistributiondialog.h"
+#include "ui_radialdistributiondialog.h"
+#include "radialdistribution.h"
+
+#include <QCursor>
+#include <QFileDialog>
+#include <QGuiApplication>
+#include <QMessageBox>
+#include <QPushButton>
+
+RadialDistributionDialog::RadialDistributionDialog( Grid* g, MonomerList* list, QWidget* parent ) :
+    QDialog( parent ),
+    ui( new Ui::RadialDistributionDialog ),
+    grid( g ),
+    monomer_list( list )
+{
+    ui->setupUi( this );
+
+    // index 0 is "all monomers", monomer type n sits at index n + 1
+    ui->typeAComboBox->addItems( monomer_list->monomerNameList() );
+    ui->typeBComboBox->addItems( monomer_list->monomerNameList() );
+
+    connect( ui->fileSelectButton, SIGNAL( clicked( bool ) ), this, SLOT( fileSelectionButtonClicked() ) );
+    connect( ui->buttonBox->button( QDialogButtonBox::Apply ), SIGNAL( clicked( bool ) ), this, SLOT( applyButtonClicked() ) );
+}
+
+RadialDistributionDialog::~RadialDistributionDialog()
+{
+    delete ui;
+}
+
+void RadialDistributionDialog::fileSelectionButtonClicked()
+{
+    const QString EXTENSION( ".csv" );
+
+    QString fileName = QFileDialog::getSaveFileName( this, tr( "Save File" ), QString(), tr( "CSV files (*.csv)" ) );
+
+    if ( false == fileName.isEmpty() )
+    {
+        if ( false == fileName.endsWith( EXTENSION, Qt::CaseInsensitive ) )
+        {
+            fileName += EXTENSION;
+        }
+        ui->fileNameLabel->setText( fileName );
+        ui->fileNameLabel->setToolTip( fileName );
+    }
+}
+
+
+
+void RadialDistributionDialog::applyButtonClicked()
+{
+    RadialDistribution rdf( ui->cutoffSpinBox->value(), ui->binWidthSpinBox->value() );
+
+    rdf.setTypes( ui->typeAComboBox->currentIndex() - 1, ui->typeBComboBox->currentIndex() - 1 );
+
+    QGuiApplication::setOverrideCursor( QCursor( Qt::WaitCursor ) );
+    bool ok = rdf.compute( grid );
+    QGuiApplication::restoreOverrideCursor();
+
+    if ( false == ok )
+    {
+        ui->resultLabel->setText( tr( "nothing to calculate" ) );
+        return;
+    }
+
+    ui->resultLabel->setText( QString( "%1 A and %2 B monomers, coordination number within %3 is %4" )
+                              .arg( rdf.countA() ).arg( rdf.countB() ).arg( rdf.cutoff() ).arg( rdf.coordination( rdf.binCount() - 1 ) ) );
+
+    QString file_name = ui->fileNameLabel->text();
+
+    if ( false == rdf.writeCSV( file_name ) )
+    {
+        QMessageBox::warning( this, tr( "Radial distribution" ), QString( "Could not write to %1" ).arg( file_name ) );
+    }
+}
@@ -22,31 +22,69 @@
 // ----------------------------------------------------------------------------
 
 #include "random.h"
-#include <QRandomGenerator>
+#include <random>
+#include <sstream>
 
-QRandomGenerator rng;
+// the engine of QRandomGenerator, seeded and drawn from the same way so that a seed gives
+// the same packing as before; unlike QRandomGenerator its state can be saved and restored
+
+static std::mt19937 seededEngine( quint32 s )
+{
+    std::seed_seq seq( &s, &s + 1 );
+    return std::mt19937( seq );
+}
+
+static std::mt19937 rng = seededEngine( 1 );
 
 
 void seedRandomNumberGenerator( int s )
 {
-    rng.seed( s );
+    rng = seededEngine( s );
 }
 
 
 int randomInt()
 {
-    return rng.generate();
+    return rng();
+}
+
+
+// as QRandomGenerator::generateDouble(), the upper 53 bits of two 32 bit values
+
+double randomDouble()
+{
+    quint64 x = rng();
+    x |= quint64( rng() ) << 32;
+    return double( x >> 11 ) / double( Q_UINT64_C( 1 ) << 53 );
 }
 
 
 float randomFloat()
 {
-    return ( float ) rng.generateDouble();
+    return ( float ) randomDouble();
 }
 
 
-double randomDouble()
+QByteArray randomState()
+{
+    std::ostringstream out;
+    out << rng;
+    return QByteArray::fromStdString( out.str() );
+}
+
+
+bool restoreRandomNumberGenerator( const QByteArray& state )
 {
-    return rng.generateDouble();
+    std::istringstream in( state.toStdString() );
+    std::mt19937 restored;
+
+    in >> restored;
+    if ( in.fail() )
+    {
+        return false;
+    }
+
+    rng = restored;
+    return true;
 }
 
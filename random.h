@@ -25,9 +25,16 @@
 //
 // ----------------------------------------------------------------------------
 
+#include <QByteArray>
+
 float randomFloat();
 void seedRandomNumberGenerator( int seed );
 int randomInt();
 double randomDouble();
 
+// the full generator state as text, for checkpoints; restoring leaves the
+// generator alone and returns false for a state that does not parse
+QByteArray randomState();
+bool restoreRandomNumberGenerator( const QByteArray& state );
+
 #endif
@@ -0,0 +1,687 @@
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include "snapshotrenderer.h"
+
+#include <QVarLengthArray>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+// keeps the number of cells in proportion to the number of primitives
+const int MIN_CELL_LIMIT = 4096;
+const int TILE_SIZE = 32;
+
+// the light and material ExtGLWidget::initializeGL() sets up
+const double AMBIENT = 1.0;
+const double SPECULAR = 0.3;
+const double SHININESS = 5.0;
+
+// a ray stops once the surfaces in front of it cover the pixel this much
+const double OPAQUE = 0.995;
+
+namespace
+{
+
+// glRotatef( xDeg, 1, 0, 0 ) glRotatef( yDeg, 0, 1, 0 ) glRotatef( zDeg, 0, 0, 1 ) as one matrix
+void rotationMatrix( double xDeg, double yDeg, double zDeg, double m[3][3] )
+{
+    double x = xDeg * M_PI / 180.0;
+    double y = yDeg * M_PI / 180.0;
+    double z = zDeg * M_PI / 180.0;
+    double cx = cos( x ), sx = sin( x );
+    double cy = cos( y ), sy = sin( y );
+    double cz = cos( z ), sz = sin( z );
+
+    m[0][0] = cy * cz;
+    m[0][1] = -cy * sz;
+    m[0][2] = sy;
+    m[1][0] = sx * sy * cz + cx * sz;
+    m[1][1] = -sx * sy * sz + cx * cz;
+    m[1][2] = -sx * cy;
+    m[2][0] = -cx * sy * cz + sx * sz;
+    m[2][1] = cx * sy * sz + sx * cz;
+    m[2][2] = cx * cy;
+}
+
+double dot( const double* a, const double* b )
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+void normalize( double* v )
+{
+    double len = sqrt( dot( v, v ) );
+
+    if ( len > 0.0 )
+    {
+        v[0] /= len;
+        v[1] /= len;
+        v[2] /= len;
+    }
+}
+
+// front hit of a ray with unit direction d
+bool sphereHit( const double* o, const double* d, const double* c, double r, double& t )
+{
+    double oc[3] = { o[0] - c[0], o[1] - c[1], o[2] - c[2] };
+    double b = dot( oc, d );
+    double h = b * b - dot( oc, oc ) + r * r;
+
+    if ( h < 0.0 )
+    {
+        return false;
+    }
+
+    t = -b - sqrt( h );
+    return t > 0.0;
+}
+
+}
+
+
+SnapshotRenderer::SnapshotRenderer( int imageWidth, int imageHeight ) :
+    width( imageWidth ),
+    height( imageHeight ),
+    view_radius( 1.0 ),
+    ortho( false ),
+    lighting( false ),
+    background( qRgb( 255, 255, 255 ) ),
+    spheres(),
+    capsules(),
+    capsule_radius( 0.0 ),
+    cell_start(),
+    cell_items()
+{
+    for ( int a = 0; a < 3; a++ )
+    {
+        for ( int b = 0; b < 3; b++ )
+        {
+            rotation[a][b] = ( a == b ) ? 1.0 : 0.0;
+        }
+        scale[a] = 1.0;
+        offset[a] = 0.0;
+        eye_shift[a] = 0.0;
+        light[a] = 0.0;
+        origin[a] = 0.0;
+        cell_width[a] = 1.0;
+        num_cells[a] = 1;
+    }
+}
+
+
+
+void SnapshotRenderer::setCamera( const Qwt3D::Plot3D& plot )
+{
+    // see Plot3D::paintGL()
+    Qwt3D::Triple beg = plot.coordinates()->first();
+    Qwt3D::Triple end = plot.coordinates()->second();
+    Qwt3D::Triple center = beg + ( end - beg ) / 2;
+
+    view_radius = ( center - beg ).length();
+    if ( view_radius <= 0.0 ) view_radius = 1.0;
+
+    rotationMatrix( plot.xRotation() - 90, plot.yRotation(), plot.zRotation(), rotation );
+
+    scale[0] = plot.zoom() * plot.xScale();
+    scale[1] = plot.zoom() * plot.yScale();
+    scale[2] = plot.zoom() * plot.zScale();
+
+    offset[0] = plot.xShift() - center.x;
+    offset[1] = plot.yShift() - center.y;
+    offset[2] = plot.zShift() - center.z;
+
+    eye_shift[0] = plot.xViewportShift() * 2 * view_radius;
+    eye_shift[1] = plot.yViewportShift() * 2 * view_radius;
+    eye_shift[2] = -7 * view_radius;
+
+    ortho = plot.ortho();
+    lighting = plot.lightingEnabled();
+
+    // see ExtGLWidget::applyLight()
+    double light_rotation[3][3];
+    rotationMatrix( plot.xLightRotation() - 90, plot.yLightRotation(), plot.zLightRotation(), light_rotation );
+    const double shift[3] = { plot.xLightShift(), plot.yLightShift(), plot.zLightShift() };
+
+    for ( int a = 0; a < 3; a++ )
+    {
+        light[a] = dot( light_rotation[a], shift );
+    }
+
+    Qwt3D::RGBA bg = plot.backgroundRGBAColor();
+    background = qRgb( qBound( 0, ( int )( 255 * bg.r + 0.5 ), 255 ), qBound( 0, ( int )( 255 * bg.g + 0.5 ), 255 ),
+                       qBound( 0, ( int )( 255 * bg.b + 0.5 ), 255 ) );
+}
+
+
+
+void SnapshotRenderer::setScene( const Qwt3D::RenderNodeVector& nodes, const Qwt3D::RenderBondVector& bonds, double bondRadius,
+                                 const std::vector<bool>& visibleChains, const Qwt3D::Triple& cellWidth )
+{
+    spheres.clear();
+    capsules.clear();
+    capsule_radius = bondRadius;
+
+    double lo[3] = { DBL_MAX, DBL_MAX, DBL_MAX };
+    double hi[3] = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+
+    // like the plot, nodes and bonds take their chain from the index and
+    // invisible ones, such as the markers at the box corners, are left out
+    for ( size_t i = 0; i < nodes.size(); i++ )
+    {
+        const Qwt3D::RenderNode& node = nodes[i];
+
+        if ( !node.visible() || node.radius <= 0.0f
+                || ( 0 <= node.index && node.index < ( int ) visibleChains.size() && false == visibleChains[node.index] ) )
+        {
+            continue;
+        }
+
+        Qwt3D::RGBA col = node.color();
+        Sphere s = { { node.pos[0], node.pos[1], node.pos[2] }, node.radius,
+            { ( float ) col.r, ( float ) col.g, ( float ) col.b, ( float ) col.a } };
+        spheres.append( s );
+
+        for ( int a = 0; a < 3; a++ )
+        {
+            lo[a] = std::min( lo[a], s.centre[a] - ( double ) s.radius );
+            hi[a] = std::max( hi[a], s.centre[a] + ( double ) s.radius );
+        }
+    }
+
+    for ( size_t i = 0; i < bonds.size() && bondRadius > 0.0; i++ )
+    {
+        const Qwt3D::RenderBond& bond = bonds[i];
+
+        if ( !bond.visible() || ( 0 <= bond.index && bond.index < ( int ) visibleChains.size() && false == visibleChains[bond.index] ) )
+        {
+            continue;
+        }
+
+        Qwt3D::RGBA col = bond.color();
+        Capsule c = { { bond.first[0], bond.first[1], bond.first[2] },
+            { bond.second[0], bond.second[1], bond.second[2] },
+            { ( float ) col.r, ( float ) col.g, ( float ) col.b, ( float ) col.a } };
+        capsules.append( c );
+
+        for ( int a = 0; a < 3; a++ )
+        {
+            lo[a] = std::min( lo[a], std::min( c.begin[a], c.end[a] ) - bondRadius );
+            hi[a] = std::max( hi[a], std::max( c.begin[a], c.end[a] ) + bondRadius );
+        }
+    }
+
+    buildCells( lo, hi, cellWidth );
+}
+
+
+
+void SnapshotRenderer::itemBounds( int item, double* lo, double* hi ) const
+{
+    if ( item < spheres.count() )
+    {
+        const Sphere& s = spheres.at( item );
+
+        for ( int a = 0; a < 3; a++ )
+        {
+            lo[a] = s.centre[a] - s.radius;
+            hi[a] = s.centre[a] + s.radius;
+        }
+    }
+    else
+    {
+        const Capsule& c = capsules.at( item - spheres.count() );
+
+        for ( int a = 0; a < 3; a++ )
+        {
+            lo[a] = std::min( c.begin[a], c.end[a] ) - capsule_radius;
+            hi[a] = std::max( c.begin[a], c.end[a] ) + capsule_radius;
+        }
+    }
+}
+
+
+
+void SnapshotRenderer::buildCells( const double* lo, const double* hi, const Qwt3D::Triple& cellWidth )
+{
+    int count = spheres.count() + capsules.count();
+
+    cell_start.clear();
+    cell_items.clear();
+
+    if ( 0 == count )
+    {
+        return;
+    }
+
+    // without a cell size of the packing, cells hold about one primitive each
+    double size[3] = { cellWidth.x, cellWidth.y, cellWidth.z };
+    double extent[3] = { hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2] };
+    double volume = std::max( extent[0], 0.0 ) * std::max( extent[1], 0.0 ) * std::max( extent[2], 0.0 );
+
+    qint64 cell_limit = std::max( ( qint64 ) MIN_CELL_LIMIT, 2 * ( qint64 ) count );
+
+    for ( int a = 0; a < 3; a++ )
+    {
+        if ( size[a] <= 0.0 )
+        {
+            size[a] = cbrt( volume / count );
+        }
+
+        origin[a] = lo[a];
+        num_cells[a] = ( size[a] > 0.0 && extent[a] > 0.0 ) ? std::max( 1, ( int ) ceil( extent[a] / size[a] ) ) : 1;
+    }
+
+    // coarsen until the cell count is bounded
+    while ( ( qint64 ) num_cells[0] * num_cells[1] * num_cells[2] > cell_limit )
+    {
+        for ( int a = 0; a < 3; a++ )
+        {
+            num_cells[a] = std::max( 1, num_cells[a] / 2 );
+        }
+    }
+
+    for ( int a = 0; a < 3; a++ )
+    {
+        cell_width[a] = ( extent[a] > 0.0 ) ? extent[a] / num_cells[a] : 1.0;
+    }
+
+    // counting sort by cell, every primitive goes into all cells its bounds overlap;
+    // the bounds grow a little so that a hit on a cell face finds it on either side
+    int total_cells = num_cells[0] * num_cells[1] * num_cells[2];
+    QVector<int> ranges( 6 * count );
+
+    cell_start.fill( 0, total_cells + 1 );
+
+    for ( int i = 0; i < count; i++ )
+    {
+        double item_lo[3];
+        double item_hi[3];
+        int* range = &ranges[6 * i];
+
+        itemBounds( i, item_lo, item_hi );
+
+        for ( int a = 0; a < 3; a++ )
+        {
+            double eps = 1e-6 * cell_width[a];
+            range[a] = qBound( 0, ( int ) floor( ( item_lo[a] - eps - origin[a] ) / cell_width[a] ), num_cells[a] - 1 );
+            range[a + 3] = qBound( 0, ( int ) floor( ( item_hi[a] + eps - origin[a] ) / cell_width[a] ), num_cells[a] - 1 );
+        }
+
+        for ( int cz = range[2]; cz <= range[5]; cz++ )
+            for ( int cy = range[1]; cy <= range[4]; cy++ )
+                for ( int cx = range[0]; cx <= range[3]; cx++ )
+                {
+                    cell_start[cellIndex( cx, cy, cz ) + 1]++;
+                }
+    }
+
+    for ( int c = 0; c < total_cells; c++ )
+    {
+        cell_start[c + 1] += cell_start[c];
+    }
+
+    QVector<int> fill = cell_start;
+    cell_items.resize( cell_start[total_cells] );
+
+    for ( int i = 0; i < count; i++ )
+    {
+        const int* range = &ranges[6 * i];
+
+        for ( int cz = range[2]; cz <= range[5]; cz++ )
+            for ( int cy = range[1]; cy <= range[4]; cy++ )
+                for ( int cx = range[0]; cx <= range[3]; cx++ )
+                {
+                    cell_items[fill[cellIndex( cx, cy, cz )]++] = i;
+                }
+    }
+}
+
+
+
+QImage SnapshotRenderer::render() const
+{
+    QImage image( width, height, QImage::Format_RGB32 );
+
+    if ( image.isNull() )
+    {
+        return image;
+    }
+
+    // the tasks write into disjoint tiles of the one detached buffer
+    uchar* bits = image.bits();
+    qsizetype stride = image.bytesPerLine();
+    int tiles_x = ( width + TILE_SIZE - 1 ) / TILE_SIZE;
+    int tiles_y = ( height + TILE_SIZE - 1 ) / TILE_SIZE;
+    double unit = 2.0 / qMin( width, height );
+
+    QVector<int> tiles;
+    for ( int i = 0; i < tiles_x * tiles_y; i++ )
+    {
+        tiles.append( i );
+    }
+
+    QtConcurrent::blockingMap( tiles, [this, bits, stride, tiles_x, unit]( int & tile )
+    {
+        int x0 = ( tile % tiles_x ) * TILE_SIZE;
+        int y0 = ( tile / tiles_x ) * TILE_SIZE;
+        int x1 = qMin( x0 + TILE_SIZE, width );
+        int y1 = qMin( y0 + TILE_SIZE, height );
+
+        for ( int y = y0; y < y1; y++ )
+        {
+            QRgb* line = ( QRgb* )( bits + y * stride );
+
+            for ( int x = x0; x < x1; x++ )
+            {
+                line[x] = trace( ( x + 0.5 - 0.5 * width ) * unit, ( 0.5 * height - y - 0.5 ) * unit );
+            }
+        }
+    } );
+
+    return image;
+}
+
+
+
+QRgb SnapshotRenderer::trace( double x, double y ) const
+{
+    // the ray through the pixel in eye coordinates, x and y in units of the view radius
+    double eye_origin[3] = { 0.0, 0.0, 0.0 };
+    double eye_dir[3] = { 0.0, 0.0, -1.0 };
+
+    if ( ortho )
+    {
+        eye_origin[0] = x * view_radius;
+        eye_origin[1] = y * view_radius;
+    }
+    else
+    {
+        // the frustum is view_radius wide at the near plane, 5 view radii away
+        eye_dir[0] = x / 5;
+        eye_dir[1] = y / 5;
+    }
+
+    // back to world coordinates: p = scale^-1 * rotation^T * eye - offset
+    double o[3];
+    double d[3];
+
+    for ( int a = 0; a < 3; a++ )
+    {
+        o[a] = 0.0;
+        d[a] = 0.0;
+
+        for ( int b = 0; b < 3; b++ )
+        {
+            o[a] += rotation[b][a] * ( eye_origin[b] - eye_shift[b] );
+            d[a] += rotation[b][a] * eye_dir[b];
+        }
+
+        o[a] = o[a] / scale[a] - offset[a];
+        d[a] /= scale[a];
+    }
+
+    normalize( d );
+
+    double rgb[3] = { 0.0, 0.0, 0.0 };
+    double coverage = 0.0;
+
+    // clip the ray to the grid
+    double t_min = 0.0;
+    double t_max = DBL_MAX;
+
+    for ( int a = 0; a < 3 && false == cell_items.isEmpty(); a++ )
+    {
+        double lo = origin[a];
+        double hi = origin[a] + num_cells[a] * cell_width[a];
+
+        if ( fabs( d[a] ) < 1e-12 )
+        {
+            if ( o[a] < lo || o[a] > hi ) t_max = -1.0;
+            continue;
+        }
+
+        double ta = ( lo - o[a] ) / d[a];
+        double tb = ( hi - o[a] ) / d[a];
+
+        t_min = std::max( t_min, std::min( ta, tb ) );
+        t_max = std::min( t_max, std::max( ta, tb ) );
+    }
+
+    if ( false == cell_items.isEmpty() && t_min <= t_max )
+    {
+        // step through the cells along the ray
+        int cell[3];
+        int step[3];
+        double t_next[3];
+        double t_delta[3];
+
+        for ( int a = 0; a < 3; a++ )
+        {
+            double p = o[a] + t_min * d[a];
+            cell[a] = qBound( 0, ( int ) floor( ( p - origin[a] ) / cell_width[a] ), num_cells[a] - 1 );
+            step[a] = ( d[a] > 0.0 ) ? 1 : -1;
+
+            if ( fabs( d[a] ) < 1e-12 )
+            {
+                t_next[a] = DBL_MAX;
+                t_delta[a] = DBL_MAX;
+            }
+            else
+            {
+                t_next[a] = ( origin[a] + ( cell[a] + ( d[a] > 0.0 ? 1 : 0 ) ) * cell_width[a] - o[a] ) / d[a];
+                t_delta[a] = cell_width[a] / fabs( d[a] );
+            }
+        }
+
+        double t_cell = t_min;
+        QVarLengthArray<Hit, 32> hits;
+
+        while ( coverage < OPAQUE )
+        {
+            double t_exit = std::min( t_max, std::min( t_next[0], std::min( t_next[1], t_next[2] ) ) );
+            int c = cellIndex( cell[0], cell[1], cell[2] );
+
+            // the surfaces in this cell; one that reaches into other cells counts where it is hit
+            hits.clear();
+
+            for ( int k = cell_start[c]; k < cell_start[c + 1]; k++ )
+            {
+                Hit hit;
+                hit.item = cell_items[k];
+
+                if ( intersect( hit.item, o, d, hit.t ) && t_cell <= hit.t && hit.t < t_exit )
+                {
+                    hits.append( hit );
+                }
+            }
+
+            std::sort( hits.begin(), hits.end(), []( const Hit & a, const Hit & b ) { return a.t < b.t; } );
+
+            for ( int h = 0; h < hits.count() && coverage < OPAQUE; h++ )
+            {
+                float rgba[4];
+                shade( hits[h].item, o, d, hits[h].t, rgba );
+
+                double weight = rgba[3] * ( 1.0 - coverage );
+                rgb[0] += weight * rgba[0];
+                rgb[1] += weight * rgba[1];
+                rgb[2] += weight * rgba[2];
+                coverage += weight;
+            }
+
+            if ( t_exit >= t_max )
+            {
+                break;
+            }
+
+            int a = ( t_next[0] < t_next[1] ) ? ( t_next[0] < t_next[2] ? 0 : 2 ) : ( t_next[1] < t_next[2] ? 1 : 2 );
+
+            cell[a] += step[a];
+            if ( cell[a] < 0 || cell[a] >= num_cells[a] )
+            {
+                break;
+            }
+
+            t_cell = t_next[a];
+            t_next[a] += t_delta[a];
+        }
+    }
+
+    double rest = 1.0 - coverage;
+
+    return qRgb( qBound( 0, ( int )( 255 * rgb[0] + rest * qRed( background ) + 0.5 ), 255 ),
+                 qBound( 0, ( int )( 255 * rgb[1] + rest * qGreen( background ) + 0.5 ), 255 ),
+                 qBound( 0, ( int )( 255 * rgb[2] + rest * qBlue( background ) + 0.5 ), 255 ) );
+}
+
+
+
+bool SnapshotRenderer::intersect( int item, const double* o, const double* d, double& t ) const
+{
+    if ( item < spheres.count() )
+    {
+        const Sphere& s = spheres.at( item );
+        const double c[3] = { s.centre[0], s.centre[1], s.centre[2] };
+
+        return sphereHit( o, d, c, s.radius, t );
+    }
+
+    // a capsule is a cylinder with a sphere at either end, its front hit the first of theirs
+    const Capsule& cap = capsules.at( item - spheres.count() );
+    const double pa[3] = { cap.begin[0], cap.begin[1], cap.begin[2] };
+    const double pb[3] = { cap.end[0], cap.end[1], cap.end[2] };
+    const double ba[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+    const double oa[3] = { o[0] - pa[0], o[1] - pa[1], o[2] - pa[2] };
+    double r = capsule_radius;
+
+    double baba = dot( ba, ba );
+    double bard = dot( ba, d );
+    double baoa = dot( ba, oa );
+    double a = baba - bard * bard;
+    double best = DBL_MAX;
+    double tc;
+
+    if ( a > 1e-12 * baba )
+    {
+        double b = baba * dot( oa, d ) - baoa * bard;
+        double c = baba * dot( oa, oa ) - baoa * baoa - r * r * baba;
+        double h = b * b - a * c;
+
+        if ( h >= 0.0 )
+        {
+            tc = ( -b - sqrt( h ) ) / a;
+            double y = baoa + tc * bard;
+
+            if ( tc > 0.0 && 0.0 < y && y < baba )
+            {
+                best = tc;
+            }
+        }
+    }
+
+    if ( sphereHit( o, d, pa, r, tc ) ) best = std::min( best, tc );
+    if ( sphereHit( o, d, pb, r, tc ) ) best = std::min( best, tc );
+
+    t = best;
+    return best < DBL_MAX;
+}
+
+
+
+void SnapshotRenderer::shade( int item, const double* o, const double* d, double t, float* rgba ) const
+{
+    const double p[3] = { o[0] + t * d[0], o[1] + t * d[1], o[2] + t * d[2] };
+    double n[3];
+    const float* color;
+
+    if ( item < spheres.count() )
+    {
+        const Sphere& s = spheres.at( item );
+
+        for ( int a = 0; a < 3; a++ )
+        {
+            n[a] = p[a] - s.centre[a];
+        }
+        color = s.color;
+    }
+    else
+    {
+        // away from the nearest point of the axis
+        const Capsule& cap = capsules.at( item - spheres.count() );
+        const double ba[3] = { ( double ) cap.end[0] - cap.begin[0], ( double ) cap.end[1] - cap.begin[1], ( double ) cap.end[2] - cap.begin[2] };
+        const double pa[3] = { p[0] - cap.begin[0], p[1] - cap.begin[1], p[2] - cap.begin[2] };
+        double baba = dot( ba, ba );
+        double h = ( baba > 0.0 ) ? qBound( 0.0, dot( pa, ba ) / baba, 1.0 ) : 0.0;
+
+        for ( int a = 0; a < 3; a++ )
+        {
+            n[a] = pa[a] - h * ba[a];
+        }
+        color = cap.color;
+    }
+
+    rgba[3] = color[3];
+
+    if ( false == lighting )
+    {
+        rgba[0] = color[0];
+        rgba[1] = color[1];
+        rgba[2] = color[2];
+        return;
+    }
+
+    // shaded in eye coordinates like the impostors, normals take the inverse scale
+    double eye_p[3];
+    double eye_n[3];
+
+    for ( int a = 0; a < 3; a++ )
+    {
+        eye_p[a] = 0.0;
+        eye_n[a] = 0.0;
+
+        for ( int b = 0; b < 3; b++ )
+        {
+            eye_p[a] += rotation[a][b] * scale[b] * ( p[b] + offset[b] );
+            eye_n[a] += rotation[a][b] * n[b] / scale[b];
+        }
+    }
+
+    normalize( eye_n );
+
+    double l[3] = { light[0] - eye_p[0], light[1] - eye_p[1], light[2] - eye_p[2] };
+    normalize( l );
+
+    double half_vector[3] = { l[0], l[1], l[2] + 1.0 };
+    normalize( half_vector );
+
+    double diffuse = std::max( dot( eye_n, l ), 0.0 );
+    double specular = ( diffuse > 0.0 ) ? pow( std::max( dot( eye_n, half_vector ), 0.0 ), SHININESS ) : 0.0;
+
+    for ( int a = 0; a < 3; a++ )
+    {
+        rgba[a] = ( float ) std::min( color[a] * ( AMBIENT + diffuse ) + SPECULAR * specular, 1.0 );
+    }
+}
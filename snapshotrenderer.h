@@ -0,0 +1,115 @@
+#ifndef SNAPSHOTRENDERER_H
+#define SNAPSHOTRENDERER_H
+
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include <QImage>
+#include <QVector>
+#include <vector>
+
+#include "qwt3d_plot3d.h"
+
+// Ray-casts the nodes and bonds of a graph into an image without OpenGL, for
+// snapshots on machines without a display. Nodes are spheres, bonds capsules
+// of one radius, both shaded like the impostors of GraphPlot. The camera is
+// the one Plot3D::paintGL() sets up from the rotation, scale, shift and zoom
+// of a plot, so the view presets of the widget frame the image the same way;
+// the shorter side of the image spans the view where the widget stretches it.
+// Titles, legends and axes are not drawn.
+//
+// The primitives are binned into a uniform cell grid, usually the cells of
+// the packing, and every ray steps through it cell by cell, blending the
+// translucent surfaces it meets front to back. Tiles of the image are
+// rendered in parallel.
+
+class SnapshotRenderer
+{
+public:
+    SnapshotRenderer( int imageWidth, int imageHeight );
+
+    void setCamera( const Qwt3D::Plot3D& plot );
+    void setScene( const Qwt3D::RenderNodeVector& nodes, const Qwt3D::RenderBondVector& bonds, double bondRadius,
+                   const std::vector<bool>& visibleChains, const Qwt3D::Triple& cellWidth );
+
+    int sphereCount() const { return spheres.count(); }
+    int capsuleCount() const { return capsules.count(); }
+
+    QImage render() const;
+
+protected:
+    struct Sphere
+    {
+        float centre[3];
+        float radius;
+        float color[4];
+    };
+
+    struct Capsule
+    {
+        float begin[3];
+        float end[3];
+        float color[4];
+    };
+
+    struct Hit
+    {
+        double t;
+        int item;
+    };
+
+    int width;
+    int height;
+
+    // world to eye coordinates: eye = rotation * scale * ( p + offset )
+    double rotation[3][3];
+    double scale[3];
+    double offset[3];
+    double eye_shift[3];   // the translation Plot3D puts on the projection stack
+    double view_radius;
+    bool ortho;
+    bool lighting;
+    double light[3];       // point light, eye coordinates
+    QRgb background;
+
+    QVector<Sphere> spheres;
+    QVector<Capsule> capsules;
+    double capsule_radius;
+
+    double origin[3];
+    double cell_width[3];
+    int num_cells[3];
+    QVector<int> cell_start;
+    QVector<int> cell_items;  // spheres first, then capsules
+
+    void buildCells( const double* lo, const double* hi, const Qwt3D::Triple& cellWidth );
+    void itemBounds( int item, double* lo, double* hi ) const;
+    int cellIndex( int cx, int cy, int cz ) const { return ( cz * num_cells[1] + cy ) * num_cells[0] + cx; }
+
+    QRgb trace( double x, double y ) const;
+    bool intersect( int item, const double* o, const double* d, double& t ) const;
+    void shade( int item, const double* o, const double* d, double t, float* rgba ) const;
+};
+
+#endif // SNAPSHOTRENDERER_H
@@ -0,0 +1,253 @@
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include "spatialindex.h"
+
+#include <algorithm>
+#include <math.h>
+
+// keeps the number of cells in proportion to the number of points
+const int MIN_CELL_LIMIT = 4096;
+
+
+PeriodicBox::PeriodicBox()
+{
+    for ( int a = 0; a < 3; a++ )
+    {
+        lo[a] = 0.0;
+        len[a] = 0.0;
+        periodic[a] = false;
+    }
+}
+
+
+
+PeriodicBox::PeriodicBox( const Qwt3D::Triple& boxMin, const Qwt3D::Triple& boxMax, bool periodicX, bool periodicY, bool periodicZ )
+{
+    lo[0] = boxMin.x;
+    lo[1] = boxMin.y;
+    lo[2] = boxMin.z;
+    len[0] = boxMax.x - boxMin.x;
+    len[1] = boxMax.y - boxMin.y;
+    len[2] = boxMax.z - boxMin.z;
+    periodic[0] = periodicX;
+    periodic[1] = periodicY;
+    periodic[2] = periodicZ;
+
+    // a degenerate axis can not wrap
+    for ( int a = 0; a < 3; a++ )
+    {
+        periodic[a] = periodic[a] && ( len[a] > 0.0 );
+    }
+}
+
+
+
+Qwt3D::Triple PeriodicBox::separation( const Qwt3D::Triple& a, const Qwt3D::Triple& b ) const
+{
+    return Qwt3D::Triple( minimumImage( a.x - b.x, 0 ), minimumImage( a.y - b.y, 1 ), minimumImage( a.z - b.z, 2 ) );
+}
+
+
+
+double PeriodicBox::minimumImage( double d, int axis ) const
+{
+    if ( periodic[axis] )
+    {
+        d -= len[axis] * floor( d / len[axis] + 0.5 );
+    }
+
+    return d;
+}
+
+
+
+SpatialIndex::SpatialIndex() :
+    cell_start(),
+    cell_points()
+{
+    for ( int a = 0; a < 3; a++ )
+    {
+        periodic[a] = false;
+        origin[a] = 0.0;
+        cell_width[a] = 1.0;
+        num_cells[a] = 1;
+    }
+}
+
+
+
+void SpatialIndex::build( const PeriodicBox& box, double cellSize, const QVector<Qwt3D::Triple>& points )
+{
+    double lo[3];
+    double hi[3];
+
+    for ( int a = 0; a < 3; a++ )
+    {
+        periodic[a] = box.isPeriodic( a );
+        lo[a] = box.lower( a );
+        hi[a] = box.lower( a ) + box.length( a );
+    }
+
+    // points outside the nominal box still get a cell, periodic axes wrap them instead
+    for ( int i = 0; i < points.count(); i++ )
+    {
+        const double p[3] = { points[i].x, points[i].y, points[i].z };
+        for ( int a = 0; a < 3; a++ )
+        {
+            if ( false == periodic[a] )
+            {
+                lo[a] = std::min( lo[a], p[a] );
+                hi[a] = std::max( hi[a], p[a] );
+            }
+        }
+    }
+
+    qint64 cell_limit = std::max( ( qint64 ) MIN_CELL_LIMIT, 2 * ( qint64 ) points.count() );
+
+    for ( int a = 0; a < 3; a++ )
+    {
+        double extent = hi[a] - lo[a];
+        origin[a] = lo[a];
+        num_cells[a] = ( cellSize > 0.0 && extent > 0.0 ) ? std::max( 1, ( int ) floor( extent / cellSize ) ) : 1;
+    }
+
+    // coarsen until the cell count is bounded
+    while ( ( qint64 ) num_cells[0] * num_cells[1] * num_cells[2] > cell_limit )
+    {
+        for ( int a = 0; a < 3; a++ )
+        {
+            num_cells[a] = std::max( 1, num_cells[a] / 2 );
+        }
+    }
+
+    for ( int a = 0; a < 3; a++ )
+    {
+        double extent = hi[a] - lo[a];
+        cell_width[a] = ( extent > 0.0 ) ? extent / num_cells[a] : 1.0;
+    }
+
+    // counting sort by cell, points stay in ascending order within a cell
+    int total_cells = num_cells[0] * num_cells[1] * num_cells[2];
+    QVector<int> point_cell( points.count() );
+
+    cell_start.fill( 0, total_cells + 1 );
+
+    for ( int i = 0; i < points.count(); i++ )
+    {
+        point_cell[i] = cellIndex( cellCoordinate( rawCoordinate( points[i].x, 0 ), 0 ),
+                                   cellCoordinate( rawCoordinate( points[i].y, 1 ), 1 ),
+                                   cellCoordinate( rawCoordinate( points[i].z, 2 ), 2 ) );
+        cell_start[point_cell[i] + 1]++;
+    }
+
+    for ( int c = 0; c < total_cells; c++ )
+    {
+        cell_start[c + 1] += cell_start[c];
+    }
+
+    QVector<int> fill = cell_start;
+    cell_points.resize( points.count() );
+
+    for ( int i = 0; i < points.count(); i++ )
+    {
+        cell_points[fill[point_cell[i]]++] = i;
+    }
+}
+
+
+
+void SpatialIndex::candidates( const Qwt3D::Triple& center, double radius, QVector<int>& result ) const
+{
+    result.clear();
+
+    if ( cell_points.isEmpty() )
+    {
+        return;
+    }
+
+    int lo[3];
+    int hi[3];
+    const double c[3] = { center.x, center.y, center.z };
+
+    for ( int a = 0; a < 3; a++ )
+    {
+        lo[a] = rawCoordinate( c[a] - radius, a );
+        hi[a] = rawCoordinate( c[a] + radius, a );
+
+        if ( periodic[a] && hi[a] - lo[a] + 1 >= num_cells[a] )
+        {
+            // the ball wraps onto itself, every cell once
+            lo[a] = 0;
+            hi[a] = num_cells[a] - 1;
+        }
+        else if ( false == periodic[a] )
+        {
+            lo[a] = cellCoordinate( lo[a], a );
+            hi[a] = cellCoordinate( hi[a], a );
+        }
+    }
+
+    for ( int rz = lo[2]; rz <= hi[2]; rz++ )
+    {
+        int cz = cellCoordinate( rz, 2 );
+        for ( int ry = lo[1]; ry <= hi[1]; ry++ )
+        {
+            int cy = cellCoordinate( ry, 1 );
+            for ( int rx = lo[0]; rx <= hi[0]; rx++ )
+            {
+                int cell = cellIndex( cellCoordinate( rx, 0 ), cy, cz );
+                for ( int k = cell_start[cell]; k < cell_start[cell + 1]; k++ )
+                {
+                    result.append( cell_points[k] );
+                }
+            }
+        }
+    }
+
+    std::sort( result.begin(), result.end() );
+}
+
+
+
+int SpatialIndex::cellCoordinate( int c, int axis ) const
+{
+    if ( periodic[axis] )
+    {
+        c %= num_cells[axis];
+        return ( c < 0 ) ? c + num_cells[axis] : c;
+    }
+
+    if ( c < 0 )
+    {
+        return 0;
+    }
+
+    if ( c >= num_cells[axis] )
+    {
+        return num_cells[axis] - 1;
+    }
+
+    return c;
+}
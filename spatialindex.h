@@ -0,0 +1,86 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include <QVector>
+#include <math.h>
+
+#include "qwt3d_types.h"
+
+// Box of the packing with optionally periodic axes. separation() gives the
+// minimum image difference vector, so distances across a periodic face are
+// as short as inside the box.
+
+class PeriodicBox
+{
+public:
+    PeriodicBox();
+    PeriodicBox( const Qwt3D::Triple& boxMin, const Qwt3D::Triple& boxMax, bool periodicX, bool periodicY, bool periodicZ );
+
+    double lower( int axis ) const { return lo[axis]; }
+    double length( int axis ) const { return len[axis]; }
+    bool isPeriodic( int axis ) const { return periodic[axis]; }
+    Qwt3D::Triple separation( const Qwt3D::Triple& a, const Qwt3D::Triple& b ) const;
+
+protected:
+    double lo[3];
+    double len[3];
+    bool periodic[3];
+
+    double minimumImage( double d, int axis ) const;
+};
+
+
+// Cell list over a fixed set of points for ball queries. Points are
+// identified by their position in the list handed to build(), and
+// candidates() reports them in ascending order, so callers that depend on
+// list order see the same sequence as a linear scan would give them.
+// Cell indices wrap on the periodic axes of the box.
+
+class SpatialIndex
+{
+public:
+    SpatialIndex();
+
+    void build( const PeriodicBox& box, double cellSize, const QVector<Qwt3D::Triple>& points );
+    void candidates( const Qwt3D::Triple& center, double radius, QVector<int>& result ) const;
+
+    int count() const { return cell_points.count(); }
+
+protected:
+    bool periodic[3];
+    double origin[3];
+    double cell_width[3];
+    int num_cells[3];
+    QVector<int> cell_start;
+    QVector<int> cell_points;
+
+    int rawCoordinate( double v, int axis ) const { return ( int ) floor( ( v - origin[axis] ) / cell_width[axis] ); }
+    int cellCoordinate( int c, int axis ) const;
+    int cellIndex( int cx, int cy, int cz ) const { return ( cz * num_cells[1] + cy ) * num_cells[0] + cx; }
+};
+
+#endif // SPATIALINDEX_H
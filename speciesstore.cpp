@@ -0,0 +1,117 @@
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+
+#include "speciesstore.h"
+
+SpeciesStore::SpeciesStore() :
+    xs(),
+    ys(),
+    zs(),
+    types(),
+    chains(),
+    max_chain_index( 0 ),
+    periodic_z( true )
+{
+    box_size = Vector_null();
+}
+
+
+
+void SpeciesStore::clear()
+{
+    xs.clear();
+    ys.clear();
+    zs.clear();
+    types.clear();
+    chains.clear();
+    max_chain_index = 0;
+}
+
+
+
+void SpeciesStore::append( float x, float y, float z, int type, int chain )
+{
+    xs.append( x );
+    ys.append( y );
+    zs.append( z );
+    types.append( ( qint16 ) type );
+    chains.append( chain );
+
+    if ( chain > max_chain_index )
+    {
+        max_chain_index = chain;
+    }
+}
+
+
+
+void SpeciesStore::fromGrid( Grid* grid )
+{
+    clear();
+
+    box_size = grid->params.box_size;
+    periodic_z = !( grid->params.film || grid->params.brush );
+
+    int num_atoms = 0;
+    for ( int chain_nr = 0; chain_nr < grid->max_chains; chain_nr++ )
+    {
+        Chain* chain = &grid->chains[chain_nr];
+        if ( chain->last > chain->first ) num_atoms += chain->last - chain->first;
+    }
+
+    xs.reserve( num_atoms );
+    ys.reserve( num_atoms );
+    zs.reserve( num_atoms );
+    types.reserve( num_atoms );
+    chains.reserve( num_atoms );
+
+    // same order as the chain graph puts its monomer nodes
+    for ( int chain_nr = 0; chain_nr < grid->max_chains; chain_nr++ )
+    {
+        Chain* chain = &grid->chains[chain_nr];
+
+        for ( int j = chain->first; j < chain->last; j++ )
+        {
+            Vector v = Vector_periodic_box( chain->atoms[j - chain->offset], box_size );
+            append( v.x, v.y, v.z, v.monomer_type, chain_nr + 1 );
+        }
+    }
+}
+
+
+
+void SpeciesStore::fromNodes( const Qwt3D::RenderNodeVector& nodes, const Vector& boxSize, bool periodicZ )
+{
+    clear();
+
+    box_size = boxSize;
+    periodic_z = periodicZ;
+
+    // the first two nodes only set the volume extents on screen
+    for ( int i = 2; i < ( int ) nodes.size(); i++ )
+    {
+        const Qwt3D::RenderNode& m = nodes[i];
+        append( m.pos[0], m.pos[1], m.pos[2], m.monomer_type, m.chain_index );
+    }
+}
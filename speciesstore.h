@@ -0,0 +1,73 @@
+#ifndef SPECIESSTORE_H
+#define SPECIESSTORE_H
+
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+#include <QVector>
+
+#include "grid.h"
+#include "qwt3d_types.h"
+
+// The monomers of a model as the simulation side sees them: positions
+// wrapped into the box, monomer type and chain index, one array per field.
+// Chain indices count from 1, point cloud particles carry
+// Qwt3D::INVALID_CHAIN_INDEX. Exposure, export and analysis work on this
+// store; the chain graph keeps its own render nodes and picks up changed
+// monomer types through ChainGraph::applySpecies().
+
+class SpeciesStore
+{
+public:
+    SpeciesStore();
+
+    void clear();
+    void fromGrid( Grid* grid );
+    void fromNodes( const Qwt3D::RenderNodeVector& nodes, const Vector& boxSize, bool periodicZ );
+
+    int count() const { return types.count(); }
+    Qwt3D::Triple position( int i ) const { return Qwt3D::Triple( xs.at( i ), ys.at( i ), zs.at( i ) ); }
+    int monomerType( int i ) const { return types.at( i ); }
+    void setMonomerType( int i, int type ) { types[i] = ( qint16 ) type; }
+    int chainIndex( int i ) const { return chains.at( i ); }
+    const QVector<qint16>& monomerTypes() const { return types; }
+    void setMonomerTypes( const QVector<qint16>& t ) { types = t; }
+    int maxChainIndex() const { return max_chain_index; }
+
+    const Vector& boxSize() const { return box_size; }
+    bool isPeriodicInZ() const { return periodic_z; }
+
+protected:
+    QVector<float> xs;
+    QVector<float> ys;
+    QVector<float> zs;
+    QVector<qint16> types;
+    QVector<qint32> chains;
+    int max_chain_index;
+    Vector box_size;
+    bool periodic_z;
+
+    void append( float x, float y, float z, int type, int chain );
+};
+
+#endif // SPECIESSTORE_H
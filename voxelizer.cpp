@@ -0,0 +1,418 @@
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+#include "voxelizer.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <QVarLengthArray>
+#include <QtConcurrent/QtConcurrentMap>
+#include <math.h>
+
+// all thread local histograms together may not exceed this size
+const qint64 MAX_HISTOGRAM_BYTES = 1024 * 1024 * 1024;
+const int MIN_ATOMS_PER_TASK = 10000;
+const qint64 MERGE_CHUNK = 1024 * 1024;
+
+// Gaussian kernels are cut off at this many standard deviations
+const float GAUSSIAN_CUTOFF = 3.0;
+
+
+Voxelizer::Voxelizer( int numCols, int numRows, int numLayers ) :
+    num_cols( numCols ),
+    num_rows( numRows ),
+    num_layers( numLayers ),
+    num_channels( 1 ),
+    splatting( NEAREST ),
+    gaussian_width( 0.0 ),
+    periodic_z( true ),
+    atoms(),
+    data()
+{
+    box_size = Vector_null();
+}
+
+
+
+void Voxelizer::collectAtoms( Grid* grid )
+{
+    atoms.clear();
+
+    for ( int chain_nr = 0; chain_nr < grid->max_chains; chain_nr++ )
+    {
+        Chain* chain = &grid->chains[chain_nr];
+
+        for ( int j = chain->first; j < chain->last; j++ )
+        {
+            atoms.append( Vector_periodic_box( chain->atoms[j - chain->offset], box_size ) );
+        }
+    }
+}
+
+
+
+bool Voxelizer::voxelize( Grid* grid )
+{
+    if ( num_cols < 1 || num_rows < 1 || num_layers < 1 )
+    {
+        return false;
+    }
+
+    box_size = grid->params.box_size;
+    periodic_z = !( grid->params.film || grid->params.brush );
+
+    collectAtoms( grid );
+
+    qint64 length = num_channels * voxelCount();
+    data.fill( 0.0, length );
+
+    // each task bins a contiguous range of atoms into its own histogram; the
+    // number of tasks is limited by the memory the extra histograms take
+
+    int num_tasks = QThread::idealThreadCount();
+
+    qint64 max_tasks = 1 + MAX_HISTOGRAM_BYTES / ( length * ( qint64 ) sizeof( float ) );
+    if ( num_tasks > max_tasks ) num_tasks = max_tasks;
+
+    max_tasks = ( atoms.count() + MIN_ATOMS_PER_TASK - 1 ) / MIN_ATOMS_PER_TASK;
+    if ( num_tasks > max_tasks ) num_tasks = max_tasks;
+    if ( num_tasks < 1 ) num_tasks = 1;
+
+    float* result = data.data();
+    QVector< QVector<float> > local( num_tasks - 1 );
+    QVector<float>* local_hist = local.data();
+
+    QVector<int> tasks;
+    for ( int i = 0; i < num_tasks; i++ )
+    {
+        tasks.append( i );
+    }
+
+    QtConcurrent::blockingMap( tasks, [this, result, local_hist, length, num_tasks]( int & task )
+    {
+        float* hist = result;
+
+        // the first task works on the result directly
+        if ( 0 < task )
+        {
+            local_hist[task - 1].fill( 0.0, length );
+            hist = local_hist[task - 1].data();
+        }
+
+        int first = ( qint64 ) atoms.count() * task / num_tasks;
+        int last = ( qint64 ) atoms.count() * ( task + 1 ) / num_tasks;
+        splat( hist, first, last );
+    } );
+
+    if ( 1 < num_tasks )
+    {
+        QVector<qint64> chunks;
+        for ( qint64 i = 0; i < length; i += MERGE_CHUNK )
+        {
+            chunks.append( i );
+        }
+
+        QtConcurrent::blockingMap( chunks, [result, local_hist, length, num_tasks]( qint64 & first )
+        {
+            qint64 last = qMin( first + MERGE_CHUNK, length );
+
+            for ( int t = 0; t < num_tasks - 1; t++ )
+            {
+                const float* hist = local_hist[t].constData();
+                for ( qint64 i = first; i < last; i++ )
+                {
+                    result[i] += hist[i];
+                }
+            }
+        } );
+    }
+
+    atoms.clear();
+
+    return true;
+}
+
+
+
+void Voxelizer::splat( float* hist, int first, int last ) const
+{
+    for ( int i = first; i < last; i++ )
+    {
+        const Vector& v = atoms.at( i );
+
+        int channel = 0;
+        if ( 1 < num_channels )
+        {
+            // monomers of unknown type have no channel to go to
+            if ( v.monomer_type < 0 || v.monomer_type >= num_channels ) continue;
+            channel = v.monomer_type;
+        }
+
+        if ( NEAREST == splatting || ( GAUSSIAN == splatting && gaussian_width <= 0.0 ) )
+        {
+            splatNearest( hist, v, channel );
+        }
+        else
+        {
+            splatSeparable( hist, v, channel );
+        }
+    }
+}
+
+
+
+void Voxelizer::splatNearest( float* hist, const Vector& v, int channel ) const
+{
+    int col = v.x * num_cols / box_size.x;
+    int row = v.y * num_rows / box_size.y;
+    int layer = v.z * num_layers / box_size.z;
+
+    if ( col >= num_cols ) col = num_cols - 1;
+    if ( row >= num_rows ) row = num_rows - 1;
+    if ( layer >= num_layers ) layer = num_layers - 1;
+    if ( col < 0 ) col = 0;
+    if ( row < 0 ) row = 0;
+    if ( layer < 0 ) layer = 0;
+
+    hist[index( channel, col, row, layer )] += 1.0;
+}
+
+
+
+int Voxelizer::reach( float step, int count ) const
+{
+    // number of voxels a splatted monomer extends to either side of its own
+
+    if ( TRILINEAR == splatting )
+    {
+        return 1;
+    }
+
+    int r = ceil( GAUSSIAN_CUTOFF * gaussian_width / step );
+    if ( 2 * r + 1 > count ) r = ( count - 1 ) / 2;
+
+    return r;
+}
+
+
+
+int Voxelizer::windowSize( float step, int count ) const
+{
+    return 2 * reach( step, count ) + 1;
+}
+
+
+
+int Voxelizer::axisWeights( float pos, float step, int count, bool periodic, float* w, int* cell ) const
+{
+    // weights of the voxels along one axis, normalized to one; voxels that
+    // fall outside a non-periodic axis are dropped
+
+    int first, last;
+    float f = pos / step - 0.5;
+
+    if ( TRILINEAR == splatting )
+    {
+        first = floor( f );
+        last = first + 1;
+    }
+    else
+    {
+        int r = reach( step, count );
+        first = floor( f + 0.5 ) - r;
+        last = first + 2 * r;
+    }
+
+    int n = 0;
+    float sum = 0.0;
+    float s2 = 2.0 * gaussian_width * gaussian_width;
+
+    for ( int k = first; k <= last; k++ )
+    {
+        int c = k;
+        if ( periodic )
+        {
+            c = k % count;
+            if ( c < 0 ) c += count;
+        }
+        else if ( c < 0 || c >= count )
+        {
+            continue;
+        }
+
+        if ( TRILINEAR == splatting )
+        {
+            w[n] = 1.0 - fabs( f - k );
+        }
+        else
+        {
+            float d = ( k + 0.5 ) * step - pos;
+            w[n] = exp( -d * d / s2 );
+        }
+        cell[n] = c;
+        sum += w[n];
+        n++;
+    }
+
+    if ( sum > 0.0 )
+    {
+        for ( int i = 0; i < n; i++ )
+        {
+            w[i] /= sum;
+        }
+    }
+
+    return n;
+}
+
+
+
+void Voxelizer::splatSeparable( float* hist, const Vector& v, int channel ) const
+{
+    float step_x = box_size.x / num_cols;
+    float step_y = box_size.y / num_rows;
+    float step_z = box_size.z / num_layers;
+
+    QVarLengthArray<float, 64> wx( windowSize( step_x, num_cols ) ), wy( windowSize( step_y, num_rows ) ), wz( windowSize( step_z, num_layers ) );
+    QVarLengthArray<int, 64> cx( wx.size() ), cy( wy.size() ), cz( wz.size() );
+
+    int nx = axisWeights( v.x, step_x, num_cols, true, wx.data(), cx.data() );
+    int ny = axisWeights( v.y, step_y, num_rows, true, wy.data(), cy.data() );
+    int nz = axisWeights( v.z, step_z, num_layers, periodic_z, wz.data(), cz.data() );
+
+    for ( int i = 0; i < nx; i++ )
+    {
+        for ( int j = 0; j < ny; j++ )
+        {
+            float wxy = wx[i] * wy[j];
+            float* column = hist + index( channel, cx[i], cy[j], 0 );
+
+            for ( int k = 0; k < nz; k++ )
+            {
+                column[cz[k]] += wxy * wz[k];
+            }
+        }
+    }
+}
+
+
+
+double Voxelizer::total() const
+{
+    double sum = 0.0;
+
+    for ( int i = 0; i < data.count(); i++ )
+    {
+        sum += data.at( i );
+    }
+
+    return sum;
+}
+
+
+
+bool Voxelizer::writeCSV( const QString& fileName, const QStringList& channelNames ) const
+{
+    QFile file( fileName );
+
+    if ( false == file.open( QFile::WriteOnly | QFile::Truncate ) )
+    {
+        return false;
+    }
+
+    QTextStream out( &file );
+
+    out << "column,row,layer";
+    if ( 1 == num_channels )
+    {
+        out << ",value";
+    }
+    else
+    {
+        for ( int c = 0; c < num_channels; c++ )
+        {
+            out << "," << ( c < channelNames.count() ? channelNames.at( c ) : QString( "type %1" ).arg( c ) );
+        }
+    }
+    out << "\n";
+
+    for ( int col = 0; col < num_cols; col++ )
+    {
+        for ( int row = 0; row < num_rows; row++ )
+        {
+            for ( int layer = 0; layer < num_layers; layer++ )
+            {
+                out << ( col + 1 ) << "," << ( row + 1 ) << "," << ( layer + 1 );
+                for ( int c = 0; c < num_channels; c++ )
+                {
+                    out << "," << data.at( index( c, col, row, layer ) );
+                }
+                out << "\n";
+            }
+        }
+    }
+
+    out.flush();
+
+    return QFile::NoError == file.error();
+}
+
+
+
+bool Voxelizer::writeNpy( const QString& fileName ) const
+{
+    // NumPy format version 1.0: magic, header length, a python dict literal
+    // padded to a multiple of 64 bytes, then the raw C-order float32 data
+
+    QFile file( fileName );
+
+    if ( false == file.open( QFile::WriteOnly | QFile::Truncate ) )
+    {
+        return false;
+    }
+
+    QString shape = QString( "%1, %2, %3" ).arg( num_cols ).arg( num_rows ).arg( num_layers );
+    if ( 1 < num_channels )
+    {
+        shape = QString( "%1, " ).arg( num_channels ) + shape;
+    }
+
+    QByteArray header = QString( "{'descr': '%1', 'fortran_order': False, 'shape': (%2), }" )
+                        .arg( QString( Q_BYTE_ORDER == Q_LITTLE_ENDIAN ? "<f4" : ">f4" ) ).arg( shape ).toLatin1();
+
+    const int PREAMBLE_LENGTH = 10;
+    int total_length = PREAMBLE_LENGTH + header.size() + 1;
+    header.append( QByteArray( ( 64 - total_length % 64 ) % 64, ' ' ) );
+    header.append( '\n' );
+
+    QByteArray preamble( "\x93NUMPY\x01\x00", 8 );
+    preamble.append( ( char )( header.size() & 0xff ) );
+    preamble.append( ( char )( ( header.size() >> 8 ) & 0xff ) );
+
+    file.write( preamble );
+    file.write( header );
+    file.write( ( const char* ) data.constData(), data.count() * ( qint64 ) sizeof( float ) );
+
+    return QFile::NoError == file.error();
+}
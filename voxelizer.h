@@ -0,0 +1,84 @@
+#ifndef VOXELIZER_H
+#define VOXELIZER_H
+
+// ----------------------------------------------------------------------------
+//
+// PolyScope
+// authored by William Hinsberg
+//
+// Copyright (C) 2024 Columbia Hill Technical Consulting
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 3
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335, USA.
+//
+// ----------------------------------------------------------------------------
+
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+#include "grid.h"
+
+// Bins the monomers of a packing onto a regular cols x rows x layers grid.
+// Voxel values are kept in one flat array, layer index running fastest,
+// optionally split into one channel per monomer type.
+
+class Voxelizer
+{
+public:
+    enum SPLATTING { NEAREST, TRILINEAR, GAUSSIAN };
+
+    Voxelizer( int numCols, int numRows, int numLayers );
+
+    void setSplatting( enum SPLATTING s ) { splatting = s; }
+    void setGaussianWidth( float sigma ) { gaussian_width = sigma; }
+    void setChannelCount( int n ) { num_channels = ( n < 1 ) ? 1 : n; }
+
+    bool voxelize( Grid* grid );
+
+    int channelCount() const { return num_channels; }
+    double total() const;
+    float value( int channel, int col, int row, int layer ) const { return data.at( index( channel, col, row, layer ) ); }
+
+    bool writeCSV( const QString& fileName, const QStringList& channelNames ) const;
+    bool writeNpy( const QString& fileName ) const;
+
+protected:
+    int num_cols;
+    int num_rows;
+    int num_layers;
+    int num_channels;
+    enum SPLATTING splatting;
+    float gaussian_width;
+    bool periodic_z;
+    Vector box_size;
+    QVector<Vector> atoms;
+    QVector<float> data;
+
+    qint64 index( int channel, int col, int row, int layer ) const
+    {
+        return ( ( ( qint64 ) channel * num_cols + col ) * num_rows + row ) * num_layers + layer;
+    }
+    qint64 voxelCount() const { return ( qint64 ) num_cols * num_rows * num_layers; }
+
+    void collectAtoms( Grid* grid );
+    void splat( float* hist, int first, int last ) const;
+    void splatNearest( float* hist, const Vector& v, int channel ) const;
+    void splatSeparable( float* hist, const Vector& v, int channel ) const;
+    int reach( float step, int count ) const;
+    int windowSize( float step, int count ) const;
+    int axisWeights( float pos, float step, int count, bool periodic, float* w, int* cell ) const;
+};
+
+#endif // VOXELIZER_H